@@ -0,0 +1,173 @@
+#include "cinder/app/App.h"
+#include "cinder/app/RendererGl.h"
+#include "cinder/gl/gl.h"
+#include "cinder/Timer.h"
+
+#include "cinder/text/FontManager.h"
+#include "cinder/text/Shaper.h"
+#include "cinder/text/TextLayout.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace ci;
+using namespace ci::app;
+using namespace std;
+
+// Drives the FontManager from several threads at once
+// Every thread registers the sample fonts, loads glyphs, shapes + lays out text at a few sizes
+// and checks it gets what the main thread got. Run it under ThreadSanitizer to catch races too.
+class FontThreadsApp : public App {
+  public:
+	void setup() override;
+	void keyDown( KeyEvent event ) override;
+	void draw() override;
+
+	void runStressTest();
+
+	std::vector<ci::fs::path> mFontPaths;
+	int mNumThreads = 8;
+	int mNumPasses = 20;
+	std::string mResult;
+	bool mPassed = false;
+};
+
+namespace {
+	const std::string TestText = "Sphinx of black quartz, judge my vow. 0123456789";
+	const int TestSizes[] = { 12, 24, 48 };
+
+	// What a thread sees of a face at a size
+	struct FontSample {
+		bool operator==( const FontSample& other ) const
+		{
+			return glyphIndices == other.glyphIndices && advances == other.advances && shapedIndices == other.shapedIndices
+				&& lineHeight == other.lineHeight && numLines == other.numLines;
+		}
+
+		std::vector<uint32_t>	glyphIndices;
+		std::vector<ci::vec2>	advances;
+		std::vector<uint32_t>	shapedIndices;
+		float					lineHeight = 0.f;
+		size_t					numLines = 0;
+	};
+
+	FontSample sampleFont( const text::Font& font )
+	{
+		FontSample sample;
+		sample.glyphIndices = text::FontManager::get()->getGlyphIndices( font, TestText );
+
+		for( uint32_t glyphIndex : sample.glyphIndices ) {
+			sample.advances.push_back( text::FontManager::get()->getGlyphMetrics( font, glyphIndex ).advance );
+		}
+
+		text::Shaper shaper( font );
+		text::Shaper::GlyphsRef glyphs = shaper.shape( { TestText, "en", text::Script::LATIN, text::Direction::LTR } );
+
+		if( glyphs ) {
+			sample.shapedIndices = glyphs->indices;
+		}
+
+		sample.lineHeight = font.getLineHeight();
+
+		text::Layout layout;
+		layout.setFont( font );
+		layout.setSize( ci::vec2( 200.f, text::GROW ) );
+		layout.calculateLayout( TestText );
+		sample.numLines = layout.getLines().size();
+
+		return sample;
+	}
+}
+
+void FontThreadsApp::setup()
+{
+	// The sample fonts in samples/assets
+	for( const auto& entry : ci::fs::recursive_directory_iterator( getAssetPath( "fonts" ) ) ) {
+		if( entry.path().extension() == ".otf" || entry.path().extension() == ".ttf" ) {
+			mFontPaths.push_back( entry.path() );
+		}
+	}
+
+	runStressTest();
+}
+
+void FontThreadsApp::runStressTest()
+{
+	struct TestFont {
+		size_t		pathIndex;
+		uint32_t	faceId;
+		int			size;
+	};
+
+	// The main thread's samples are the reference
+	std::vector<TestFont> fonts;
+	std::vector<FontSample> expected;
+
+	for( size_t i = 0; i < mFontPaths.size(); i++ ) {
+		for( int size : TestSizes ) {
+			text::Font font( ci::loadFile( mFontPaths[i] ), size );
+			fonts.push_back( { i, font.getFaceId(), size } );
+			expected.push_back( sampleFont( font ) );
+		}
+	}
+
+	std::atomic<int> numMismatches( 0 );
+	std::atomic<int> numSamples( 0 );
+	std::vector<std::thread> threads;
+
+	ci::Timer timer( true );
+
+	for( int t = 0; t < mNumThreads; t++ ) {
+		threads.emplace_back( [&, t] {
+			for( int pass = 0; pass < mNumPasses; pass++ ) {
+				// Threads start at different fonts, so the same faces are opened + shaped at the same time in different orders
+				for( size_t i = 0; i < fonts.size(); i++ ) {
+					size_t index = ( i + t * 7 + pass ) % fonts.size();
+
+					// Loading a face again must give the face it already has
+					text::Font font( ci::loadFile( mFontPaths[fonts[index].pathIndex] ), fonts[index].size );
+
+					if( font.getFaceId() != fonts[index].faceId || ! ( sampleFont( font ) == expected[index] ) ) {
+						numMismatches++;
+					}
+
+					numSamples++;
+				}
+			}
+		} );
+	}
+
+	for( auto& thread : threads ) {
+		thread.join();
+	}
+
+	mPassed = numMismatches == 0 && ! fonts.empty();
+	mResult = std::to_string( mNumThreads ) + " threads, " + std::to_string( numSamples ) + " samples of " + std::to_string( fonts.size() ) + " fonts: "
+		+ std::to_string( numMismatches ) + " mismatches in " + std::to_string( int( timer.getSeconds() * 1000.0 ) ) + " ms";
+
+	console() << mResult << std::endl;
+}
+
+void FontThreadsApp::keyDown( KeyEvent event )
+{
+	if( event.getChar() == 'r' ) {
+		runStressTest();
+	}
+	else if( event.getChar() == '+' ) {
+		mNumThreads *= 2;
+		runStressTest();
+	}
+	else if( event.getChar() == '-' && mNumThreads > 1 ) {
+		mNumThreads /= 2;
+		runStressTest();
+	}
+}
+
+void FontThreadsApp::draw()
+{
+	gl::clear( mPassed ? Color( 0.f, 0.25f, 0.f ) : Color( 0.35f, 0.f, 0.f ) );
+	gl::drawString( mResult, ci::vec2( 20.f, 20.f ) );
+	gl::drawString( "r: run again, +/-: more/fewer threads", ci::vec2( 20.f, 40.f ) );
+}
+
+CINDER_APP( FontThreadsApp, RendererGl )
@@ -2,12 +2,16 @@
 #include "cinder/app/RendererGl.h"
 #include "cinder/gl/gl.h"
 #include "cinder/FileWatcher.h"
+#include "cinder/Timer.h"
 #include "cinder/Utilities.h"
 
 #include "cinder/text/FontManager.h"
+#include "cinder/text/Shaper.h"
 #include "cinder/text/gl/TextureRenderer.h"
 #include "cinder/text/TextLayout.h"
 
+#include "hb.h"
+
 #include "cinder/Unicode.h"
 
 #include <string>
@@ -29,6 +33,8 @@ class CinderProjectApp : public App
 
 		void updateLayout();
 		void textFileUpdated( const ci::WatchEvent& event );
+		void benchmarkShaping();
+		void compareSimpleShaping();
 
 		std::shared_ptr<text::Font> mFont;
 
@@ -78,6 +84,143 @@ class CinderProjectApp : public App
 
 CinderProjectApp::CinderProjectApp() {}
 
+std::string unescape( const std::string& s );
+
+// Shapes the test text with Harfbuzz' Freetype + OpenType font functions (see FontManager::setOpenTypeShaping())
+// Logs the time for each and whether both gave the same glyphs, with the Harfbuzz version the difference depends on
+void CinderProjectApp::benchmarkShaping()
+{
+	const int iterations = 100;
+	std::vector<std::string> lines = ci::split( mTestText, '\n' );
+	bool openTypeShaping = text::FontManager::get()->isOpenTypeShaping();
+
+	// Shape every pass instead of reading the runs back from the shaping cache
+	text::FontManager::CacheLimits limits = text::FontManager::get()->getCacheLimits();
+	text::FontManager::CacheLimits benchmarkLimits = limits;
+	benchmarkLimits.maxShapedRunBytes = 0;
+	text::FontManager::get()->setCacheLimits( benchmarkLimits );
+
+	auto shape = [&]( bool openType, std::vector<text::Shaper::Glyph>& glyphs ) {
+		text::FontManager::get()->setOpenTypeShaping( openType );
+		text::Shaper shaper( *mFont );
+		shaper.setWordShaping( false );
+		shaper.setSimpleShaping( false );
+
+		ci::Timer timer;
+
+		// The first pass creates the Harfbuzz font + shape plans
+		for( int i = 0; i <= iterations; i++ ) {
+			if( i == 1 ) {
+				timer.start();
+			}
+
+			glyphs.clear();
+
+			for( const auto& line : lines ) {
+				text::Shaper::Text text = { line, mLanguage, mScript, mDirection };
+				std::vector<text::Shaper::Glyph> lineGlyphs = shaper.getShapedText( text );
+				glyphs.insert( glyphs.end(), lineGlyphs.begin(), lineGlyphs.end() );
+			}
+		}
+
+		return timer.getSeconds() * 1000.0 / iterations;
+	};
+
+	std::vector<text::Shaper::Glyph> freetypeGlyphs, openTypeGlyphs;
+	double freetypeMs = shape( false, freetypeGlyphs );
+	double openTypeMs = shape( true, openTypeGlyphs );
+	text::FontManager::get()->setOpenTypeShaping( openTypeShaping );
+	text::FontManager::get()->setCacheLimits( limits );
+
+	// Glyph counts only differ if the fonts map characters differently, then all of them count
+	size_t numDifferent = freetypeGlyphs.size() == openTypeGlyphs.size() ? 0 : std::max( freetypeGlyphs.size(), openTypeGlyphs.size() );
+
+	for( size_t i = 0; freetypeGlyphs.size() == openTypeGlyphs.size() && i < freetypeGlyphs.size(); i++ ) {
+		const text::Shaper::Glyph& a = freetypeGlyphs[i];
+		const text::Shaper::Glyph& b = openTypeGlyphs[i];
+
+		if( a.index != b.index || a.cluster != b.cluster || a.advance != b.advance || a.offset != b.offset ) {
+			numDifferent++;
+		}
+	}
+
+	console() << "Shaping " << freetypeGlyphs.size() << " glyphs with Harfbuzz " << hb_version_string() << ": Freetype " << freetypeMs << " ms, OpenType " << openTypeMs << " ms ("
+			  << freetypeMs / openTypeMs << "x), " << numDifferent << " glyphs differ" << std::endl;
+}
+
+// Shapes the English + Portuguese texts with and without simple shaping (see Shaper::setSimpleShaping())
+// Logs the time for each and the lines whose glyphs differ, there shouldn't be any
+// Fonts with standard ligatures the simple tables can't represent only shape simple text with them removed, so both are compared
+void CinderProjectApp::compareSimpleShaping()
+{
+	const int iterations = 100;
+
+	text::FontManager::CacheLimits limits = text::FontManager::get()->getCacheLimits();
+	text::FontManager::CacheLimits benchmarkLimits = limits;
+	benchmarkLimits.maxShapedRunBytes = 0;
+	text::FontManager::get()->setCacheLimits( benchmarkLimits );
+
+	for( const std::string filename : { "text/english.txt", "text/portugese.txt" } ) {
+		std::vector<std::string> lines = ci::split( unescape( ci::loadString( ci::app::loadAsset( filename ) ) ), '\n' );
+
+		for( bool ligatures : { true, false } ) {
+			text::Shaper::FeatureSet features;
+
+			if( ! ligatures ) {
+				features.remove( text::Shaper::LIGATURES );
+			}
+
+			auto shape = [&]( bool simple, std::vector<std::vector<text::Shaper::Glyph>>& lineGlyphs ) {
+				text::Shaper shaper( *mFont, features );
+				shaper.setWordShaping( false );
+				shaper.setSimpleShaping( simple );
+
+				ci::Timer timer;
+
+				// The first pass creates the Harfbuzz font, shape plans + simple shaping tables
+				for( int i = 0; i <= iterations; i++ ) {
+					if( i == 1 ) {
+						timer.start();
+					}
+
+					lineGlyphs.clear();
+
+					for( const auto& line : lines ) {
+						lineGlyphs.push_back( shaper.getShapedText( { line, "en", text::Script::LATIN, text::Direction::LTR } ) );
+					}
+				}
+
+				return timer.getSeconds() * 1000.0 / iterations;
+			};
+
+			std::vector<std::vector<text::Shaper::Glyph>> harfbuzzGlyphs, simpleGlyphs;
+			double harfbuzzMs = shape( false, harfbuzzGlyphs );
+			double simpleMs = shape( true, simpleGlyphs );
+			int numDifferent = 0;
+
+			for( size_t i = 0; i < lines.size(); i++ ) {
+				bool same = harfbuzzGlyphs[i].size() == simpleGlyphs[i].size();
+
+				for( size_t j = 0; same && j < harfbuzzGlyphs[i].size(); j++ ) {
+					const text::Shaper::Glyph& a = harfbuzzGlyphs[i][j];
+					const text::Shaper::Glyph& b = simpleGlyphs[i][j];
+					same = a.index == b.index && a.cluster == b.cluster && a.clusterLength == b.clusterLength && a.advance == b.advance && a.offset == b.offset;
+				}
+
+				if( ! same ) {
+					console() << filename << " line " << i + 1 << " differs: " << lines[i] << std::endl;
+					numDifferent++;
+				}
+			}
+
+			console() << filename << ( ligatures ? "" : " without ligatures" ) << ": Harfbuzz " << harfbuzzMs << " ms, simple " << simpleMs << " ms (" << harfbuzzMs / simpleMs << "x), "
+					  << numDifferent << " of " << lines.size() << " lines differ" << std::endl;
+		}
+	}
+
+	text::FontManager::get()->setCacheLimits( limits );
+}
+
 void CinderProjectApp::setup()
 {
 	setWindowSize( 1024.f, 768.f );
@@ -239,6 +382,20 @@ void CinderProjectApp::keyDown( KeyEvent event )
 		}
 	}
 
+	else if( event.getChar() == 'b' ) {
+		benchmarkShaping();
+		return;
+	}
+
+	else if( event.getChar() == 's' ) {
+		compareSimpleShaping();
+		return;
+	}
+
+	else if( event.getChar() == 'o' ) {
+		text::FontManager::get()->setOpenTypeShaping( ! text::FontManager::get()->isOpenTypeShaping() );
+	}
+
 	updateLayout();
 }
 
@@ -16,6 +16,79 @@ using namespace rapidxml;
 
 namespace cinder { namespace text {
 
+// Attribute List
+AttributeList::AttributeList( const Font& font, const ci::Color& color )
+	: fontFamily( FontManager::get()->getFontFamilyId( font ) )
+	, fontStyle( FontManager::get()->getFontStyleId( font ) )
+	, fontAttributes( FontManager::get()->getFaceAttributes( font ) )
+	, fontSize( font.getSize() )
+	, kerning( 0 )
+	, color( color )
+	, opacity( 1.f )
+	, language( "" )
+	, script( Script::INVALID )
+	, direction( Direction::INVALID )
+{
+}
+
+AttributeList::AttributeList( const std::string& fontFamily, const std::string& fontStyle, const int& fontSize, const ci::Color& color )
+	: fontFamily( FontManager::get()->internName( fontFamily ) )
+	, fontStyle( FontManager::get()->internName( fontStyle ) )
+	, fontAttributes( FaceAttributes::fromStyleName( fontStyle ) )
+	, fontSize( fontSize )
+	, kerning( 0 )
+	, color( color )
+	, opacity( 1.f )
+	, language( "" )
+	, script( Script::INVALID )
+	, direction( Direction::INVALID )
+{
+}
+
+Font AttributeList::getFont() const
+{
+	return Font( FontManager::get()->matchFace( fontFamily, fontAttributes, fontStyle ), fontSize );
+}
+
+void AttributeList::setFont( const Font& font )
+{
+	fontFamily = FontManager::get()->getFontFamilyId( font );
+	fontStyle = FontManager::get()->getFontStyleId( font );
+	fontAttributes = FontManager::get()->getFaceAttributes( font );
+	fontSize = font.getSize();
+}
+
+void AttributeList::setFontFamily( const std::string& family )
+{
+	fontFamily = FontManager::get()->internName( family );
+}
+
+void AttributeList::setFontStyle( const std::string& style )
+{
+	fontStyle = FontManager::get()->internName( style );
+	fontAttributes = FaceAttributes::fromStyleName( style );
+}
+
+std::string AttributeList::getFontFamily() const
+{
+	return FontManager::get()->getInternedName( fontFamily );
+}
+
+std::string AttributeList::getFontStyle() const
+{
+	return FontManager::get()->getInternedName( fontStyle );
+}
+
+std::ostream& operator<< ( std::ostream& os, AttributeList const& attr )
+{
+	os << "Font-Family: " << attr.getFontFamily() << std::endl;
+	os << "Font-Style: " << attr.getFontStyle() << std::endl;
+	os << "Font-Size: " << attr.fontSize << std::endl;
+	os << "Color: " << attr.color << std::endl;
+	return os;
+}
+
+// Attributed String
 AttributedString::AttributedString()
 	: AttributedString( "", DefaultFont() )
 {
@@ -26,7 +99,7 @@ AttributedString::AttributedString( const std::string& text, const Font& baseFon
 	// Find runs based on line breaks
 	std::string textToParse = text;
 
-	AttributeList attributes( baseFont.getFamily(), baseFont.getStyle(), baseFont.getSize(), color ) ;
+	AttributeList attributes( baseFont, color );
 	mSubstrings.push_back( Substring( text, attributes ) );
 }
 
@@ -74,22 +147,20 @@ void AttributedString::addAttribute( const Attribute& attribute )
 			break;
 
 		case FONT: {
-			Font font = static_cast<const AttributeFont&>( attribute ).font;
-			mSubstrings.back().attributes.fontFamily = font.getFamily();
-			mSubstrings.back().attributes.fontStyle = font.getStyle();
-			mSubstrings.back().attributes.fontSize = font.getSize();
+			const Font& font = static_cast<const AttributeFont&>( attribute ).font;
+			mSubstrings.back().attributes.setFont( font );
 		}
 		break;
 
 		case FONT_FAMILY: {
-			std::string family = static_cast<const AttributeFontFamily&>( attribute ).family;
-			mSubstrings.back().attributes.fontFamily = family;
+			const std::string& family = static_cast<const AttributeFontFamily&>( attribute ).family;
+			mSubstrings.back().attributes.setFontFamily( family );
 		}
 		break;
 
 		case FONT_STYLE: {
-			std::string style = static_cast<const AttributeFontStyle&>( attribute ).style;
-			mSubstrings.back().attributes.fontStyle = style;
+			const std::string& style = static_cast<const AttributeFontStyle&>( attribute ).style;
+			mSubstrings.back().attributes.setFontStyle( style );
 			break;
 		}
 
@@ -198,23 +269,23 @@ void RichTextParser::pushNodeAttributes( rapidxml::xml_node<>* node )
 
 	// Check for <b> or <i> tags
 	if( strcmp( node->name(), ATTR_BOLD ) == 0 ) {
-		mAttributesStack.top().fontStyle = "Bold";
+		mAttributesStack.top().setFontWeight( 700 );
 	}
 
 	else if( strcmp( node->name(), ATTR_ITALIC ) == 0 ) {
-		mAttributesStack.top().fontStyle = "Italic";
+		mAttributesStack.top().setFontSlant( FaceAttributes::SLANT_ITALIC );
 	}
 
 	// Parse out attributes
 	for( xml_attribute<>* attr = node->first_attribute(); attr; attr = attr->next_attribute() ) {
 		// Font-family
 		if( strcmp( attr->name(), ATTR_FONT_FAMILY ) == 0 ) {
-			mAttributesStack.top().fontFamily = attr->value();
+			mAttributesStack.top().setFontFamily( attr->value() );
 		}
 
 		// Font-style
 		else if( strcmp( attr->name(), ATTR_FONT_STYLE ) == 0 ) {
-			mAttributesStack.top().fontStyle = attr->value();
+			mAttributesStack.top().setFontStyle( attr->value() );
 		}
 
 		// Font-size
@@ -114,27 +114,29 @@ struct RichText {
 };
 
 struct AttributeList {
-	AttributeList( const Font& font, const ci::Color& color )
-		: AttributeList( font.getFamily(), font.getStyle(), font.getSize(), color )
-	{
-
-	}
-
-	AttributeList( const std::string& fontFamily, const std::string& fontStyle, const int& fontSize, const ci::Color& color )
-		: fontFamily( fontFamily )
-		, fontStyle( fontStyle )
-		, fontSize( fontSize )
-		, color( color )
-		, opacity( 1.f )
-		, kerning( 0 )
-		, language( "" )
-		, script( Script::INVALID )
-		, direction( Direction::INVALID )
-	{
-	}
-
-	std::string fontFamily;
-	std::string fontStyle;
+	AttributeList( const Font& font, const ci::Color& color );
+	AttributeList( const std::string& fontFamily, const std::string& fontStyle, const int& fontSize, const ci::Color& color );
+
+	//! Returns the family's face closest to the attributes at the size, see FontManager::matchFace()
+	Font getFont() const;
+	void setFont( const Font& font );
+	void setFontFamily( const std::string& family );
+	//! Sets the style name and the attributes it describes
+	void setFontStyle( const std::string& style );
+	//! Only change the attributes, <b> inside <i> is bold italic
+	void setFontWeight( uint16_t weight ) { fontAttributes.weight = weight; }
+	void setFontSlant( FaceAttributes::Slant slant ) { fontAttributes.slant = slant; }
+
+	//! The names as they were set, use these instead of the fields to read or compare names
+	std::string getFontFamily() const;
+	std::string getFontStyle() const;
+
+	// Family + style are interned FontManager name ids (FontManager::internName()), not the names themselves.
+	// These used to be std::string, code that read or assigned the fields directly has to go through the accessors.
+	// The face is matched by the attributes, the style name only picks between faces with the same attributes
+	uint32_t fontFamily;
+	uint32_t fontStyle;
+	FaceAttributes fontAttributes;
 	int fontSize;
 
 	Unit lineHeight;
@@ -148,14 +150,7 @@ struct AttributeList {
 	Script script;
 	Direction direction;
 
-	friend std::ostream& operator<< ( std::ostream& os, AttributeList const& attr )
-	{
-		os << "Font-Family: " << attr.fontFamily << std::endl;
-		os << "Font-Style: " << attr.fontStyle << std::endl;
-		os << "Font-Size: " << attr.fontSize << std::endl;
-		os << "Color: " << attr.color << std::endl;
-		return os;
-	}
+	friend std::ostream& operator<< ( std::ostream& os, AttributeList const& attr );
 };
 
 // Attributed String
@@ -205,7 +200,7 @@ inline AttributedString& operator << ( AttributedString& attrStr, const Attribut
 
 inline AttributedString& operator << ( AttributedString& attrStr, const Font& font )
 {
-	attrStr << AttributeFontFamily( font.getFamily() ) << AttributeFontSize( font.getSize() ) << AttributeFontStyle( font.getStyle() );
+	attrStr << AttributeFont( font );
 	return attrStr;
 }
 
@@ -0,0 +1,297 @@
+#include "cinder/text/FaceData.h"
+#include "cinder/Log.h"
+
+#if defined( CINDER_MSW )
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+namespace cinder { namespace text {
+
+namespace {
+
+// 64-bit FNV-1a
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+const uint64_t FNV_PRIME = 1099511628211ull;
+
+uint64_t hashBytes( const uint8_t* bytes, size_t size, uint64_t hash )
+{
+	for( size_t i = 0; i < size; i++ ) {
+		hash = ( hash ^ bytes[i] ) * FNV_PRIME;
+	}
+
+	return hash;
+}
+
+// sfnt values are big endian
+uint32_t readUInt32( const uint8_t* bytes )
+{
+	return ( uint32_t( bytes[0] ) << 24 ) | ( uint32_t( bytes[1] ) << 16 ) | ( uint32_t( bytes[2] ) << 8 ) | uint32_t( bytes[3] );
+}
+
+uint16_t readUInt16( const uint8_t* bytes )
+{
+	return uint16_t( ( bytes[0] << 8 ) | bytes[1] );
+}
+
+const uint32_t SFNT_TAG_TRUETYPE = 0x00010000;
+const uint32_t SFNT_TAG_OPENTYPE = 0x4F54544F;	// 'OTTO'
+const uint32_t SFNT_TAG_APPLE = 0x74727565;		// 'true'
+const uint32_t SFNT_TAG_COLLECTION = 0x74746366;	// 'ttcf'
+
+} // anonymous namespace
+
+FaceData::FaceData()
+	: mData( nullptr )
+	, mSize( 0 )
+	, mMemoryMapped( false )
+#if defined( CINDER_MSW )
+	, mFileHandle( nullptr )
+	, mMappingHandle( nullptr )
+#endif
+{
+}
+
+FaceDataRef FaceData::create( const ci::BufferRef& buffer )
+{
+	if( ! buffer || buffer->getSize() == 0 ) {
+		return nullptr;
+	}
+
+	FaceDataRef data( new FaceData() );
+	data->mBuffer = buffer;
+	data->mData = reinterpret_cast<const uint8_t*>( buffer->getData() );
+	data->mSize = buffer->getSize();
+
+	return data;
+}
+
+#if defined( CINDER_MSW )
+
+FaceDataRef FaceData::create( const ci::fs::path& path )
+{
+	HANDLE file = ::CreateFileW( path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+	if( file == INVALID_HANDLE_VALUE ) {
+		CI_LOG_E( "Could not open font file: " << path );
+		return nullptr;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if( ! ::GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart == 0 ) {
+		CI_LOG_E( "Could not read size of font file: " << path );
+		::CloseHandle( file );
+		return nullptr;
+	}
+
+	HANDLE mapping = ::CreateFileMappingW( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	const void* view = mapping ? ::MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 ) : NULL;
+
+	if( ! view ) {
+		CI_LOG_E( "Could not map font file: " << path );
+
+		if( mapping ) {
+			::CloseHandle( mapping );
+		}
+
+		::CloseHandle( file );
+		return nullptr;
+	}
+
+	FaceDataRef data( new FaceData() );
+	data->mData = reinterpret_cast<const uint8_t*>( view );
+	data->mSize = static_cast<size_t>( fileSize.QuadPart );
+	data->mMemoryMapped = true;
+	data->mFilePath = path;
+	data->mFileHandle = file;
+	data->mMappingHandle = mapping;
+
+	return data;
+}
+
+FaceData::~FaceData()
+{
+	if( mMemoryMapped ) {
+		::UnmapViewOfFile( mData );
+		::CloseHandle( mMappingHandle );
+		::CloseHandle( mFileHandle );
+	}
+}
+
+size_t FaceData::getResidentBytes() const
+{
+	if( ! mMemoryMapped ) {
+		return mSize;
+	}
+
+	SYSTEM_INFO systemInfo;
+	::GetSystemInfo( &systemInfo );
+	size_t pageSize = systemInfo.dwPageSize;
+	size_t numPages = ( mSize + pageSize - 1 ) / pageSize;
+
+	std::vector<PSAPI_WORKING_SET_EX_INFORMATION> pages( numPages );
+
+	for( size_t i = 0; i < numPages; i++ ) {
+		pages[i].VirtualAddress = const_cast<uint8_t*>( mData ) + i * pageSize;
+	}
+
+	if( ! ::QueryWorkingSetEx( ::GetCurrentProcess(), pages.data(), DWORD( pages.size() * sizeof( PSAPI_WORKING_SET_EX_INFORMATION ) ) ) ) {
+		return 0;
+	}
+
+	size_t residentPages = 0;
+
+	for( const auto& page : pages ) {
+		residentPages += page.VirtualAttributes.Valid ? 1 : 0;
+	}
+
+	return ( std::min )( residentPages * pageSize, mSize );
+}
+
+#else
+
+FaceDataRef FaceData::create( const ci::fs::path& path )
+{
+	int fd = ::open( path.string().c_str(), O_RDONLY );
+
+	if( fd < 0 ) {
+		CI_LOG_E( "Could not open font file: " << path );
+		return nullptr;
+	}
+
+	struct stat fileStat;
+
+	if( ::fstat( fd, &fileStat ) != 0 || fileStat.st_size == 0 ) {
+		CI_LOG_E( "Could not read size of font file: " << path );
+		::close( fd );
+		return nullptr;
+	}
+
+	size_t size = static_cast<size_t>( fileStat.st_size );
+	void* address = ::mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
+
+	// The mapping holds its own reference to the file
+	::close( fd );
+
+	if( address == MAP_FAILED ) {
+		CI_LOG_E( "Could not map font file: " << path );
+		return nullptr;
+	}
+
+	// Faces read tables all over the file, don't read ahead pages that may never be used
+	::posix_madvise( address, size, POSIX_MADV_RANDOM );
+
+	FaceDataRef data( new FaceData() );
+	data->mData = reinterpret_cast<const uint8_t*>( address );
+	data->mSize = size;
+	data->mMemoryMapped = true;
+	data->mFilePath = path;
+
+	return data;
+}
+
+FaceData::~FaceData()
+{
+	if( mMemoryMapped ) {
+		::munmap( const_cast<uint8_t*>( mData ), mSize );
+	}
+}
+
+size_t FaceData::getResidentBytes() const
+{
+	if( ! mMemoryMapped ) {
+		return mSize;
+	}
+
+	size_t pageSize = static_cast<size_t>( ::sysconf( _SC_PAGESIZE ) );
+	size_t numPages = ( mSize + pageSize - 1 ) / pageSize;
+
+#if defined( CINDER_COCOA )
+	std::vector<char> pages( numPages );
+#else
+	std::vector<unsigned char> pages( numPages );
+#endif
+
+	if( ::mincore( const_cast<uint8_t*>( mData ), mSize, pages.data() ) != 0 ) {
+		return 0;
+	}
+
+	size_t residentPages = 0;
+
+	for( auto page : pages ) {
+		residentPages += ( page & 1 ) ? 1 : 0;
+	}
+
+	return std::min( residentPages * pageSize, mSize );
+}
+
+#endif
+
+uint64_t FaceData::getContentHash() const
+{
+	// Start from the size, a truncated copy of a font has the same header
+	uint64_t size = mSize;
+	uint64_t hash = hashBytes( reinterpret_cast<const uint8_t*>( &size ), sizeof( size ), FNV_OFFSET_BASIS );
+
+	if( mSize < 12 ) {
+		return hashBytes( mData, mSize, hash );
+	}
+
+	uint32_t tag = readUInt32( mData );
+
+	if( tag == SFNT_TAG_COLLECTION ) {
+		// The collection header lists the offset of each font's table directory
+		size_t numFonts = readUInt32( mData + 8 );
+		size_t headerSize = 12 + numFonts * 4;
+
+		if( headerSize <= mSize ) {
+			uint64_t collectionHash = hashBytes( mData, headerSize, hash );
+			bool valid = true;
+
+			for( size_t i = 0; i < numFonts && valid; i++ ) {
+				valid = hashTableDirectory( readUInt32( mData + 12 + i * 4 ), collectionHash );
+			}
+
+			if( valid ) {
+				return collectionHash;
+			}
+		}
+	}
+	else if( tag == SFNT_TAG_TRUETYPE || tag == SFNT_TAG_OPENTYPE || tag == SFNT_TAG_APPLE ) {
+		uint64_t fontHash = hash;
+
+		if( hashTableDirectory( 0, fontHash ) ) {
+			return fontHash;
+		}
+	}
+
+	return hashBytes( mData, mSize, hash );
+}
+
+bool FaceData::hashTableDirectory( size_t offset, uint64_t& hash ) const
+{
+	if( offset + 12 > mSize ) {
+		return false;
+	}
+
+	// Offset table followed by a 16 byte tag, checksum, offset, length record per table
+	size_t directorySize = 12 + size_t( readUInt16( mData + offset + 4 ) ) * 16;
+
+	if( offset + directorySize > mSize ) {
+		return false;
+	}
+
+	hash = hashBytes( mData + offset, directorySize, hash );
+	return true;
+}
+
+} } // namespace cinder::text
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "cinder/Buffer.h"
+#include "cinder/Filesystem.h"
+
+#include <memory>
+
+namespace cinder { namespace text {
+
+class FaceData;
+typedef std::shared_ptr<FaceData> FaceDataRef;
+
+// Read-only bytes for a font file, used to open faces from memory
+// Files are memory mapped so the pages are shared through the OS page cache
+// (also across processes), buffers are held by reference. Font bytes are never copied.
+class FaceData
+{
+  public:
+	//! Maps a font file read-only, returns nullptr if the file can't be mapped
+	static FaceDataRef create( const ci::fs::path& path );
+	//! Wraps a buffer without copying it, the buffer is kept alive by the FaceData
+	static FaceDataRef create( const ci::BufferRef& buffer );
+
+	~FaceData();
+
+	const uint8_t*		getData() const { return mData; }
+	size_t				getSize() const { return mSize; }
+
+	bool				isMemoryMapped() const { return mMemoryMapped; }
+	const ci::fs::path&	getFilePath() const { return mFilePath; }
+
+	//! Returns the number of font bytes currently in physical memory
+	//! For mapped files these are page cache pages, shared with other processes mapping the file.
+	//! Buffers are assumed to be fully resident
+	size_t getResidentBytes() const;
+
+	//! Returns a hash of the font's contents, equal for byte-identical fonts loaded from different paths or buffers
+	//! Only the sfnt header + table directories are read, they hold every table's length and checksum.
+	//! Data that isn't an sfnt font (or collection) is hashed in full.
+	uint64_t getContentHash() const;
+
+  private:
+	FaceData();
+
+	bool hashTableDirectory( size_t offset, uint64_t& hash ) const;
+
+	const uint8_t*	mData;
+	size_t			mSize;
+	bool			mMemoryMapped;
+	ci::fs::path	mFilePath;
+	ci::BufferRef	mBuffer;
+
+#if defined( CINDER_MSW )
+	void*			mFileHandle;
+	void*			mMappingHandle;
+#endif
+};
+
+} } // namespace cinder::text
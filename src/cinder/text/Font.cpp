@@ -2,18 +2,183 @@
 #include "cinder/text/FontManager.h"
 #include "cinder/text/SystemFonts.h"
 
+#include <algorithm>
+#include <cctype>
+
 namespace cinder { namespace text {
 
+// Font Variation
+FontVariation::FontVariation( const std::string& axis, float value )
+	: tag( 0 )
+	, value( value )
+{
+	// Tags shorter than 4 characters are padded with spaces
+	for( size_t i = 0; i < 4; i++ ) {
+		tag = ( tag << 8 ) | uint8_t( i < axis.size() ? axis[i] : ' ' );
+	}
+}
+
+// Face Attributes
+FaceAttributes FaceAttributes::fromStyleName( const std::string& style, bool* recognized )
+{
+	// Style words by their spelling without case, spaces or hyphens, longest first
+	// so "semibold" isn't read as "bold" and "semicondensed" isn't read as "condensed"
+	static const std::pair<const char*,uint16_t> weights[] = {
+		{ "extralight", 200 }, { "ultralight", 200 }, { "extrabold", 800 }, { "ultrabold", 800 },
+		{ "semibold", 600 }, { "demibold", 600 }, { "hairline", 100 }, { "regular", 400 },
+		{ "medium", 500 }, { "normal", 400 }, { "black", 900 }, { "heavy", 900 },
+		{ "light", 300 }, { "thin", 100 }, { "bold", 700 }, { "book", 400 }
+	};
+	static const std::pair<const char*,uint16_t> widths[] = {
+		{ "ultracondensed", 1 }, { "extracondensed", 2 }, { "semicondensed", 4 }, { "ultraexpanded", 9 },
+		{ "extraexpanded", 8 }, { "semiexpanded", 6 }, { "condensed", 3 }, { "expanded", 7 }, { "narrow", 3 }, { "wide", 7 }
+	};
+
+	std::string name;
+
+	for( char c : style ) {
+		if( c != ' ' && c != '-' && c != '_' ) {
+			name += char( ::tolower( static_cast<unsigned char>( c ) ) );
+		}
+	}
+
+	FaceAttributes attributes;
+	bool known = false;
+
+	for( const auto& weight : weights ) {
+		if( name.find( weight.first ) != std::string::npos ) {
+			attributes.weight = weight.second;
+			known = true;
+			break;
+		}
+	}
+
+	for( const auto& width : widths ) {
+		if( name.find( width.first ) != std::string::npos ) {
+			attributes.width = width.second;
+			known = true;
+			break;
+		}
+	}
+
+	if( name.find( "italic" ) != std::string::npos ) {
+		attributes.slant = SLANT_ITALIC;
+		known = true;
+	}
+	else if( name.find( "oblique" ) != std::string::npos || name.find( "slanted" ) != std::string::npos ) {
+		attributes.slant = SLANT_OBLIQUE;
+		known = true;
+	}
+
+	if( recognized ) {
+		*recognized = known;
+	}
+
+	return attributes;
+}
+
+std::string FaceAttributes::getStyleName() const
+{
+	static const char* widthNames[] = { "Ultra Condensed", "Extra Condensed", "Condensed", "Semi Condensed", "", "Semi Expanded", "Expanded", "Extra Expanded", "Ultra Expanded" };
+	static const char* weightNames[] = { "Thin", "Extra Light", "Light", "", "Medium", "Semi Bold", "Bold", "Extra Bold", "Black" };
+
+	std::string name = widthNames[std::min( std::max( int( width ), 1 ), 9 ) - 1];
+	std::string weightName = weightNames[std::min( std::max( ( int( weight ) + 50 ) / 100, 1 ), 9 ) - 1];
+
+	for( const std::string& word : { weightName, std::string( slant == SLANT_ITALIC ? "Italic" : slant == SLANT_OBLIQUE ? "Oblique" : "" ) } ) {
+		if( ! word.empty() ) {
+			name += name.empty() ? word : " " + word;
+		}
+	}
+
+	return name.empty() ? "Regular" : name;
+}
+
 // Font
 Font::Font( ci::DataSourceRef source, int size )
-	: mSize( size )
-	, mFaceId( FontManager::get()->getFaceId( source->getFilePath().string() ) )
+	: Font( (uint32_t)( source->isFilePath() ? FontManager::get()->getFaceId( source->getFilePath() ) : FontManager::get()->getFaceId( source->getBuffer() ) ), size )
 {
 }
 
 Font::Font( uint32_t faceId, int size )
-	: mSize( size )
+	: mHandle( FontManager::get()->getFontHandle( faceId, size ) )
 	, mFaceId( faceId )
+	, mSize( size )
+	, mOwnerId( FontManager::getCurrentFontOwnerId() )
+{
+	// getFontHandle() returns with the font's reference taken, counted towards the current owner
+}
+
+Font::Font( const Font& font )
+	: mHandle( font.mHandle )
+	, mFaceId( font.mFaceId )
+	, mSize( font.mSize )
+	, mOwnerId( FontManager::getCurrentFontOwnerId() )
+{
+	FontManager::retainFont( mHandle, mOwnerId );
+}
+
+Font::Font( Font&& font )
+	: mHandle( font.mHandle )
+	, mFaceId( font.mFaceId )
+	, mSize( font.mSize )
+	, mOwnerId( font.mOwnerId )
+{
+	// The reference moves with the handle
+	font.mHandle = FontManager::INVALID_FONT_HANDLE;
+}
+
+Font::~Font()
+{
+	FontManager::releaseFont( mHandle, mOwnerId );
+}
+
+Font& Font::operator=( const Font& other )
+{
+	// Retain first, assigning a font to itself mustn't drop its last reference
+	uint32_t ownerId = FontManager::getCurrentFontOwnerId();
+	FontManager::retainFont( other.mHandle, ownerId );
+	FontManager::releaseFont( mHandle, mOwnerId );
+
+	mHandle = other.mHandle;
+	mFaceId = other.mFaceId;
+	mSize = other.mSize;
+	mOwnerId = ownerId;
+	return *this;
+}
+
+Font& Font::operator=( Font&& other )
+{
+	if( this != &other ) {
+		FontManager::releaseFont( mHandle, mOwnerId );
+
+		mHandle = other.mHandle;
+		mFaceId = other.mFaceId;
+		mSize = other.mSize;
+		mOwnerId = other.mOwnerId;
+		other.mHandle = FontManager::INVALID_FONT_HANDLE;
+	}
+
+	return *this;
+}
+
+Font::Font( ci::DataSourceRef source, const FontVariations& variations, int size )
+	: Font( (uint32_t)( source->isFilePath() ? FontManager::get()->getFaceId( source->getFilePath() ) : FontManager::get()->getFaceId( source->getBuffer() ) ), variations, size )
+{
+}
+
+Font::Font( uint32_t faceId, const FontVariations& variations, int size )
+	: Font( FontManager::get()->getFaceInstanceId( faceId, variations ), size )
+{
+}
+
+Font::Font( std::string family, const FontVariations& variations, int size )
+	: Font( (uint32_t)FontManager::get()->getFaceId( family, "Regular" ), variations, size )
+{
+}
+
+Font::Font( std::string family, const FaceAttributes& attributes, int size )
+	: Font( FontManager::get()->matchFace( FontManager::get()->internName( family ), attributes ), size )
 {
 }
 
@@ -23,8 +188,7 @@ Font::Font( std::string family, int size )
 
 }
 Font::Font( std::string family, std::string style, int size )
-	: mSize( size )
-	, mFaceId( FontManager::get()->getFaceId( family, style ) )
+	: Font( (uint32_t)FontManager::get()->getFaceId( family, style ), size )
 {
 }
 
@@ -43,6 +207,16 @@ float Font::getLineHeight() const
 	return FontManager::get()->getLineHeight( *this );
 }
 
+FontVariations Font::getVariations() const
+{
+	return FontManager::get()->getFontVariations( *this );
+}
+
+FaceAttributes Font::getAttributes() const
+{
+	return FontManager::get()->getFaceAttributes( *this );
+}
+
 DefaultFont::DefaultFont()
 	: Font( SystemFonts::get()->getDefaultFamily(), SystemFonts::get()->getDefaultStyle(), SystemFonts::get()->getDefaultSize() )
 {}
@@ -3,33 +3,85 @@
 #include "cinder/Filesystem.h"
 #include "cinder/DataSource.h"
 
+#include <string>
+#include <vector>
+
 namespace cinder { namespace text {
 
+// A variable font axis coordinate, axes are OpenType tags ("wght", "wdth", "ital", "slnt", "opsz", ...)
+// Values are in the axis' design units, 100 - 900 for weight, percent of normal for width
+struct FontVariation {
+	FontVariation( const std::string& axis, float value );
+	FontVariation( uint32_t tag, float value ) : tag( tag ), value( value ) {}
+
+	uint32_t	tag;
+	float		value;
+};
+typedef std::vector<FontVariation> FontVariations;
+
+// Weight, width + slant of a face, faces of a family are matched by these instead of by style name
+struct FaceAttributes {
+	enum Slant : uint8_t {
+		SLANT_UPRIGHT,
+		SLANT_ITALIC,
+		SLANT_OBLIQUE
+	};
+
+	FaceAttributes() : weight( 400 ), width( 5 ), slant( SLANT_UPRIGHT ) {}
+	FaceAttributes( uint16_t weight, uint16_t width, Slant slant ) : weight( weight ), width( width ), slant( slant ) {}
+
+	//! Reads the attributes a style name describes ("Bold", "SemiBold Italic", "Condensed Light", ...)
+	//! Case, spaces and hyphens are ignored, unknown words leave the defaults. recognized is set if any word was known.
+	static FaceAttributes fromStyleName( const std::string& style, bool* recognized = nullptr );
+	//! Returns a style name for the attributes, "Regular", "Bold Italic", "Condensed Light", ...
+	std::string getStyleName() const;
+
+	bool operator==( const FaceAttributes& other ) const { return weight == other.weight && width == other.width && slant == other.slant; }
+	bool operator!=( const FaceAttributes& other ) const { return ! ( *this == other ); }
+
+	uint16_t	weight;		// OS/2 usWeightClass, 100 (thin) - 900 (black)
+	uint16_t	width;		// OS/2 usWidthClass, 1 (ultra-condensed) - 9 (ultra-expanded)
+	Slant		slant;
+};
+
+// A font is a face at a size
+// Each face + size gets a 32-bit handle from the FontManager that addresses its
+// metrics directly, so copying, comparing and hashing fonts never touches strings
+// Fonts are reference counted, a face nothing references can be unloaded (see FontManager::unloadUnusedFaces)
 struct Font {
   public:
 	Font( ci::DataSourceRef dataSource, int size );
 	Font( uint32_t faceId, int size );
 	Font( std::string family, int size );
 	Font( std::string family, std::string style, int size );
-	Font( const Font& font ) : Font( font.mFaceId, font.mSize ) { }
+	//! An instance of a variable font, axes that aren't set keep their default value
+	//! Instances share the font data of their face, see FontManager::getFaceInstanceId()
+	Font( ci::DataSourceRef dataSource, const FontVariations& variations, int size );
+	Font( uint32_t faceId, const FontVariations& variations, int size );
+	Font( std::string family, const FontVariations& variations, int size );
+	//! The face of a family closest to the attributes, see FontManager::matchFace()
+	Font( std::string family, const FaceAttributes& attributes, int size );
+	Font( const Font& font );
+	Font( Font&& font );
+	~Font();
 
+	const uint32_t		getHandle() const { return mHandle; }
 	const uint32_t 		getFaceId() const { return mFaceId; }
 	const unsigned int	getSize() const { return mSize; }
 	std::string 		getFamily() const;
 	std::string			getStyle() const;
 	float				getLineHeight() const;
+	//! Returns the axis coordinates of a variable font instance, empty for the default instance and static fonts
+	FontVariations		getVariations() const;
+	FaceAttributes		getAttributes() const;
 
 	bool operator==( const Font& other ) const
 	{
-		return mFaceId == other.mFaceId && mSize == other.mSize;
+		return mHandle == other.mHandle;
 	}
 
-	Font& operator=( const Font& other )
-	{
-		mFaceId = other.mFaceId;
-		mSize = other.mSize;
-		return *this;
-	}
+	Font& operator=( const Font& other );
+	Font& operator=( Font&& other );
 
 	friend std::ostream& operator<<( std::ostream& os, Font const& font )
 	{
@@ -43,8 +95,11 @@ struct Font {
 	friend class FontManager;
 
   private:
+	uint32_t mHandle;
 	uint32_t mFaceId;
 	unsigned int mSize;
+	// ScopedFontOwner the font's reference counts towards, see FontManager::getFontUsage()
+	uint32_t mOwnerId;
 };
 
 struct DefaultFont : public Font {
@@ -61,14 +116,8 @@ template <>
 struct hash<cinder::text::Font> {
 	std::size_t operator()( const cinder::text::Font& k ) const
 	{
-		using std::size_t;
-		using std::hash;
-		using std::string;
-
-		// Compute individual hash values for first,
-		// second and third and combine them using XOR
-		// and bit shifting:
-		return ( ( hash<uint32_t>()( (uint32_t)k.getFaceId() ) ^ ( hash<unsigned int>()( k.getSize() ) << 1 ) ) >> 1 );
+		// Handles are unique per face + size
+		return std::hash<uint32_t>()( k.getHandle() );
 	}
 };
 
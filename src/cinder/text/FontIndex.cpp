@@ -0,0 +1,433 @@
+#include "cinder/text/FontIndex.h"
+#include "cinder/Log.h"
+
+#include <freetype/ft2build.h>
+#include FT_FREETYPE_H
+#include <freetype/tttables.h>
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+namespace cinder { namespace text {
+
+struct FontIndex::Header {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	numEntries;
+	uint32_t	stringsSize;
+};
+
+struct FontIndex::Record {
+	uint32_t	pathOffset, pathLength;
+	uint32_t	familyOffset, familyLength;
+	uint32_t	styleOffset, styleLength;
+	uint32_t	faceIndex;
+	uint16_t	weight;
+	uint16_t	width;
+	uint8_t		slant;
+	uint8_t		padding[3];
+	uint32_t	reserved;
+	uint32_t	unicodeRanges[4];
+	uint64_t	fileSize;
+	int64_t		modifiedTime;
+};
+
+// "CTFI", bump the version whenever Header or Record change
+static const uint32_t FONT_INDEX_MAGIC = 0x49465443;
+static const uint32_t FONT_INDEX_VERSION = 1;
+
+FontIndex::FontIndex()
+	: mNumEntries( 0 )
+{
+}
+
+FontIndexRef FontIndex::load( const ci::fs::path& indexPath )
+{
+	uint64_t fileSize;
+	int64_t modifiedTime;
+
+	// A missing index isn't an error, it just hasn't been built yet
+	if( ! getFileStamp( indexPath, fileSize, modifiedTime ) || fileSize < sizeof( Header ) ) {
+		return nullptr;
+	}
+
+	FaceDataRef data = FaceData::create( indexPath );
+
+	if( ! data ) {
+		return nullptr;
+	}
+
+	const Header* header = reinterpret_cast<const Header*>( data->getData() );
+
+	if( header->magic != FONT_INDEX_MAGIC || header->version != FONT_INDEX_VERSION ) {
+		CI_LOG_W( "Ignoring font index with an unknown format: " << indexPath );
+		return nullptr;
+	}
+
+	uint64_t expectedSize = sizeof( Header ) + uint64_t( header->numEntries ) * sizeof( Record ) + header->stringsSize;
+
+	if( data->getSize() != expectedSize ) {
+		CI_LOG_W( "Ignoring truncated font index: " << indexPath );
+		return nullptr;
+	}
+
+	FontIndexRef index( new FontIndex() );
+	index->mData = data;
+	index->mIndexPath = indexPath;
+	index->mNumEntries = header->numEntries;
+
+	// Check the strings once so entries can be read without bounds checks
+	for( size_t i = 0; i < index->mNumEntries; i++ ) {
+		const Record* record = index->getRecord( i );
+
+		if( uint64_t( record->pathOffset ) + record->pathLength > header->stringsSize
+			|| uint64_t( record->familyOffset ) + record->familyLength > header->stringsSize
+			|| uint64_t( record->styleOffset ) + record->styleLength > header->stringsSize ) {
+			CI_LOG_W( "Ignoring corrupt font index: " << indexPath );
+			return nullptr;
+		}
+	}
+
+	return index;
+}
+
+FontIndexRef FontIndex::create( const ci::fs::path& directory, const ci::fs::path& indexPath )
+{
+	// Keep the entries of files that haven't changed, keyed by path
+	std::unordered_map<std::string,std::vector<Entry>> previousEntries;
+
+	{
+		FontIndexRef previous = load( indexPath );
+
+		if( previous ) {
+			for( size_t i = 0; i < previous->getNumEntries(); i++ ) {
+				Entry entry = previous->getEntry( i );
+				previousEntries[entry.path.string()].push_back( entry );
+			}
+		}
+
+		// The old mapping is released here, before the file gets replaced
+	}
+
+	std::error_code error;
+
+	if( ! ci::fs::is_directory( directory, error ) ) {
+		CI_LOG_E( "Font directory does not exist: " << directory );
+		return nullptr;
+	}
+
+	std::vector<Entry> entries;
+	bool changed = false;
+	size_t numKept = 0;
+
+	for( const ci::fs::path& path : findFontFiles( directory ) ) {
+		uint64_t fileSize;
+		int64_t modifiedTime;
+
+		if( ! getFileStamp( path, fileSize, modifiedTime ) ) {
+			continue;
+		}
+
+		auto previousIt = previousEntries.find( path.string() );
+
+		if( previousIt != previousEntries.end() ) {
+			const std::vector<Entry>& previous = previousIt->second;
+
+			if( previous.front().fileSize == fileSize && previous.front().modifiedTime == modifiedTime ) {
+				entries.insert( entries.end(), previous.begin(), previous.end() );
+				previousEntries.erase( previousIt );
+				numKept++;
+				continue;
+			}
+
+			previousEntries.erase( previousIt );
+		}
+
+		scanFile( path, fileSize, modifiedTime, entries );
+		changed = true;
+	}
+
+	// Anything left over was removed from the directory
+	changed = changed || ! previousEntries.empty();
+
+	CI_LOG_I( "Indexed " << entries.size() << " faces in " << directory << ", " << numKept << " files unchanged." );
+
+	if( changed || ! ci::fs::exists( indexPath, error ) ) {
+		if( ! write( indexPath, entries ) ) {
+			return nullptr;
+		}
+	}
+
+	return load( indexPath );
+}
+
+FontIndex::Entry FontIndex::getEntry( size_t index ) const
+{
+	const Record* record = getRecord( index );
+
+	Entry entry;
+	entry.path = getString( record->pathOffset, record->pathLength );
+	entry.faceIndex = record->faceIndex;
+	entry.family = getString( record->familyOffset, record->familyLength );
+	entry.style = getString( record->styleOffset, record->styleLength );
+	entry.weight = record->weight;
+	entry.width = record->width;
+	entry.slant = static_cast<Slant>( record->slant );
+	std::memcpy( entry.unicodeRanges, record->unicodeRanges, sizeof( entry.unicodeRanges ) );
+	entry.fileSize = record->fileSize;
+	entry.modifiedTime = record->modifiedTime;
+
+	return entry;
+}
+
+const FontIndex::Record* FontIndex::getRecord( size_t index ) const
+{
+	return reinterpret_cast<const Record*>( mData->getData() + sizeof( Header ) ) + index;
+}
+
+std::string FontIndex::getString( uint32_t offset, uint32_t length ) const
+{
+	const char* strings = reinterpret_cast<const char*>( mData->getData() + sizeof( Header ) + mNumEntries * sizeof( Record ) );
+	return std::string( strings + offset, length );
+}
+
+bool FontIndex::scan( const ci::fs::path& path, std::vector<Entry>& entries )
+{
+	uint64_t fileSize;
+	int64_t modifiedTime;
+
+	std::error_code error;
+
+	if( ! ci::fs::is_directory( path, error ) ) {
+		return getFileStamp( path, fileSize, modifiedTime ) && scanFile( path, fileSize, modifiedTime, entries );
+	}
+
+	for( const ci::fs::path& file : findFontFiles( path ) ) {
+		if( getFileStamp( file, fileSize, modifiedTime ) ) {
+			scanFile( file, fileSize, modifiedTime, entries );
+		}
+	}
+
+	return true;
+}
+
+std::vector<ci::fs::path> FontIndex::findFontFiles( const ci::fs::path& directory )
+{
+	std::vector<ci::fs::path> paths;
+	std::vector<ci::fs::path> directories = { directory };
+
+	// Walked one directory at a time so one that can't be listed is skipped instead of ending the walk
+	while( ! directories.empty() ) {
+		ci::fs::path current = directories.back();
+		directories.pop_back();
+
+		std::error_code error;
+		ci::fs::directory_iterator it( current, ci::fs::directory_options::skip_permission_denied, error ), end;
+
+		for( ; ! error && it != end; it.increment( error ) ) {
+			// Symlinked directories aren't followed, same as recursive_directory_iterator
+			std::error_code entryError;
+
+			if( ! it->is_symlink( entryError ) && it->is_directory( entryError ) ) {
+				directories.push_back( it->path() );
+			}
+			else if( isFontFile( it->path() ) ) {
+				paths.push_back( it->path() );
+			}
+		}
+
+		if( error ) {
+			CI_LOG_W( "Skipping unreadable font directory " << current << ": " << error.message() );
+		}
+	}
+
+	return paths;
+}
+
+bool FontIndex::isFontFile( const ci::fs::path& path )
+{
+	std::error_code error;
+
+	if( ! ci::fs::is_regular_file( path, error ) ) {
+		return false;
+	}
+
+	std::string extension = path.extension().string();
+	std::transform( extension.begin(), extension.end(), extension.begin(), ::tolower );
+
+	return extension == ".ttf" || extension == ".otf" || extension == ".ttc" || extension == ".otc";
+}
+
+bool FontIndex::scanFile( const ci::fs::path& path, uint64_t fileSize, int64_t modifiedTime, std::vector<Entry>& entries )
+{
+	// Scanning happens once per changed file, a temporary library keeps it off the FontManager caches
+	FT_Library library;
+
+	if( FT_Init_FreeType( &library ) != FT_Err_Ok ) {
+		return false;
+	}
+
+	FT_Long numFaces = 1;
+
+	for( FT_Long faceIndex = 0; faceIndex < numFaces; faceIndex++ ) {
+		FT_Face face;
+
+		if( FT_New_Face( library, path.string().c_str(), faceIndex, &face ) != FT_Err_Ok ) {
+			CI_LOG_W( "Could not index face " << faceIndex << " of font file: " << path );
+			break;
+		}
+
+		numFaces = face->num_faces;
+
+		Entry entry = Entry();
+		entry.path = path;
+		entry.faceIndex = static_cast<uint32_t>( faceIndex );
+		entry.family = face->family_name ? face->family_name : "";
+		entry.style = face->style_name ? face->style_name : "";
+		entry.fileSize = fileSize;
+		entry.modifiedTime = modifiedTime;
+
+		FaceAttributes attributes = readFaceAttributes( face );
+		entry.weight = attributes.weight;
+		entry.width = attributes.width;
+		entry.slant = static_cast<Slant>( attributes.slant );
+
+		TT_OS2* os2 = static_cast<TT_OS2*>( FT_Get_Sfnt_Table( face, FT_SFNT_OS2 ) );
+
+		if( os2 && os2->version != 0xFFFF ) {
+			entry.unicodeRanges[0] = static_cast<uint32_t>( os2->ulUnicodeRange1 );
+			entry.unicodeRanges[1] = static_cast<uint32_t>( os2->ulUnicodeRange2 );
+			entry.unicodeRanges[2] = static_cast<uint32_t>( os2->ulUnicodeRange3 );
+			entry.unicodeRanges[3] = static_cast<uint32_t>( os2->ulUnicodeRange4 );
+		}
+
+		entries.push_back( entry );
+		FT_Done_Face( face );
+	}
+
+	FT_Done_FreeType( library );
+	return true;
+}
+
+FaceAttributes FontIndex::readFaceAttributes( FT_Face face )
+{
+	// Fall back to the style flags for fonts without an OS/2 table
+	FaceAttributes attributes;
+	attributes.weight = ( face->style_flags & FT_STYLE_FLAG_BOLD ) ? 700 : 400;
+	attributes.slant = ( face->style_flags & FT_STYLE_FLAG_ITALIC ) ? FaceAttributes::SLANT_ITALIC : FaceAttributes::SLANT_UPRIGHT;
+
+	TT_OS2* os2 = static_cast<TT_OS2*>( FT_Get_Sfnt_Table( face, FT_SFNT_OS2 ) );
+
+	if( os2 && os2->version != 0xFFFF ) {
+		// Some fonts leave the classes at 0, keep the fallbacks for those
+		if( os2->usWeightClass != 0 ) {
+			attributes.weight = os2->usWeightClass;
+		}
+
+		if( os2->usWidthClass != 0 ) {
+			attributes.width = os2->usWidthClass;
+		}
+
+		// fsSelection bit 0 is italic, bit 9 (version 4+) is oblique
+		if( os2->fsSelection & ( 1 << 0 ) ) {
+			attributes.slant = FaceAttributes::SLANT_ITALIC;
+		}
+		else if( os2->version >= 4 && ( os2->fsSelection & ( 1 << 9 ) ) ) {
+			attributes.slant = FaceAttributes::SLANT_OBLIQUE;
+		}
+	}
+
+	return attributes;
+}
+
+bool FontIndex::write( const ci::fs::path& indexPath, const std::vector<Entry>& entries )
+{
+	std::vector<Record> records;
+	std::string strings;
+
+	auto addString = [&strings]( const std::string& string, uint32_t& offset, uint32_t& length ) {
+		offset = static_cast<uint32_t>( strings.size() );
+		length = static_cast<uint32_t>( string.size() );
+		strings += string;
+	};
+
+	for( const auto& entry : entries ) {
+		Record record = Record();
+		addString( entry.path.string(), record.pathOffset, record.pathLength );
+		addString( entry.family, record.familyOffset, record.familyLength );
+		addString( entry.style, record.styleOffset, record.styleLength );
+		record.faceIndex = entry.faceIndex;
+		record.weight = entry.weight;
+		record.width = entry.width;
+		record.slant = entry.slant;
+		std::memcpy( record.unicodeRanges, entry.unicodeRanges, sizeof( record.unicodeRanges ) );
+		record.fileSize = entry.fileSize;
+		record.modifiedTime = entry.modifiedTime;
+		records.push_back( record );
+	}
+
+	Header header;
+	header.magic = FONT_INDEX_MAGIC;
+	header.version = FONT_INDEX_VERSION;
+	header.numEntries = static_cast<uint32_t>( records.size() );
+	header.stringsSize = static_cast<uint32_t>( strings.size() );
+
+	// Write next to the index and swap it in, so a mapped or half written index is never read
+	ci::fs::path tempPath = indexPath;
+	tempPath += ".tmp";
+
+	{
+		std::ofstream file( tempPath.string().c_str(), std::ios::binary | std::ios::trunc );
+
+		if( ! file ) {
+			CI_LOG_E( "Could not write font index: " << tempPath );
+			return false;
+		}
+
+		file.write( reinterpret_cast<const char*>( &header ), sizeof( Header ) );
+		file.write( reinterpret_cast<const char*>( records.data() ), records.size() * sizeof( Record ) );
+		file.write( strings.data(), strings.size() );
+
+		if( ! file ) {
+			CI_LOG_E( "Could not write font index: " << tempPath );
+			return false;
+		}
+	}
+
+	try {
+		ci::fs::rename( tempPath, indexPath );
+	}
+	catch( const std::exception& exc ) {
+		CI_LOG_E( "Could not replace font index: " << indexPath << ", " << exc.what() );
+		return false;
+	}
+
+	return true;
+}
+
+bool FontIndex::getFileStamp( const ci::fs::path& path, uint64_t& fileSize, int64_t& modifiedTime )
+{
+#if defined( CINDER_MSW )
+	struct _stat64 fileStat;
+
+	if( ::_wstat64( path.wstring().c_str(), &fileStat ) != 0 ) {
+		return false;
+	}
+#else
+	struct stat fileStat;
+
+	if( ::stat( path.string().c_str(), &fileStat ) != 0 ) {
+		return false;
+	}
+#endif
+
+	fileSize = static_cast<uint64_t>( fileStat.st_size );
+	modifiedTime = static_cast<int64_t>( fileStat.st_mtime );
+	return true;
+}
+
+} } // namespace cinder::text
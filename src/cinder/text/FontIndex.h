@@ -0,0 +1,86 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/text/FaceData.h"
+#include "cinder/text/Font.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <freetype/ft2build.h>
+#include FT_FREETYPE_H
+
+namespace cinder { namespace text {
+
+class FontIndex;
+typedef std::shared_ptr<FontIndex> FontIndexRef;
+
+// Compact binary index of the faces in a font directory
+// The index file is memory mapped, entries are read from it without opening any face.
+// Rebuilding it only opens files whose size or modification time changed since the last scan.
+class FontIndex
+{
+  public:
+	enum Slant : uint8_t {
+		SLANT_UPRIGHT	= FaceAttributes::SLANT_UPRIGHT,
+		SLANT_ITALIC	= FaceAttributes::SLANT_ITALIC,
+		SLANT_OBLIQUE	= FaceAttributes::SLANT_OBLIQUE
+	};
+
+	struct Entry {
+		ci::fs::path	path;
+		uint32_t		faceIndex;			// face in a collection (.ttc/.otc), 0 for single face files
+		std::string		family;
+		std::string		style;
+		uint16_t		weight;				// OS/2 usWeightClass, 100 - 900
+		uint16_t		width;				// OS/2 usWidthClass, 1 (ultra-condensed) - 9 (ultra-expanded)
+		Slant			slant;
+		uint32_t		unicodeRanges[4];	// OS/2 ulUnicodeRange1-4 coverage bits
+		uint64_t		fileSize;
+		int64_t			modifiedTime;		// seconds since the epoch
+	};
+
+	//! Scans a directory (recursively) and updates the index file at indexPath
+	//! Entries for files with an unchanged size + modification time are kept from the existing index
+	static FontIndexRef create( const ci::fs::path& directory, const ci::fs::path& indexPath );
+	//! Maps an existing index file without scanning, returns nullptr if it is missing or invalid
+	static FontIndexRef load( const ci::fs::path& indexPath );
+	//! Reads the faces of a font file, or of every font file in a directory (recursively), without writing an index
+	static bool scan( const ci::fs::path& path, std::vector<Entry>& entries );
+
+	size_t	getNumEntries() const { return mNumEntries; }
+	Entry	getEntry( size_t index ) const;
+
+	const ci::fs::path& getIndexPath() const { return mIndexPath; }
+
+	//! Reads a face's weight, width + slant from its OS/2 table, or from its style flags if it has none
+	static FaceAttributes readFaceAttributes( FT_Face face );
+	static FaceAttributes getAttributes( const Entry& entry ) { return FaceAttributes( entry.weight, entry.width, static_cast<FaceAttributes::Slant>( entry.slant ) ); }
+
+	//! Returns true if a face in the index covers the OS/2 unicode range bit (0 - 127)
+	static bool hasUnicodeRange( const Entry& entry, uint32_t rangeBit ) { return rangeBit < 128 && ( entry.unicodeRanges[rangeBit / 32] & ( 1u << ( rangeBit % 32 ) ) ) != 0; }
+
+  private:
+	FontIndex();
+
+	// On-disk layout, a header followed by fixed size records and a string table
+	struct Header;
+	struct Record;
+
+	const Record*	getRecord( size_t index ) const;
+	std::string		getString( uint32_t offset, uint32_t length ) const;
+
+	static bool scanFile( const ci::fs::path& path, uint64_t fileSize, int64_t modifiedTime, std::vector<Entry>& entries );
+	// Font files anywhere below the directory, entries that can't be read are skipped
+	static std::vector<ci::fs::path> findFontFiles( const ci::fs::path& directory );
+	static bool isFontFile( const ci::fs::path& path );
+	static bool write( const ci::fs::path& indexPath, const std::vector<Entry>& entries );
+	static bool getFileStamp( const ci::fs::path& path, uint64_t& fileSize, int64_t& modifiedTime );
+
+	FaceDataRef		mData;
+	ci::fs::path	mIndexPath;
+	size_t			mNumEntries;
+};
+
+} } // namespace cinder::text
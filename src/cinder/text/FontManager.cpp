@@ -7,7 +7,21 @@
 #include <freetype/ft2build.h>
 #include FT_FREETYPE_H
 #include <freetype/ftcache.h>
+#include <freetype/ftmm.h>
+#include <freetype/ftmodapi.h>
+#include <freetype/ftoutln.h>
+#include <freetype/ftsnames.h>
+#include <freetype/ttnameid.h>
+#include "hb.h"
 #include "hb-ft.h"
+#include "hb-ot.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <tuple>
 
 #ifdef CINDER_MSW
 	#include <ShellScalingAPI.h>
@@ -15,30 +29,163 @@
 
 namespace cinder { namespace text {
 
-// Font Manager
-FontManagerRef FontManager::get()
+namespace {
+
+// Unicode codepoints of Mac Roman 0x80 - 0xFF, the lower half is ASCII
+const uint16_t sMacRomanCodepoints[128] = {
+	0x00C4, 0x00C5, 0x00C7, 0x00C9, 0x00D1, 0x00D6, 0x00DC, 0x00E1, 0x00E0, 0x00E2, 0x00E4, 0x00E3, 0x00E5, 0x00E7, 0x00E9, 0x00E8,
+	0x00EA, 0x00EB, 0x00ED, 0x00EC, 0x00EE, 0x00EF, 0x00F1, 0x00F3, 0x00F2, 0x00F4, 0x00F6, 0x00F5, 0x00FA, 0x00F9, 0x00FB, 0x00FC,
+	0x2020, 0x00B0, 0x00A2, 0x00A3, 0x00A7, 0x2022, 0x00B6, 0x00DF, 0x00AE, 0x00A9, 0x2122, 0x00B4, 0x00A8, 0x2260, 0x00C6, 0x00D8,
+	0x221E, 0x00B1, 0x2264, 0x2265, 0x00A5, 0x00B5, 0x2202, 0x2211, 0x220F, 0x03C0, 0x222B, 0x00AA, 0x00BA, 0x03A9, 0x00E6, 0x00F8,
+	0x00BF, 0x00A1, 0x00AC, 0x221A, 0x0192, 0x2248, 0x2206, 0x00AB, 0x00BB, 0x2026, 0x00A0, 0x00C0, 0x00C3, 0x00D5, 0x0152, 0x0153,
+	0x2013, 0x2014, 0x201C, 0x201D, 0x2018, 0x2019, 0x00F7, 0x25CA, 0x00FF, 0x0178, 0x2044, 0x20AC, 0x2039, 0x203A, 0xFB01, 0xFB02,
+	0x2021, 0x00B7, 0x201A, 0x201E, 0x2030, 0x00C2, 0x00CA, 0x00C1, 0x00CB, 0x00C8, 0x00CD, 0x00CE, 0x00CF, 0x00CC, 0x00D3, 0x00D4,
+	0xF8FF, 0x00D2, 0x00DA, 0x00DB, 0x00D9, 0x0131, 0x02C6, 0x02DC, 0x00AF, 0x02D8, 0x02D9, 0x02DA, 0x00B8, 0x02DD, 0x02DB, 0x02C7,
+};
+
+// Appends a BMP codepoint as UTF-8, surrogates are dropped
+void appendUtf8( std::string& utf8, uint32_t codepoint )
+{
+	if( codepoint < 0x80 ) {
+		utf8 += char( codepoint );
+	}
+	else if( codepoint < 0x800 ) {
+		utf8 += char( 0xC0 | ( codepoint >> 6 ) );
+		utf8 += char( 0x80 | ( codepoint & 0x3F ) );
+	}
+	else if( codepoint < 0xD800 || codepoint > 0xDFFF ) {
+		utf8 += char( 0xE0 | ( codepoint >> 12 ) );
+		utf8 += char( 0x80 | ( ( codepoint >> 6 ) & 0x3F ) );
+		utf8 += char( 0x80 | ( codepoint & 0x3F ) );
+	}
+}
+
+// Returns an sfnt name as UTF-8, preferring the English Windows (UTF-16BE) entry over the Mac Roman one
+// Mac names in other encodings are skipped
+std::string getSfntName( FT_Face face, FT_UInt nameId )
 {
-	static FontManagerRef ref = nullptr;
+	std::string macName;
+	FT_UInt numNames = FT_Get_Sfnt_Name_Count( face );
 
-	if( ! ref ) {
-		ref = FontManagerRef( new FontManager() );
+	for( FT_UInt i = 0; i < numNames; i++ ) {
+		FT_SfntName name;
+
+		if( FT_Get_Sfnt_Name( face, i, &name ) != FT_Err_Ok || name.name_id != nameId ) {
+			continue;
+		}
+
+		if( name.platform_id == TT_PLATFORM_MICROSOFT && name.language_id == TT_MS_LANGID_ENGLISH_UNITED_STATES ) {
+			std::string utf8;
+
+			// Names are BMP text in practice, surrogate pairs are dropped
+			for( FT_UInt c = 0; c + 1 < name.string_len; c += 2 ) {
+				appendUtf8( utf8, ( uint32_t( name.string[c] ) << 8 ) | name.string[c + 1] );
+			}
+
+			return utf8;
+		}
+
+		if( name.platform_id == TT_PLATFORM_MACINTOSH && name.encoding_id == TT_MAC_ID_ROMAN && macName.empty() ) {
+			for( FT_UInt c = 0; c < name.string_len; c++ ) {
+				appendUtf8( macName, name.string[c] < 0x80 ? name.string[c] : sMacRomanCodepoints[name.string[c] - 0x80] );
+			}
+		}
 	}
 
+	return macName;
+}
+
+} // anonymous namespace
+
+// Font Manager
+std::atomic<FontManager*> FontManager::sInstance( nullptr );
+thread_local uint32_t FontManager::sCurrentFontOwnerId = 0;
+
+const FontManagerRef& FontManager::get()
+{
+	// Function statics are initialized once, even with concurrent callers
+	static FontManagerRef ref( new FontManager() );
 	return ref;
 }
 
 FontManager::FontManager()
-	: mNextFaceId( -1 )
+	: mRegistry( std::make_shared<FaceRegistry>() )
+	, mNextFaceId( -1 )
+	, mGlyphPathClock( 0 )
+	, mGlyphPathBytes( 0 )
+	, mGlyphPathHits( 0 )
+	, mGlyphPathMisses( 0 )
+	, mGlyphPathEvictions( 0 )
+	, mGlyphBitmapClock( 0 )
+	, mGlyphBitmapBytes( 0 )
+	, mGlyphBitmapHits( 0 )
+	, mGlyphBitmapMisses( 0 )
+	, mGlyphBitmapEvictions( 0 )
+	, mGlyphBitmapQuantized( false )
+	, mShapedRunBytes( 0 )
+	, mShapedRunHits( 0 )
+	, mShapedRunMisses( 0 )
+	, mShapedRunEvictions( 0 )
+	, mOpenTypeShaping( false )
+	, mNumFontRecords( 1 )
+	, mFontUseClock( 0 )
+	, mStuckTrimUseClock( uint64_t( -1 ) )
+	, mFirstClosedFace( 0 )
+	, mNumClosedFaces( 0 )
+	, mLoadThreadExiting( false )
+	, mRetiredStats( CacheStats() )
+{
+	for( auto& chunk : mFontRecordChunks ) {
+		chunk.store( nullptr );
+	}
+
+	// Record 0 is the invalid font, face id 0 is never a face
+	mFontRecordChunks[0].store( new FontRecord[FONT_RECORD_CHUNK_SIZE] );
+
+	initResolution();
+
+	sInstance.store( this, std::memory_order_release );
+}
+
+FontManager::~FontManager()
 {
-	initFreetype();
+	// Fonts destroyed from here on (statics at exit) stop counting references
+	sInstance.store( nullptr, std::memory_order_release );
+
+	// Queued loads are dropped (their futures report a broken promise), wait for the running one
+	std::deque<std::function<void()>> droppedTasks;
+
+	{
+		std::lock_guard<std::mutex> lock( mLoadMutex );
+		mLoadThreadExiting = true;
+		droppedTasks.swap( mLoadTasks );
+	}
+
+	mLoadCondition.notify_one();
+
+	if( mLoadThread.joinable() ) {
+		mLoadThread.join();
+	}
+
+	for( auto& chunk : mFontRecordChunks ) {
+		delete[] chunk.load();
+	}
+
+	// Thread contexts still alive hold their own references
+	for( auto& face : mHarfbuzzFaces ) {
+		hb_face_destroy( face.second );
+	}
 }
 
 std::string FontManager::getFontFamily( const Font& font )
 {
 	auto faceID = ( FTC_FaceID )font.getFaceId();
 
-	if( mFamilyAndStyleForFaceIDs.count( faceID ) != 0 ) {
-		return mFamilyAndStyleForFaceIDs[faceID].family;
+	FaceRegistryRef registry = getRegistry();
+	auto it = registry->familyAndStyleForFaceIDs.find( faceID );
+
+	if( it != registry->familyAndStyleForFaceIDs.end() ) {
+		return it->second.family;
 	}
 
 	FaceFamilyAndStyle familyStyle( getFace( font ) );
@@ -50,8 +197,11 @@ std::string FontManager::getFontStyle( const Font& font )
 	FaceFamilyAndStyle familyStyle;
 	FTC_FaceID faceId = ( FTC_FaceID )font.getFaceId();
 
-	if( mFamilyAndStyleForFaceIDs.count( faceId ) != 0 ) {
-		familyStyle = mFamilyAndStyleForFaceIDs[faceId];
+	FaceRegistryRef registry = getRegistry();
+	auto it = registry->familyAndStyleForFaceIDs.find( faceId );
+
+	if( it != registry->familyAndStyleForFaceIDs.end() ) {
+		familyStyle = it->second;
 	}
 	else {
 		familyStyle = FaceFamilyAndStyle( getFace( faceId ) );
@@ -60,338 +210,3785 @@ std::string FontManager::getFontStyle( const Font& font )
 	return familyStyle.style;
 }
 
-float FontManager::getLineHeight( const Font& font )
+uint32_t FontManager::getFontFamilyId( const Font& font )
 {
-	return getSize( font )->metrics.height / 64.f;
+	FaceRegistryRef registry = getRegistry();
+	auto it = registry->familyStyleKeysForFaceIDs.find( ( FTC_FaceID )font.getFaceId() );
+
+	if( it != registry->familyStyleKeysForFaceIDs.end() ) {
+		return uint32_t( it->second >> 32 );
+	}
+
+	return internName( getFontFamily( font ) );
 }
 
-void FontManager::loadFace( const ci::DataSourceRef& dataSource, const std::string& family, const std::string& style )
+uint32_t FontManager::getFontStyleId( const Font& font )
 {
-	loadFace( dataSource->getFilePath(), family, style );
+	FaceRegistryRef registry = getRegistry();
+	auto it = registry->familyStyleKeysForFaceIDs.find( ( FTC_FaceID )font.getFaceId() );
+
+	if( it != registry->familyStyleKeysForFaceIDs.end() ) {
+		return uint32_t( it->second );
+	}
+
+	return internName( getFontStyle( font ) );
 }
 
-void FontManager::loadFace( const ci::fs::path& path, const std::string& family, const std::string& style )
+uint32_t FontManager::internName( const std::string& name )
 {
-	if( !mFaceIDsForPaths.count( path.string() ) ) {
-		mNextFaceId++;
-
-		uint32_t faceId = mNextFaceId;
-		FTC_FaceID id = ( FTC_FaceID )faceId;
+	std::lock_guard<std::mutex> lock( mNamesMutex );
 
-		// Store the path <---> id relationship
-		mFaceIDsForPaths[path.string()] = id;
-		mFacePathsForFaceID[id] = path.string();
+	auto it = mNameIds.find( name );
 
-		// Load the face family/style values
-		FaceFamilyAndStyle familyStyleFromFace( getFace( ( size_t )id ) );
-		FaceFamilyAndStyle familyStyleFromUser( family, style );
+	if( it != mNameIds.end() ) {
+		return it->second;
+	}
 
-		// If user didn't provide a fonts family or style try to use the values in the face
-		std::string f = family.empty() ? familyStyleFromFace.family : familyStyleFromUser.family;
-		std::string s = style.empty() ? familyStyleFromFace.style : familyStyleFromUser.style;
+	// Match names case-insensitively, same as FaceFamilyAndStyle
+	std::string lowercase = name;
+	std::transform( lowercase.begin(), lowercase.end(), lowercase.begin(), ::tolower );
 
-		FaceFamilyAndStyle familyStyle( f, s );
+	uint32_t nameId;
+	it = mNameIds.find( lowercase );
 
-		// Store the family/style <----------> id relationship
-		registerFamilyStyleForFaceID( familyStyle, id );
+	if( it != mNameIds.end() ) {
+		nameId = it->second;
+	}
+	else {
+		nameId = (uint32_t)mNames.size();
+		mNames.push_back( name );
+		mNameIds[lowercase] = nameId;
 	}
+
+	mNameIds[name] = nameId;
+	return nameId;
 }
 
-// --------------------------------------------------------
-// Freetype Functions
+std::string FontManager::getInternedName( uint32_t nameId )
+{
+	std::lock_guard<std::mutex> lock( mNamesMutex );
+	return nameId < mNames.size() ? mNames[nameId] : std::string();
+}
 
-FT_Face FontManager::getFace( const Font& font )
+float FontManager::getLineHeight( const Font& font )
 {
-	return getFace( font.mFaceId );
+	return getFontMetrics( font ).height;
 }
 
-FT_Face FontManager::getFace( size_t faceId )
+const FontManager::FontMetrics& FontManager::getFontMetrics( const Font& font )
 {
-	return getFace( ( FTC_FaceID )faceId );
+	return getLoadedFontRecord( font ).metrics;
 }
 
-FT_Face FontManager::getFace( FTC_FaceID faceId )
+FontManager::FontRecord& FontManager::getLoadedFontRecord( const Font& font )
 {
-	FT_Face face;
-	FT_Error error;
-	error = FTC_Manager_LookupFace( mFTCacheManager, ( FTC_FaceID )faceId, &face );
+	FontRecord& record = getFontRecord( font );
 
-	std::stringstream errorMessage;
-	errorMessage << "Could not lookup face " << faceId << ".";
-	checkForFTError( error, errorMessage.str() );
-	return face;
+	if( ! record.loaded.load( std::memory_order_acquire ) ) {
+		// Load outside of the lock, if another thread got here first its values are kept
+		FontMetrics metrics = loadFontMetrics( font );
+		GlyphClassTableRef glyphClasses = getGlyphClassTable( font );
+
+		std::lock_guard<std::mutex> lock( record.mutex );
+
+		if( ! record.loaded.load( std::memory_order_relaxed ) ) {
+			record.metrics = metrics;
+			record.glyphClasses = glyphClasses;
+			record.loaded.store( true, std::memory_order_release );
+		}
+	}
+
+	return record;
 }
 
-unsigned int FontManager::getNumGlyphs( const Font& font )
+uint8_t FontManager::getGlyphClasses( const Font& font, uint32_t glyphIndex )
 {
-	ci::app::console() << "Num Glyphs: " << getFace( font )->num_glyphs << std::endl;
-	return getFace( font )->num_glyphs;
+	return getLoadedFontRecord( font ).glyphClasses->get( glyphIndex );
 }
 
-FT_Size FontManager::getSize( const Font& font )
+FontManager::GlyphClassTableRef FontManager::getGlyphClassTable( const Font& font )
 {
-	FT_Size ftSize;
-	FT_Error error;
-	FTC_ScalerRec_ scaler = getScaler( font );
-	error = FTC_Manager_LookupSize( mFTCacheManager, ( FTC_Scaler ) &scaler, &ftSize );
+	{
+		std::lock_guard<std::mutex> lock( mGlyphClassTablesMutex );
+		auto it = mGlyphClassTables.find( font.mFaceId );
 
-	std::stringstream errorMessage;
-	errorMessage << "Could not lookup size for face " << font.mFaceId << " at size " << std::to_string( font.mSize ) << ".";
-	checkForFTError( error, errorMessage.str() );
+		if( it != mGlyphClassTables.end() ) {
+			return it->second;
+		}
+	}
 
-	return ftSize;
+	GlyphClassTableRef table = loadGlyphClassTable( font );
+
+	std::lock_guard<std::mutex> lock( mGlyphClassTablesMutex );
+	return mGlyphClassTables.emplace( font.mFaceId, table ).first->second;
 }
 
-FT_UInt FontManager::getGlyphIndex( const Font& font, FT_UInt32 charCode, FT_Int mapIndex )
+FontManager::GlyphClassTableRef FontManager::loadGlyphClassTable( const Font& font )
 {
-	return FTC_CMapCache_Lookup( mFTCMapCache, ( FTC_FaceID )font.mFaceId, mapIndex, charCode );
+	static const uint32_t whitespace[] = {
+		0x0020, // SPACE
+		0x00A0, // NO-BREAK SPACE
+		0x1680, // OGHAM SPACE MARK
+		0x2000, // EN QUAD
+		0x2001, // EM QUAD
+		0x2002, // EN SPACE
+		0x2003, // EM SPACE
+		0x2004, // THREE-PER-EM SPACE
+		0x2005, // FOUR-PER-EM SPACE
+		0x2006, // SIX-PER-EM SPACE
+		0x2007, // FIGURE SPACE
+		0x2008, // PUNCTUATION SPACE
+		0x2009, // THIN SPACE
+		0x200A, // HAIR SPACE
+		0x202F, // NARROW NO-BREAK SPACE
+		0x205F, // MEDIUM MATHEMATICAL SPACE
+		0x3000  // IDEOGRAPHIC SPACE
+	};
+
+	static const uint32_t newlines[] = {
+		0x000A, // LINE FEED
+		0x000B, // LINE TABULATION
+		0x000C, // FORM FEED
+		0x000D, // CARRIAGE RETURN
+		0x0085, // NEXT LINE
+		0x2028, // LINE SEPARATOR
+		0x2029  // PARAGRAPH SEPARATOR
+	};
+
+	static const uint32_t noBreak[] = {
+		0x00A0, // NO-BREAK SPACE
+		0x2007, // FIGURE SPACE
+		0x202F  // NARROW NO-BREAK SPACE
+	};
+
+	auto table = std::make_shared<GlyphClassTable>();
+
+	auto classify = [&]( const uint32_t* codepoints, size_t count, uint8_t glyphClass ) {
+		for( size_t i = 0; i < count; i++ ) {
+			uint32_t glyphIndex = getGlyphIndex( font, codepoints[i] );
+
+			// Unmapped characters all share .notdef, never classify it
+			if( glyphIndex == 0 ) {
+				continue;
+			}
+
+			if( glyphIndex >= table->classes.size() ) {
+				table->classes.resize( glyphIndex + 1, 0 );
+			}
+
+			table->classes[glyphIndex] |= glyphClass;
+		}
+	};
+
+	classify( whitespace, sizeof( whitespace ) / sizeof( uint32_t ), GLYPH_CLASS_WHITESPACE );
+	classify( newlines, sizeof( newlines ) / sizeof( uint32_t ), GLYPH_CLASS_NEWLINE );
+	classify( noBreak, sizeof( noBreak ) / sizeof( uint32_t ), GLYPH_CLASS_NO_BREAK );
+
+	return table;
 }
 
-std::vector<FT_UInt> FontManager::getGlyphIndices( const Font& font, std::string string )
+uint32_t FontManager::getFontHandle( uint32_t faceId, unsigned int size )
 {
-	std::vector<FT_UInt> indices;
+	uint64_t key = ( uint64_t( faceId ) << 32 ) | size;
+	uint32_t handle;
 
-	// Get indices for a predetermined group of chars
-	if( !string.empty() ) {
-		for( auto& character : string ) {
-			indices.push_back( getGlyphIndex( font, character, 0 ) );
+	{
+		std::lock_guard<std::mutex> lock( mFontRecordsMutex );
+		auto it = mFontHandles.find( key );
+		bool created = it == mFontHandles.end();
+
+		if( ! created ) {
+			handle = it->second;
 		}
-	}
+		else {
+			handle = mNumFontRecords;
+			size_t chunkIndex = handle / FONT_RECORD_CHUNK_SIZE;
 
-	// Otherwise load all the indices
-	// This is probably pretty slow since it doesn't use caching
-	else {
-		FT_UInt index;
-		FT_ULong character = FT_Get_First_Char( getFace( font ), &index );
+			if( chunkIndex >= FONT_RECORD_MAX_CHUNKS ) {
+				CI_LOG_E( "Too many fonts loaded, could not create a handle for face " << faceId << " at size " << size << "." );
+				return INVALID_FONT_HANDLE;
+			}
+
+			if( mFontRecordChunks[chunkIndex].load( std::memory_order_relaxed ) == nullptr ) {
+				mFontRecordChunks[chunkIndex].store( new FontRecord[FONT_RECORD_CHUNK_SIZE], std::memory_order_release );
+			}
+
+			FontRecord& record = getFontRecord( handle );
+			record.faceId = faceId;
+			record.size = size;
 
-		while( true ) {
-			indices.push_back( index );
-			character = FT_Get_Next_Char( getFace( font ), character, &index );
+			mNumFontRecords++;
+			mFontHandles[key] = handle;
+		}
+
+		// Copies of a font can only add to a count that's already above zero, so the first reference is always taken here
+		FontRecord& record = getFontRecord( handle );
+		record.refCount.fetch_add( 1, std::memory_order_relaxed );
+		countOwnerRefs( record, sCurrentFontOwnerId, 1 );
 
-			if( !index ) { break; }
+		if( ! created ) {
+			return handle;
 		}
 	}
 
+	// A new font is about to load, make room for it by unloading faces nothing references
+	uint64_t maxFaceBytes = getCacheLimits().maxFaceBytes;
 
-	return indices;
+	// Skipped while nothing was released since the last trim that couldn't unload anything, every face is still in use
+	if( getTrackedFaceBytes() > maxFaceBytes && mFontUseClock.load( std::memory_order_relaxed ) != mStuckTrimUseClock.load( std::memory_order_relaxed ) ) {
+		trimFaces( maxFaceBytes, faceId );
+	}
+
+	return handle;
 }
 
-std::vector<uint32_t> FontManager::getGlyphIndices( const Font& font, const std::pair<uint32_t, uint32_t> &unicodeRange )
+void FontManager::retainFont( uint32_t handle, uint32_t ownerId )
 {
-	std::vector<FT_UInt> indices;
-	auto face = getFace( font );
+	FontManager* manager = sInstance.load( std::memory_order_acquire );
 
-	for( uint32_t code = unicodeRange.first; code < unicodeRange.second + 1; code++ ){
-		FT_UInt glyph_index = getGlyphIndex( font, code, 0 );
-		if( glyph_index > 0 )
-			indices.push_back( glyph_index );
+	if( ! manager || handle == INVALID_FONT_HANDLE ) {
+		return;
 	}
-	
-	return indices;
+
+	FontRecord& record = manager->getFontRecord( handle );
+	record.refCount.fetch_add( 1, std::memory_order_relaxed );
+	countOwnerRefs( record, ownerId, 1 );
 }
 
-FT_Glyph FontManager::getGlyph( const Font& font, unsigned int glyphIndex )
+void FontManager::releaseFont( uint32_t handle, uint32_t ownerId )
 {
-	//FT_Glyph glyph;
-	FT_Glyph glyph;
-	FT_Error error;
-	FTC_ScalerRec_ scaler = getScaler( font );
-	error = FTC_ImageCache_LookupScaler( mFTCImageCache, &scaler, NULL, glyphIndex, ( FT_Glyph* )&glyph, NULL );
+	FontManager* manager = sInstance.load( std::memory_order_acquire );
 
-	std::stringstream errorMessage;
-	errorMessage << "Could not get glyph " << glyphIndex << " for face " << font.mFaceId << ".";
-	checkForFTError( error, errorMessage.str() );
+	if( ! manager || handle == INVALID_FONT_HANDLE ) {
+		return;
+	}
 
-	return glyph;
+	FontRecord& record = manager->getFontRecord( handle );
+	countOwnerRefs( record, ownerId, -1 );
+
+	// The last reference going away is when the font starts aging towards being unloaded
+	if( record.refCount.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) {
+		record.lastUse.store( ++manager->mFontUseClock, std::memory_order_relaxed );
+	}
 }
 
-FT_BitmapGlyph FontManager::getGlyphBitmap( const Font& font, unsigned int glyphIndex )
+void FontManager::countOwnerRefs( FontRecord& record, uint32_t ownerId, int delta )
 {
-	//FT_Glyph glyph;
-	FT_BitmapGlyph glyph;
-	FT_Error error;
-	FTC_ScalerRec_ scaler = getScaler( font );
-	error = FTC_ImageCache_LookupScaler( mFTCImageCache, &scaler, FT_LOAD_RENDER | FT_RENDER_MODE_NORMAL, glyphIndex, ( FT_Glyph* )&glyph, NULL );
+	if( ownerId == 0 ) {
+		return;
+	}
 
-	std::stringstream errorMessage;
-	errorMessage << "Could not get glyph " << glyphIndex << " for face " << font.mFaceId << ".";
-	checkForFTError( error, errorMessage.str() );
+	std::lock_guard<std::mutex> lock( record.ownersMutex );
+	auto it = std::find_if( record.ownerRefCounts.begin(), record.ownerRefCounts.end(), [ownerId]( const std::pair<uint32_t,uint32_t>& owner ) { return owner.first == ownerId; } );
 
-	return glyph;
+	if( it == record.ownerRefCounts.end() ) {
+		it = record.ownerRefCounts.insert( it, std::make_pair( ownerId, 0u ) );
+	}
+
+	it->second += delta;
+
+	if( it->second == 0 ) {
+		record.ownerRefCounts.erase( it );
+	}
 }
 
-ci::vec2 FontManager::getGlyphSize( const Font& font, unsigned int glyphIndex )
+uint32_t FontManager::getFontOwnerId( const std::string& owner )
 {
-	FT_BitmapGlyph glyph = getGlyphBitmap( font, glyphIndex );
-	return ci::vec2( glyph->bitmap.width, glyph->bitmap.rows );
+	std::lock_guard<std::mutex> lock( mFontOwnersMutex );
+	auto it = mFontOwnerIds.find( owner );
+
+	if( it != mFontOwnerIds.end() ) {
+		return it->second;
+	}
+
+	mFontOwners.push_back( owner );
+	uint32_t ownerId = (uint32_t)mFontOwners.size();
+	mFontOwnerIds[owner] = ownerId;
+	return ownerId;
 }
 
-ci::vec2 FontManager::getMaxGlyphSize( const Font& font )
+FontManager::ScopedFontOwner::ScopedFontOwner( const std::string& owner )
+	: mPreviousOwnerId( sCurrentFontOwnerId )
 {
-	FT_Size size = getSize( font );
-	FT_BBox bbox = size->face->bbox;
-
-	int pixelsX = ::FT_MulFix( ( size->face->bbox.xMax - size->face->bbox.xMin ), size->metrics.x_scale );
-	int pixelsY = ::FT_MulFix( ( size->face->bbox.yMax - size->face->bbox.yMin ), size->metrics.y_scale );
+	sCurrentFontOwnerId = FontManager::get()->getFontOwnerId( owner );
+}
 
-	//ci::vec2 maxSize( size->metrics.max_advance / 64.f, size->metrics.height / 64.f );
-	ci::vec2 maxSize( pixelsX / 64.f, pixelsY / 64.f );
-	return maxSize;
+FontManager::ScopedFontOwner::~ScopedFontOwner()
+{
+	sCurrentFontOwnerId = mPreviousOwnerId;
+}
 
+uint32_t FontManager::getFontRefCount( uint32_t handle )
+{
+	{
+		std::lock_guard<std::mutex> lock( mFontRecordsMutex );
 
-	//bbox.xMin = FT_MulFix( bbox.xMin / 64.f, size->metrics.x_scale );
-	//bbox.yMin = FT_MulFix( bbox.yMin / 64.f, size->metrics.y_scale );
-	//bbox.xMax = FT_MulFix( bbox.xMax / 64.f, size->metrics.x_scale );
-	//bbox.yMax = FT_MulFix( bbox.yMax / 64.f, size->metrics.y_scale );
+		if( handle >= mNumFontRecords ) {
+			return 0;
+		}
+	}
 
-	//return ci::vec2( bbox.xMax - bbox.xMin, bbox.yMax - bbox.yMin );
+	return getFontRecord( handle ).refCount.load( std::memory_order_relaxed );
 }
 
-FTC_ScalerRec_ FontManager::getScaler( const  Font& font )
+uint64_t FontManager::getTrackedFaceBytes()
 {
-	FTC_ScalerRec_ scaler = FTC_ScalerRec();
-	scaler.face_id = ( FTC_FaceID )font.mFaceId;
-	scaler.pixel = 1;
-	scaler.width = float( font.mSize );
-	scaler.height = float( font.mSize );
-	
-	double hPixelsPerInch, vPixelsPerInch;
-#ifdef CINDER_MSW
-	HDC screen = GetDC( NULL );
-	hPixelsPerInch = GetDeviceCaps( screen, LOGPIXELSX );
-	vPixelsPerInch = GetDeviceCaps( screen, LOGPIXELSY );
-	ReleaseDC( NULL, screen );
-#else
-	scaler.x_res = 96;
-	scaler.y_res = 96;
-#endif
-	scaler.x_res = hPixelsPerInch;
-	scaler.y_res = vPixelsPerInch;
+	uint64_t bytes = getRegistry()->dataBytes;
 
-	return scaler;
+	{
+		std::lock_guard<std::mutex> lock( mGlyphPathsMutex );
+		bytes += mGlyphPathBytes;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mGlyphBitmapsMutex );
+		bytes += mGlyphBitmapBytes;
+	}
+
+	return bytes;
 }
 
-// This function gets called by the cache when a new face_id is requested
-FT_Error FontManager::faceRequestor( FTC_FaceID face_id, FT_Library library, FT_Pointer req_data, FT_Face* aface )
+std::vector<FontManager::FontUsage> FontManager::getFontUsage()
 {
-	FontManagerRef fontManager = FontManager::get();
+	std::vector<std::string> owners;
 
-	FT_Error error;
-
-	// Try to load the font from a file
-	if( fontManager->mFacePathsForFaceID.count( face_id ) != 0 ) {
-		ci::fs::path fontPath = fontManager->mFacePathsForFaceID[face_id];
+	{
+		std::lock_guard<std::mutex> lock( mFontOwnersMutex );
+		owners = mFontOwners;
+	}
 
-		error = FT_New_Face( library,
-							 fontPath.string().c_str(),
-							 0,
-							 aface );
+	uint32_t numRecords;
 
-		std::stringstream errorMessage;
-		errorMessage << "Could not load face for font file: " << fontPath;
-		FontManager::checkForFTError( error, errorMessage.str() );
-		return error;
+	{
+		std::lock_guard<std::mutex> lock( mFontRecordsMutex );
+		numRecords = mNumFontRecords;
 	}
 
-	// Otherwise try to load it as a system font
-	else {
-		FaceFamilyAndStyle familyStyle = fontManager->mFamilyAndStyleForFaceIDs[face_id];
+	// Names come from the registry, looking them up shouldn't reopen unloaded faces
+	FaceRegistryRef registry = getRegistry();
+	std::vector<FontUsage> usage;
 
-		ci::BufferRef buffer = SystemFonts::get()->getFontBuffer( familyStyle.family, familyStyle.style );
+	for( uint32_t handle = INVALID_FONT_HANDLE + 1; handle < numRecords; handle++ ) {
+		FontRecord& record = getFontRecord( handle );
 
-		if( buffer != nullptr ) {
-			error = FT_New_Memory_Face( library, reinterpret_cast<FT_Byte*>( buffer->getData() ), static_cast<FT_Long>( buffer->getSize() ), 0, aface );
+		FontUsage font;
+		font.handle = handle;
+		font.faceId = record.faceId;
+		font.size = record.size;
+		font.refCount = record.refCount.load( std::memory_order_relaxed );
 
-			std::stringstream errorMessage;
-			errorMessage << "Could not load system font with family-name: " << familyStyle.family << " and style: " << familyStyle.style;
-			FontManager::checkForFTError( error, errorMessage.str() );
-			return error;
+		{
+			std::lock_guard<std::mutex> lock( record.ownersMutex );
+
+			for( const auto& owner : record.ownerRefCounts ) {
+				if( owner.first <= owners.size() ) {
+					font.owners.push_back( std::make_pair( owners[owner.first - 1], owner.second ) );
+				}
+			}
 		}
+
+		auto familyStyleIt = registry->familyAndStyleForFaceIDs.find( ( FTC_FaceID )( size_t )record.faceId );
+
+		if( familyStyleIt != registry->familyAndStyleForFaceIDs.end() ) {
+			font.family = familyStyleIt->second.family;
+			font.style = familyStyleIt->second.style;
+		}
+
+		usage.push_back( font );
 	}
+
+	return usage;
 }
 
-// Freetype Initialization
-void FontManager::initFreetype()
+std::unordered_map<uint32_t,FontManager::FaceUsage> FontManager::getFaceUsage()
 {
-	// Init Freetype
-	FT_Error error;
-	error = FT_Init_FreeType( &mFTLibrary );
-	checkForFTError( error, "Could not initialize Freetype." );
+	std::unordered_map<uint32_t,FaceUsage> faces;
 
-	// Create Cache Manager
-	error = FTC_Manager_New( mFTLibrary, 0, 0, 0, &FontManager::faceRequestor, NULL, &mFTCacheManager );
-	checkForFTError( error, "Could not initialize FTCacheManager" );
+	{
+		std::lock_guard<std::mutex> lock( mFontRecordsMutex );
 
-	// Create Char Map Cache
-	error = FTC_CMapCache_New( mFTCacheManager, &mFTCMapCache );
-	checkForFTError( error, "Could not initialize FTCMapCache" );
+		for( uint32_t handle = INVALID_FONT_HANDLE + 1; handle < mNumFontRecords; handle++ ) {
+			FontRecord& record = getFontRecord( handle );
+			FaceUsage& face = faces[record.faceId];
+			face.refCount += record.refCount.load( std::memory_order_relaxed );
+			face.lastUse = std::max( face.lastUse, record.lastUse.load( std::memory_order_relaxed ) );
 
-	// Create Image Cache (Glyph Images)
-	error = FTC_ImageCache_New( mFTCacheManager, &mFTCImageCache );
-	checkForFTError( error, "Could not initialize FTCImageCache" );
+			std::lock_guard<std::mutex> recordLock( record.mutex );
+			face.tableBytes += record.glyphMetrics.metrics.capacity() * sizeof( GlyphMetrics ) + record.glyphMetrics.loaded.capacity() / 8;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mGlyphClassTablesMutex );
+
+		for( const auto& table : mGlyphClassTables ) {
+			faces[table.first].tableBytes += table.second->classes.capacity();
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mCharMapTablesMutex );
+
+		for( const auto& table : mCharMapTables ) {
+			faces[table.first].tableBytes += ( table.second->codepoints.capacity() + table.second->glyphs.capacity() ) * sizeof( uint32_t ) + sizeof( table.second->coverage );
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mGlyphPathsMutex );
+
+		for( const auto& table : mGlyphPathTables ) {
+			faces[table.first].tableBytes += table.second->bytes;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mGlyphBitmapsMutex );
+
+		for( const auto& table : mGlyphBitmapTables ) {
+			faces[table.second->faceId].tableBytes += table.second->bytes;
+		}
+	}
+
+	// Buffers can't be read again, only mapped + system font data is unloaded
+	FaceRegistryRef registry = getRegistry();
+	std::unordered_set<FTC_FaceID> bufferFaces;
+
+	for( const auto& buffer : registry->faceIDsForBuffers ) {
+		bufferFaces.insert( buffer.second );
+	}
+
+	for( const auto& faceData : registry->faceDataForFaceIDs ) {
+		if( ! bufferFaces.count( faceData.first ) ) {
+			faces[( uint32_t )( size_t )faceData.first].dataBytes += faceData.second->getSize();
+		}
+	}
+
+	// Instances open over their base face's data, keep it while any instance is used
+	for( const auto& instance : registry->instancesForFaceIDs ) {
+		auto it = faces.find( ( uint32_t )( size_t )instance.first );
+
+		if( it != faces.end() ) {
+			FaceUsage usage = it->second;
+			FaceUsage& base = faces[( uint32_t )( size_t )instance.second.baseId];
+			base.refCount += usage.refCount;
+			base.lastUse = std::max( base.lastUse, usage.lastUse );
+		}
+	}
+
+	return faces;
 }
 
-void FontManager::registerFamilyStyleForFaceID( const FaceFamilyAndStyle& familyStyle, FTC_FaceID id )
+size_t FontManager::unloadUnusedFaces( uint64_t maxBytes )
 {
-	mFamilyAndStyleForFaceIDs[id] = familyStyle;
-	mFaceIDsForFamilyAndStyle[familyStyle] = id;
+	return trimFaces( maxBytes, uint32_t( -1 ) );
 }
 
-size_t FontManager::getFaceId( const ci::fs::path& path )
+size_t FontManager::trimFaces( uint64_t maxBytes, uint32_t keepFaceId )
 {
-	if( mFaceIDsForPaths.count( path.string() ) == 0 ) {
-		loadFace( path );
+	// Read first, a font released during the trim must let the next one run
+	uint64_t useClock = mFontUseClock.load( std::memory_order_relaxed );
+	std::unordered_map<uint32_t,FaceUsage> faces = getFaceUsage();
+
+	uint64_t totalBytes = 0;
+	std::vector<std::pair<uint64_t,uint32_t>> unused;
+
+	for( const auto& face : faces ) {
+		size_t bytes = face.second.tableBytes + face.second.dataBytes;
+		totalBytes += bytes;
+
+		if( face.second.refCount == 0 && face.first != keepFaceId && bytes > 0 ) {
+			unused.emplace_back( face.second.lastUse, face.first );
+		}
+	}
+
+	if( totalBytes <= maxBytes ) {
+		return 0;
+	}
+
+	// Least recently released first
+	std::sort( unused.begin(), unused.end() );
+
+	size_t numUnloaded = 0;
+
+	// The usage is a snapshot, a font may have been created for the face since
+	// New references are only taken under mFontRecordsMutex (see getFontHandle()), so checking + unloading under it can't race one
+	std::lock_guard<std::mutex> lock( mFontRecordsMutex );
+	std::unordered_map<uint32_t,uint32_t> refCounts = getFaceRefCounts();
+
+	for( const auto& face : unused ) {
+		if( totalBytes <= maxBytes ) {
+			break;
+		}
+
+		if( refCounts.count( face.second ) ) {
+			continue;
+		}
+
+		const FaceUsage& usage = faces[face.second];
+		totalBytes -= usage.tableBytes + usage.dataBytes;
+		unloadFace( ( FTC_FaceID )( size_t )face.second );
+		numUnloaded++;
 	}
 
-	return (size_t)mFaceIDsForPaths[path.string()];
+	if( numUnloaded == 0 ) {
+		mStuckTrimUseClock.store( useClock, std::memory_order_relaxed );
+	}
+
+	return numUnloaded;
 }
 
-size_t FontManager::getFaceId( std::string family, std::string style )
+std::unordered_map<uint32_t,uint32_t> FontManager::getFaceRefCounts()
 {
-	FaceFamilyAndStyle familyStyle( family, style );
+	// Instances are registered before a font can reference them, so the current registry lists every instance in use
+	FaceRegistryRef registry = getRegistry();
+	std::unordered_map<uint32_t,uint32_t> refCounts;
+
+	for( uint32_t handle = INVALID_FONT_HANDLE + 1; handle < mNumFontRecords; handle++ ) {
+		FontRecord& record = getFontRecord( handle );
+		uint32_t recordRefCount = record.refCount.load( std::memory_order_relaxed );
 
-	if( mFaceIDsForFamilyAndStyle.count( familyStyle ) == 0 ) {
-		loadFace( familyStyle );
+		if( recordRefCount == 0 ) {
+			continue;
+		}
+
+		refCounts[record.faceId] += recordRefCount;
+		auto it = registry->instancesForFaceIDs.find( ( FTC_FaceID )( size_t )record.faceId );
+
+		if( it != registry->instancesForFaceIDs.end() ) {
+			refCounts[( uint32_t )( size_t )it->second.baseId] += recordRefCount;
+		}
 	}
 
-	return (size_t)mFaceIDsForFamilyAndStyle[familyStyle];
+	return refCounts;
 }
 
-void FontManager::loadFace( const FaceFamilyAndStyle& familyStyle )
+void FontManager::unloadFace( FTC_FaceID id )
 {
-	if( !mFaceIDsForFamilyAndStyle.count( familyStyle ) ) {
-		mNextFaceId++;
+	releaseGlyphMetrics( id );
+	releaseGlyphTables( id );
 
-		FTC_FaceID faceId = ( FTC_FaceID )mNextFaceId;
+	{
+		std::lock_guard<std::mutex> lock( mRegistryMutex );
 
-		registerFamilyStyleForFaceID( familyStyle, faceId );
+		bool isBuffer = false;
+
+		for( const auto& buffer : mRegistry->faceIDsForBuffers ) {
+			isBuffer = isBuffer || buffer.second == id;
+		}
 
-		getFace( (size_t)faceId );
+		// The face keeps its id + names, its font data is mapped or read again when it's next opened
+		if( ! isBuffer && mRegistry->faceDataForFaceIDs.count( id ) ) {
+			auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+			registry->faceDataForFaceIDs.erase( id );
+			publishRegistry( registry );
+		}
 	}
+
+	closeFaceInAllContexts( id );
 }
 
-void FontManager::removeFace( FTC_FaceID id )
+void FontManager::closeFaceInAllContexts( FTC_FaceID id )
 {
-	// Remove family/style cached id
-	if( mFamilyAndStyleForFaceIDs.count( id ) != 0 ) {
-		FaceFamilyAndStyle familyStyle = mFamilyAndStyleForFaceIDs[id];
-		mFaceIDsForFamilyAndStyle.erase( familyStyle );
-		mFamilyAndStyleForFaceIDs.erase( id );
+	// Fonts still shaping with the Harfbuzz face keep it alive until their context flushes it
+	{
+		std::lock_guard<std::mutex> lock( mHarfbuzzFacesMutex );
+		auto it = mHarfbuzzFaces.find( id );
+
+		if( it != mHarfbuzzFaces.end() ) {
+			hb_face_destroy( it->second );
+			mHarfbuzzFaces.erase( it );
+		}
 	}
 
-	// Remove path cached id
-	if( mFacePathsForFaceID.count( id ) != 0 ) {
-		ci::fs::path path = mFacePathsForFaceID[id];
-		mFaceIDsForPaths.erase( path.string() );
-		mFacePathsForFaceID.erase( id );
+	std::lock_guard<std::mutex> lock( mClosedFacesMutex );
+	mClosedFaces.push_back( id );
+	mNumClosedFaces.store( mFirstClosedFace + mClosedFaces.size(), std::memory_order_release );
+}
+
+void FontManager::flushClosedFaces( FreetypeContext& context )
+{
+	if( context.numClosedFaces == mNumClosedFaces.load( std::memory_order_acquire ) ) {
+		return;
 	}
 
-	// Empty face from cache
-	FTC_Manager_RemoveFaceID( mFTCacheManager, id );
+	std::vector<FTC_FaceID> closedFaces;
+
+	{
+		std::lock_guard<std::mutex> lock( mClosedFacesMutex );
+		closedFaces.assign( mClosedFaces.begin() + ( context.numClosedFaces - mFirstClosedFace ), mClosedFaces.end() );
+		context.numClosedFaces = mFirstClosedFace + mClosedFaces.size();
+
+		// Drop the faces every context has removed
+		std::lock_guard<std::mutex> contextsLock( mContextsMutex );
+		size_t numRemoved = context.numClosedFaces;
+
+		for( const auto& other : mContexts ) {
+			numRemoved = std::min( numRemoved, other->numClosedFaces );
+		}
+
+		mClosedFaces.erase( mClosedFaces.begin(), mClosedFaces.begin() + ( numRemoved - mFirstClosedFace ) );
+		mFirstClosedFace = numRemoved;
+	}
+
+	// Harfbuzz fonts keep their face open, release them first
+	for( auto it = context.harfbuzzFonts.begin(); it != context.harfbuzzFonts.end(); ) {
+		if( std::find( closedFaces.begin(), closedFaces.end(), it->second.faceId ) != closedFaces.end() ) {
+			it->second.release();
+			it = context.harfbuzzFonts.erase( it );
+		}
+		else {
+			++it;
+		}
+	}
+
+	// Closes the face + its sizes and drops its cmap + glyph image nodes
+	for( FTC_FaceID id : closedFaces ) {
+		FTC_Manager_RemoveFaceID( context.cacheManager, id );
+	}
+}
+
+FontManager::FontMetrics FontManager::loadFontMetrics( const Font& font )
+{
+	FontMetrics metrics = FontMetrics();
+	metrics.dpi = mResolution;
+	metrics.scaler = makeScaler( font );
+
+	FT_Size size;
+	FT_Error error = lookupSize( &metrics.scaler, &size );
+
+	if( error != FT_Err_Ok ) {
+		std::stringstream errorMessage;
+		errorMessage << "Could not lookup size for face " << font.mFaceId << " at size " << std::to_string( font.mSize ) << ".";
+		checkForFTError( error, errorMessage.str() );
+		return metrics;
+	}
+
+	FT_Face face = size->face;
+	metrics.ascender = size->metrics.ascender / 64.f;
+	metrics.descender = size->metrics.descender / 64.f;
+	metrics.height = size->metrics.height / 64.f;
+	metrics.baseline = abs( face->descender ) * float( font.mSize ) / face->units_per_EM;
+
+	int pixelsX = ::FT_MulFix( ( face->bbox.xMax - face->bbox.xMin ), size->metrics.x_scale );
+	int pixelsY = ::FT_MulFix( ( face->bbox.yMax - face->bbox.yMin ), size->metrics.y_scale );
+	metrics.maxGlyphSize = ci::vec2( pixelsX / 64.f, pixelsY / 64.f );
+
+	return metrics;
+}
+
+void FontManager::loadFace( const ci::DataSourceRef& dataSource, const std::string& family, const std::string& style )
+{
+	if( dataSource->isFilePath() ) {
+		loadFace( dataSource->getFilePath(), family, style );
+	}
+	else {
+		loadFace( dataSource->getBuffer(), family, style );
+	}
+}
+
+void FontManager::loadFace( const ci::fs::path& path, const std::string& family, const std::string& style )
+{
+	if( getRegistry()->faceIDsForPaths.count( path.string() ) ) {
+		return;
+	}
+
+	// Map the file up front, if it can't be mapped the face requestor falls back to opening the path
+	FaceDataRef data = FaceData::create( path );
+	uint64_t contentKey = data ? getContentKey( data, 0 ) : 0;
+
+	FTC_FaceID id;
+	bool alias = false;
+
+	{
+		std::lock_guard<std::mutex> lock( mRegistryMutex );
+
+		// Another thread may have loaded the face while we were waiting
+		if( mRegistry->faceIDsForPaths.count( path.string() ) ) {
+			return;
+		}
+
+		auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+		auto contentIt = data ? registry->faceIDsForContentKeys.find( contentKey ) : registry->faceIDsForContentKeys.end();
+
+		if( contentIt != registry->faceIDsForContentKeys.end() ) {
+			// A copy of a face that's already loaded, the path resolves to it and this mapping is dropped
+			id = contentIt->second;
+			alias = true;
+
+			registry->faceIDsForPaths[path.string()] = id;
+			registry->aliasCountsForFaceIDs[id]++;
+			registry->aliasBytesForFaceIDs[id] += data->getSize();
+		}
+		else {
+			mNextFaceId++;
+
+			uint32_t faceId = mNextFaceId;
+			id = ( FTC_FaceID )faceId;
+
+			// Store the path <---> id relationship
+			registry->faceIDsForPaths[path.string()] = id;
+			registry->facePathsForFaceID[id] = path.string();
+
+			if( data ) {
+				registry->faceDataForFaceIDs[id] = data;
+				registry->faceIDsForContentKeys[contentKey] = id;
+				registry->contentKeysForFaceIDs[id] = contentKey;
+			}
+		}
+
+		publishRegistry( registry );
+	}
+
+	if( alias ) {
+		CI_LOG_I( "Font file " << path << " has the same contents as face " << id << ", sharing it." );
+		registerFamilyStyleAlias( id, family, style );
+		return;
+	}
+
+	registerFamilyStyleFromFace( id, family, style );
+}
+
+void FontManager::loadFace( const ci::BufferRef& buffer, const std::string& family, const std::string& style )
+{
+	if( ! buffer || getRegistry()->faceIDsForBuffers.count( buffer->getData() ) ) {
+		return;
+	}
+
+	FaceDataRef data = FaceData::create( buffer );
+
+	if( ! data ) {
+		CI_LOG_E( "Could not load face from an empty buffer." );
+		return;
+	}
+
+	uint64_t contentKey = getContentKey( data, 0 );
+
+	FTC_FaceID id;
+	bool alias = false;
+
+	{
+		std::lock_guard<std::mutex> lock( mRegistryMutex );
+
+		if( mRegistry->faceIDsForBuffers.count( buffer->getData() ) ) {
+			return;
+		}
+
+		auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+		auto contentIt = registry->faceIDsForContentKeys.find( contentKey );
+
+		if( contentIt != registry->faceIDsForContentKeys.end() ) {
+			// The caller owns the buffer, sharing the face saves the Freetype face, tables + atlas glyphs
+			id = contentIt->second;
+			alias = true;
+
+			registry->faceIDsForBuffers[buffer->getData()] = id;
+			registry->aliasBuffers[buffer->getData()] = buffer;
+			registry->aliasCountsForFaceIDs[id]++;
+			registry->aliasBytesForFaceIDs[id] += data->getSize();
+		}
+		else {
+			mNextFaceId++;
+
+			uint32_t faceId = mNextFaceId;
+			id = ( FTC_FaceID )faceId;
+
+			registry->faceIDsForBuffers[buffer->getData()] = id;
+			registry->faceDataForFaceIDs[id] = data;
+			registry->faceIDsForContentKeys[contentKey] = id;
+			registry->contentKeysForFaceIDs[id] = contentKey;
+		}
+
+		publishRegistry( registry );
+	}
+
+	if( alias ) {
+		CI_LOG_I( "Font buffer has the same contents as face " << id << ", sharing it." );
+		registerFamilyStyleAlias( id, family, style );
+		return;
+	}
+
+	registerFamilyStyleFromFace( id, family, style );
+}
+
+std::shared_future<uint32_t> FontManager::loadFaceAsync( const ci::fs::path& path, const std::string& family, const std::string& style, const std::function<void( uint32_t faceId )>& callback )
+{
+	auto promise = std::make_shared<std::promise<uint32_t>>();
+	std::shared_future<uint32_t> future = promise->get_future().share();
+
+	runOnLoadThread( [this, promise, path, family, style, callback] {
+		uint32_t faceId;
+
+		try {
+			loadFace( path, family, style );
+
+			// Opening the face reads its names and pulls the font tables into the page cache
+			faceId = (uint32_t)getFaceId( path );
+
+			if( ! getFace( ( FTC_FaceID )( size_t )faceId ) ) {
+				throw std::runtime_error( "Could not open font face: " + path.string() );
+			}
+
+			promise->set_value( faceId );
+		}
+		catch( ... ) {
+			promise->set_exception( std::current_exception() );
+			return;
+		}
+
+		// Outside the try, the promise is already satisfied (the load thread catches what the callback throws)
+		if( callback ) {
+			callback( faceId );
+		}
+	} );
+
+	return future;
+}
+
+std::shared_future<void> FontManager::loadFontAsync( const Font& font, const std::function<void( const Font& font )>& callback )
+{
+	auto promise = std::make_shared<std::promise<void>>();
+	std::shared_future<void> future = promise->get_future().share();
+
+	runOnLoadThread( [this, promise, font, callback] {
+		try {
+			// Opens the face at the font's size
+			if( ! getSize( font ) ) {
+				throw std::runtime_error( "Could not load face " + std::to_string( font.getFaceId() ) + " at size " + std::to_string( font.getSize() ) );
+			}
+
+			// Size metrics + glyph classes
+			getLoadedFontRecord( font );
+
+			// Glyph metrics for Basic Latin + Latin-1, the glyphs layouts need first
+			for( auto glyphIndex : getGlyphIndices( font, std::make_pair( uint32_t( 0x0020 ), uint32_t( 0x00FF ) ) ) ) {
+				getGlyphMetrics( font, glyphIndex );
+			}
+
+			promise->set_value();
+		}
+		catch( ... ) {
+			promise->set_exception( std::current_exception() );
+			return;
+		}
+
+		if( callback ) {
+			callback( font );
+		}
+	} );
+
+	return future;
+}
+
+void FontManager::runOnLoadThread( const std::function<void()>& task )
+{
+	{
+		std::lock_guard<std::mutex> lock( mLoadMutex );
+		mLoadTasks.push_back( task );
+
+		if( ! mLoadThread.joinable() ) {
+			mLoadThread = std::thread( &FontManager::loadThreadFn, this );
+		}
+	}
+
+	mLoadCondition.notify_one();
+}
+
+void FontManager::loadThreadFn()
+{
+	while( true ) {
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock( mLoadMutex );
+			mLoadCondition.wait( lock, [this] { return mLoadThreadExiting || ! mLoadTasks.empty(); } );
+
+			if( mLoadTasks.empty() ) {
+				return;
+			}
+
+			task = std::move( mLoadTasks.front() );
+			mLoadTasks.pop_front();
+		}
+
+		// A throwing task (or load callback) mustn't take the load thread and the queued tasks down with it
+		try {
+			task();
+		}
+		catch( const std::exception& exc ) {
+			CI_LOG_E( "Font load task failed: " << exc.what() );
+		}
+		catch( ... ) {
+			CI_LOG_E( "Font load task failed." );
+		}
+	}
+}
+
+void FontManager::loadFontDirectory( const ci::fs::path& directory, const ci::fs::path& indexPath )
+{
+	loadFontIndex( FontIndex::create( directory, indexPath ) );
+}
+
+void FontManager::loadFontIndex( const FontIndexRef& index )
+{
+	if( ! index ) {
+		return;
+	}
+
+	// Intern the names first, the whole index is then registered with a single registry copy
+	std::vector<FontIndex::Entry> entries;
+	std::vector<FaceFamilyAndStyle> familyStyles;
+	std::vector<uint64_t> keys;
+
+	for( size_t i = 0; i < index->getNumEntries(); i++ ) {
+		entries.push_back( index->getEntry( i ) );
+		familyStyles.push_back( FaceFamilyAndStyle( entries.back().family, entries.back().style ) );
+		keys.push_back( getFamilyStyleKey( familyStyles.back() ) );
+	}
+
+	std::lock_guard<std::mutex> lock( mRegistryMutex );
+	auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+
+	for( size_t i = 0; i < entries.size(); i++ ) {
+		const FontIndex::Entry& entry = entries[i];
+		std::string path = entry.path.string();
+
+		// Faces that are already loaded keep their id, the first face for a family + style wins
+		if( ( entry.faceIndex == 0 && registry->faceIDsForPaths.count( path ) ) || registry->faceIDsForFamilyStyleKeys.count( keys[i] ) ) {
+			continue;
+		}
+
+		mNextFaceId++;
+		FTC_FaceID id = ( FTC_FaceID )mNextFaceId;
+
+		// The face requestor maps the file when a face is first used
+		if( entry.faceIndex == 0 ) {
+			registry->faceIDsForPaths[path] = id;
+		}
+		else {
+			registry->faceIndicesForFaceIDs[id] = entry.faceIndex;
+		}
+
+		registry->facePathsForFaceID[id] = path;
+		registry->familyAndStyleForFaceIDs[id] = familyStyles[i];
+		registry->familyStyleKeysForFaceIDs[id] = keys[i];
+		registry->faceIDsForFamilyStyleKeys[keys[i]] = id;
+		registerFaceAttributes( *registry, id, uint32_t( keys[i] >> 32 ), FontIndex::getAttributes( entry ) );
+	}
+
+	publishRegistry( registry );
+}
+
+void FontManager::registerFamilyStyleFromFace( FTC_FaceID id, const std::string& family, const std::string& style )
+{
+	// Load the face family/style values
+	// (outside of the lock, the face requestor needs to read the registry)
+	FT_Face face = getFace( id );
+	FaceFamilyAndStyle familyStyleFromFace( face );
+	FaceFamilyAndStyle familyStyleFromUser( family, style );
+
+	// If user didn't provide a fonts family or style try to use the values in the face
+	std::string f = family.empty() ? familyStyleFromFace.family : familyStyleFromUser.family;
+	std::string s = style.empty() ? familyStyleFromFace.style : familyStyleFromUser.style;
+
+	FaceFamilyAndStyle familyStyle( f, s );
+
+	// Store the family/style <----------> id relationship, the face is matched by its own attributes whatever it's called
+	registerFamilyStyleForFaceID( familyStyle, id, face ? FontIndex::readFaceAttributes( face ) : FaceAttributes::fromStyleName( s ) );
+
+	registerNamedInstances( id, f );
+}
+
+void FontManager::registerFamilyStyleAlias( FTC_FaceID id, const std::string& family, const std::string& style )
+{
+	if( family.empty() && style.empty() ) {
+		return;
+	}
+
+	FaceFamilyAndStyle faceFamilyStyle;
+
+	{
+		FaceRegistryRef registry = getRegistry();
+		auto it = registry->familyAndStyleForFaceIDs.find( id );
+
+		if( it != registry->familyAndStyleForFaceIDs.end() ) {
+			faceFamilyStyle = it->second;
+		}
+	}
+
+	FaceFamilyAndStyle familyStyle( family.empty() ? faceFamilyStyle.family : family, style.empty() ? faceFamilyStyle.style : style );
+	uint64_t key = getFamilyStyleKey( familyStyle );
+
+	std::lock_guard<std::mutex> lock( mRegistryMutex );
+
+	// The face keeps the names it was first loaded with, the first face for a family + style wins
+	if( mRegistry->faceIDsForFamilyStyleKeys.count( key ) ) {
+		return;
+	}
+
+	auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+	registry->faceIDsForFamilyStyleKeys[key] = id;
+	publishRegistry( registry );
+}
+
+namespace {
+
+// Attributes of a variable font's named instance, from its coordinates where it has the axes and its name otherwise
+FaceAttributes getInstanceAttributes( const std::string& name, const FontVariations& variations )
+{
+	// OS/2 width classes as percent of the normal width, the unit of the "wdth" axis
+	static const float widthPercents[] = { 50.f, 62.5f, 75.f, 87.5f, 100.f, 112.5f, 125.f, 150.f, 200.f };
+
+	FaceAttributes attributes = FaceAttributes::fromStyleName( name );
+
+	for( const auto& variation : variations ) {
+		if( variation.tag == FT_MAKE_TAG( 'w', 'g', 'h', 't' ) ) {
+			attributes.weight = uint16_t( std::lround( variation.value ) );
+		}
+		else if( variation.tag == FT_MAKE_TAG( 'w', 'd', 't', 'h' ) ) {
+			auto nearest = std::min_element( std::begin( widthPercents ), std::end( widthPercents ), [&variation]( float a, float b ) { return std::abs( a - variation.value ) < std::abs( b - variation.value ); } );
+			attributes.width = uint16_t( nearest - std::begin( widthPercents ) + 1 );
+		}
+		else if( variation.tag == FT_MAKE_TAG( 'i', 't', 'a', 'l' ) && variation.value >= 0.5f ) {
+			attributes.slant = FaceAttributes::SLANT_ITALIC;
+		}
+		else if( variation.tag == FT_MAKE_TAG( 's', 'l', 'n', 't' ) && variation.value != 0.f && attributes.slant == FaceAttributes::SLANT_UPRIGHT ) {
+			attributes.slant = FaceAttributes::SLANT_OBLIQUE;
+		}
+	}
+
+	return attributes;
+}
+
+// CSS font matching ranks, lower is closer
+// Condensed + normal requests prefer narrower widths before wider ones, expanded requests the opposite
+int getWidthRank( uint16_t requested, uint16_t width )
+{
+	int distance = std::abs( int( width ) - int( requested ) );
+	bool preferred = requested <= 5 ? width <= requested : width >= requested;
+	return preferred ? distance : 16 + distance;
+}
+
+// Italic falls back to oblique before upright, oblique to italic, upright to oblique
+int getSlantRank( FaceAttributes::Slant requested, FaceAttributes::Slant slant )
+{
+	static const int ranks[3][3] = {
+		{ 0, 2, 1 },	// upright: upright, italic, oblique
+		{ 2, 0, 1 },	// italic
+		{ 2, 1, 0 }		// oblique
+	};
+
+	return ranks[std::min<int>( requested, 2 )][std::min<int>( slant, 2 )];
+}
+
+// Between 400 and 500 heavier weights up to 500 come first, then lighter ones, then heavier ones
+// Below 400 lighter weights come first, above 500 heavier weights come first
+int getWeightRank( uint16_t requested, uint16_t weight )
+{
+	int distance = std::abs( int( weight ) - int( requested ) );
+
+	if( requested >= 400 && requested <= 500 ) {
+		if( weight >= requested && weight <= 500 ) {
+			return distance;
+		}
+
+		return ( weight < requested ? 1000 : 2000 ) + distance;
+	}
+
+	bool preferred = requested < 400 ? weight <= requested : weight >= requested;
+	return preferred ? distance : 1000 + distance;
+}
+
+} // anonymous namespace
+
+void FontManager::registerNamedInstances( FTC_FaceID id, const std::string& family )
+{
+	FT_Face face = getFace( id );
+
+	if( ! face || ! FT_HAS_MULTIPLE_MASTERS( face ) ) {
+		return;
+	}
+
+	struct NamedInstance {
+		FTC_FaceID			baseId;
+		FontVariations		instance;
+		std::string			instanceKey;
+		FaceFamilyAndStyle	familyStyle;
+		uint64_t			key;
+		FaceAttributes		attributes;
+	};
+	std::vector<NamedInstance> namedInstances;
+
+	// Resolve every instance first, the registry is copied + published once for all of them
+	for( const auto& namedInstance : getNamedInstances( face ) ) {
+		NamedInstance named;
+
+		if( ! resolveFaceInstance( ( uint32_t )( size_t )id, namedInstance.second, named.baseId, named.instance, named.instanceKey ) ) {
+			return;
+		}
+
+		named.familyStyle = FaceFamilyAndStyle( family, namedInstance.first );
+		named.key = getFamilyStyleKey( named.familyStyle );
+		named.attributes = getInstanceAttributes( namedInstance.first, namedInstance.second );
+		namedInstances.push_back( named );
+	}
+
+	if( namedInstances.empty() ) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock( mRegistryMutex );
+	auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+	bool changed = false;
+
+	for( const auto& named : namedInstances ) {
+		// The default instance is the face itself, and faces that are already loaded keep their family + style
+		if( named.instance.empty() || registry->faceIDsForFamilyStyleKeys.count( named.key ) ) {
+			continue;
+		}
+
+		auto instanceIt = registry->faceIDsForInstanceKeys.find( named.instanceKey );
+		FTC_FaceID instanceFaceId = instanceIt != registry->faceIDsForInstanceKeys.end() ? instanceIt->second : registerFaceInstance( *registry, named.baseId, named.instance, named.instanceKey );
+
+		registry->familyAndStyleForFaceIDs[instanceFaceId] = named.familyStyle;
+		registry->familyStyleKeysForFaceIDs[instanceFaceId] = named.key;
+		registry->faceIDsForFamilyStyleKeys[named.key] = instanceFaceId;
+		registerFaceAttributes( *registry, instanceFaceId, uint32_t( named.key >> 32 ), named.attributes );
+		changed = true;
+	}
+
+	if( changed ) {
+		publishRegistry( registry );
+	}
+}
+
+uint32_t FontManager::getFaceInstanceId( uint32_t faceId, const FontVariations& variations )
+{
+	FTC_FaceID baseId;
+	FontVariations instance;
+	std::string key;
+
+	if( ! resolveFaceInstance( faceId, variations, baseId, instance, key ) ) {
+		if( ! variations.empty() ) {
+			CI_LOG_W( "Face " << faceId << " is not a variable font, ignoring its variations." );
+		}
+
+		return faceId;
+	}
+
+	if( instance.empty() ) {
+		return ( uint32_t )( size_t )baseId;
+	}
+
+	std::lock_guard<std::mutex> lock( mRegistryMutex );
+	auto it = mRegistry->faceIDsForInstanceKeys.find( key );
+
+	if( it != mRegistry->faceIDsForInstanceKeys.end() ) {
+		return ( uint32_t )( size_t )it->second;
+	}
+
+	auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+	FTC_FaceID id = registerFaceInstance( *registry, baseId, instance, key );
+	publishRegistry( registry );
+	return ( uint32_t )( size_t )id;
+}
+
+bool FontManager::resolveFaceInstance( uint32_t faceId, const FontVariations& variations, FTC_FaceID& baseId, FontVariations& instance, std::string& key )
+{
+	baseId = ( FTC_FaceID )( size_t )faceId;
+	FontVariations requested = variations;
+
+	{
+		// An instance of an instance starts from the coordinates of the first
+		FaceRegistryRef registry = getRegistry();
+		auto it = registry->instancesForFaceIDs.find( baseId );
+
+		if( it != registry->instancesForFaceIDs.end() ) {
+			baseId = it->second.baseId;
+			requested.insert( requested.begin(), it->second.variations.begin(), it->second.variations.end() );
+		}
+	}
+
+	FT_Face face = getFace( baseId );
+	FT_MM_Var* mmVar;
+
+	if( ! face || ! FT_HAS_MULTIPLE_MASTERS( face ) || FT_Get_MM_Var( face, &mmVar ) != FT_Err_Ok ) {
+		return false;
+	}
+
+	// Clamp to the axes, the last value for an axis wins and axes at their default are left out
+	instance.clear();
+	key = std::to_string( ( size_t )baseId );
+
+	for( FT_UInt i = 0; i < mmVar->num_axis; i++ ) {
+		const FT_Var_Axis& axis = mmVar->axis[i];
+		auto it = std::find_if( requested.rbegin(), requested.rend(), [&axis]( const FontVariation& variation ) { return variation.tag == axis.tag; } );
+
+		if( it == requested.rend() ) {
+			continue;
+		}
+
+		FT_Fixed value = std::min( std::max( FT_Fixed( std::lround( it->value * 65536.f ) ), axis.minimum ), axis.maximum );
+
+		if( value != axis.def ) {
+			instance.push_back( FontVariation( uint32_t( axis.tag ), value / 65536.f ) );
+			key += ":" + std::to_string( axis.tag ) + "=" + std::to_string( value );
+		}
+	}
+
+	FT_Done_MM_Var( getFreetypeContext().library, mmVar );
+	return true;
+}
+
+FTC_FaceID FontManager::registerFaceInstance( FaceRegistry& registry, FTC_FaceID baseId, const FontVariations& instance, const std::string& key )
+{
+	mNextFaceId++;
+	FTC_FaceID id = ( FTC_FaceID )( size_t )mNextFaceId;
+
+	registry.instancesForFaceIDs[id] = { baseId, instance };
+	registry.faceIDsForInstanceKeys[key] = id;
+
+	// Instances report their face's family + style until they're registered as a named instance
+	auto familyStyleIt = registry.familyAndStyleForFaceIDs.find( baseId );
+
+	if( familyStyleIt != registry.familyAndStyleForFaceIDs.end() ) {
+		registry.familyAndStyleForFaceIDs[id] = familyStyleIt->second;
+	}
+
+	return id;
+}
+
+FontVariations FontManager::getFontVariations( const Font& font )
+{
+	FaceRegistryRef registry = getRegistry();
+	auto it = registry->instancesForFaceIDs.find( ( FTC_FaceID )( size_t )font.mFaceId );
+
+	return it != registry->instancesForFaceIDs.end() ? it->second.variations : FontVariations();
+}
+
+std::vector<FontManager::VariationAxis> FontManager::getVariationAxes( const Font& font )
+{
+	std::vector<VariationAxis> axes;
+	FT_Face face = getFace( font );
+	FT_MM_Var* mmVar;
+
+	if( ! face || ! FT_HAS_MULTIPLE_MASTERS( face ) || FT_Get_MM_Var( face, &mmVar ) != FT_Err_Ok ) {
+		return axes;
+	}
+
+	for( FT_UInt i = 0; i < mmVar->num_axis; i++ ) {
+		const FT_Var_Axis& axis = mmVar->axis[i];
+
+		VariationAxis variationAxis;
+		variationAxis.tag = uint32_t( axis.tag );
+		variationAxis.name = axis.name ? axis.name : "";
+		variationAxis.minimum = axis.minimum / 65536.f;
+		variationAxis.defaultValue = axis.def / 65536.f;
+		variationAxis.maximum = axis.maximum / 65536.f;
+		axes.push_back( variationAxis );
+	}
+
+	FT_Done_MM_Var( getFreetypeContext().library, mmVar );
+	return axes;
+}
+
+std::vector<std::pair<std::string,FontVariations>> FontManager::getNamedInstances( const Font& font )
+{
+	return getNamedInstances( getFace( font ) );
+}
+
+std::vector<std::pair<std::string,FontVariations>> FontManager::getNamedInstances( FT_Face face )
+{
+	std::vector<std::pair<std::string,FontVariations>> namedInstances;
+	FT_MM_Var* mmVar;
+
+	if( ! face || ! FT_HAS_MULTIPLE_MASTERS( face ) || FT_Get_MM_Var( face, &mmVar ) != FT_Err_Ok ) {
+		return namedInstances;
+	}
+
+	for( FT_UInt i = 0; i < mmVar->num_namedstyles; i++ ) {
+		const FT_Var_Named_Style& namedStyle = mmVar->namedstyle[i];
+		std::string name = getSfntName( face, namedStyle.strid );
+
+		if( name.empty() ) {
+			continue;
+		}
+
+		FontVariations variations;
+
+		for( FT_UInt a = 0; a < mmVar->num_axis; a++ ) {
+			variations.push_back( FontVariation( uint32_t( mmVar->axis[a].tag ), namedStyle.coords[a] / 65536.f ) );
+		}
+
+		namedInstances.emplace_back( name, variations );
+	}
+
+	FT_Done_MM_Var( getFreetypeContext().library, mmVar );
+	return namedInstances;
+}
+
+FontManager::FaceMemoryInfo FontManager::getFaceMemoryInfo( const Font& font )
+{
+	FaceMemoryInfo info = FaceMemoryInfo();
+	info.faceId = font.getFaceId();
+
+	std::unordered_map<uint32_t,FaceUsage> faces = getFaceUsage();
+	info.tableBytes = faces[info.faceId].tableBytes;
+	info.refCount = faces[info.faceId].refCount;
+
+	FaceRegistryRef registry = getRegistry();
+	FTC_FaceID id = ( FTC_FaceID )( size_t )font.getFaceId();
+	auto it = registry->faceDataForFaceIDs.find( id );
+
+	if( it != registry->faceDataForFaceIDs.end() ) {
+		info.filePath = it->second->getFilePath();
+		info.memoryMapped = it->second->isMemoryMapped();
+		info.size = it->second->getSize();
+		info.residentBytes = it->second->getResidentBytes();
+	}
+
+	auto aliasIt = registry->aliasCountsForFaceIDs.find( id );
+	info.numAliases = aliasIt != registry->aliasCountsForFaceIDs.end() ? aliasIt->second : 0;
+
+	auto aliasBytesIt = registry->aliasBytesForFaceIDs.find( id );
+	info.savedBytes = aliasBytesIt != registry->aliasBytesForFaceIDs.end() ? aliasBytesIt->second : 0;
+
+	return info;
+}
+
+std::vector<FontManager::FaceMemoryInfo> FontManager::getFaceMemoryReport()
+{
+	std::vector<FaceMemoryInfo> report;
+	std::unordered_map<uint32_t,FaceUsage> faces = getFaceUsage();
+	FaceRegistryRef registry = getRegistry();
+
+	for( const auto& faceData : registry->faceDataForFaceIDs ) {
+		FaceMemoryInfo info;
+		info.faceId = ( uint32_t )( size_t )faceData.first;
+		info.filePath = faceData.second->getFilePath();
+		info.memoryMapped = faceData.second->isMemoryMapped();
+		info.size = faceData.second->getSize();
+		info.residentBytes = faceData.second->getResidentBytes();
+		info.tableBytes = faces[info.faceId].tableBytes;
+		info.refCount = faces[info.faceId].refCount;
+
+		auto aliasIt = registry->aliasCountsForFaceIDs.find( faceData.first );
+		info.numAliases = aliasIt != registry->aliasCountsForFaceIDs.end() ? aliasIt->second : 0;
+
+		auto aliasBytesIt = registry->aliasBytesForFaceIDs.find( faceData.first );
+		info.savedBytes = aliasBytesIt != registry->aliasBytesForFaceIDs.end() ? aliasBytesIt->second : 0;
+
+		report.push_back( info );
+	}
+
+	std::sort( report.begin(), report.end(), []( const FaceMemoryInfo& a, const FaceMemoryInfo& b ) { return a.faceId < b.faceId; } );
+	return report;
+}
+
+// --------------------------------------------------------
+// Freetype Functions
+
+FT_Face FontManager::getFace( const Font& font )
+{
+	return getFace( font.mFaceId );
+}
+
+FT_Face FontManager::getFace( size_t faceId )
+{
+	return getFace( ( FTC_FaceID )faceId );
+}
+
+FT_Face FontManager::getFace( FTC_FaceID faceId )
+{
+	FT_Face face;
+	FT_Error error;
+	FreetypeContext& context = getFreetypeContext();
+	uint64_t misses = context.counters.faceMisses;
+
+	error = FTC_Manager_LookupFace( context.cacheManager, ( FTC_FaceID )faceId, &face );
+
+	if( context.counters.faceMisses == misses ) {
+		context.counters.faceHits++;
+	}
+
+	if( error != FT_Err_Ok ) {
+		std::stringstream errorMessage;
+		errorMessage << "Could not lookup face " << faceId << ".";
+		checkForFTError( error, errorMessage.str() );
+		return NULL;
+	}
+
+	return face;
+}
+
+unsigned int FontManager::getNumGlyphs( const Font& font )
+{
+	ci::app::console() << "Num Glyphs: " << getFace( font )->num_glyphs << std::endl;
+	return getFace( font )->num_glyphs;
+}
+
+FT_Size FontManager::getSize( const Font& font )
+{
+	FT_Size ftSize;
+	FT_Error error;
+	FTC_ScalerRec_ scaler = getScaler( font );
+	error = lookupSize( &scaler, &ftSize );
+
+	if( error != FT_Err_Ok ) {
+		std::stringstream errorMessage;
+		errorMessage << "Could not lookup size for face " << font.mFaceId << " at size " << std::to_string( font.mSize ) << ".";
+		checkForFTError( error, errorMessage.str() );
+		return NULL;
+	}
+
+	return ftSize;
+}
+
+FT_UInt FontManager::getGlyphIndex( const Font& font, FT_UInt32 charCode, FT_Int mapIndex )
+{
+	FreetypeContext& context = getFreetypeContext();
+	return FTC_CMapCache_Lookup( context.cmapCache, ( FTC_FaceID )font.mFaceId, mapIndex, charCode );
+}
+
+FT_Error FontManager::lookupSize( FTC_ScalerRec_* scaler, FT_Size* size )
+{
+	FreetypeContext& context = getFreetypeContext();
+	FT_Error error = FTC_Manager_LookupSize( context.cacheManager, scaler, size );
+
+	if( error != FT_Err_Ok ) {
+		return error;
+	}
+
+	// Sizes we haven't seen yet don't have our finalizer
+	// (the image cache also creates sizes, those count as a miss on our first lookup)
+	if( ( *size )->generic.finalizer == &FontManager::sizeDone ) {
+		context.counters.sizeHits++;
+	}
+	else {
+		( *size )->generic.finalizer = &FontManager::sizeDone;
+		context.counters.sizeMisses++;
+	}
+
+	return error;
+}
+
+hb_font_t* FontManager::getHarfbuzzFont( const Font& font )
+{
+	FreetypeContext& context = getFreetypeContext();
+
+	// Activates the font's size on its face, Harfbuzz reads metrics through the face's active size
+	FT_Size size = getSize( font );
+
+	if( ! size ) {
+		return NULL;
+	}
+
+	FreetypeContext::HarfbuzzFont& harfbuzzFont = context.harfbuzzFonts[font.mHandle];
+
+	bool openType = isOpenTypeShaping();
+
+	// The cache may have closed + reopened the face since, a Freetype font still points to the old one
+	if( harfbuzzFont.font ) {
+		FT_Face harfbuzzFace = hb_ft_font_get_face( harfbuzzFont.font );
+
+		if( harfbuzzFont.openType != openType || ( harfbuzzFace && harfbuzzFace != size->face ) ) {
+			harfbuzzFont.release();
+		}
+	}
+
+	if( ! harfbuzzFont.font ) {
+		harfbuzzFont.faceId = ( FTC_FaceID )( size_t )font.mFaceId;
+		harfbuzzFont.openType = openType;
+
+		hb_face_t* face = openType && FT_IS_SCALABLE( size->face ) ? getHarfbuzzFace( harfbuzzFont.faceId ) : NULL;
+
+		if( face ) {
+			harfbuzzFont.font = hb_font_create( face );
+			hb_ot_font_set_funcs( harfbuzzFont.font );
+
+			// Same scale + ppem hb-ft sets from the size, positions come out in 26.6 pixels either way
+			FT_Size_Metrics& metrics = size->metrics;
+			hb_font_set_scale( harfbuzzFont.font,
+							   (int)( ( (uint64_t)metrics.x_scale * (uint64_t)size->face->units_per_EM + ( 1u << 15 ) ) >> 16 ),
+							   (int)( ( (uint64_t)metrics.y_scale * (uint64_t)size->face->units_per_EM + ( 1u << 15 ) ) >> 16 ) );
+			hb_font_set_ppem( harfbuzzFont.font, metrics.x_ppem, metrics.y_ppem );
+		}
+		else {
+			// Referenced, so the cache evicting the face doesn't leave the font dangling
+			harfbuzzFont.font = hb_ft_font_create_referenced( size->face );
+		}
+
+		// hb-ft reads a variable font's coordinates from the face, set them explicitly so shaping never uses the default instance
+		FontVariations variations = getFontVariations( font );
+
+		if( ! variations.empty() ) {
+			std::vector<hb_variation_t> hbVariations;
+			for( const auto& variation : variations ) {
+				hbVariations.push_back( { variation.tag, variation.value } );
+			}
+			hb_font_set_variations( harfbuzzFont.font, hbVariations.data(), (unsigned int)hbVariations.size() );
+		}
+	}
+
+	return harfbuzzFont.font;
+}
+
+hb_shape_plan_t* FontManager::getHarfbuzzShapePlan( const Font& font, const hb_segment_properties_t& properties, const hb_feature_t* features, unsigned int numFeatures, uint16_t featuresKey )
+{
+	FreetypeContext& context = getFreetypeContext();
+	auto fontIt = context.harfbuzzFonts.find( font.mHandle );
+
+	if( fontIt == context.harfbuzzFonts.end() || ! fontIt->second.font ) {
+		if( ! getHarfbuzzFont( font ) ) {
+			return NULL;
+		}
+
+		fontIt = context.harfbuzzFonts.find( font.mHandle );
+	}
+
+	FreetypeContext::HarfbuzzFont& harfbuzzFont = fontIt->second;
+
+	// Languages are interned by Harfbuzz, the pointer identifies them
+	uint64_t key = uint64_t( properties.script ) << 32 | uint64_t( properties.direction ) << 16 | featuresKey;
+	hb_shape_plan_t*& plan = harfbuzzFont.shapePlans[std::make_pair( (const void*)properties.language, key )];
+
+	if( ! plan ) {
+		// Plans depend on the instance of a variable font too, the font's coordinates are fixed
+		unsigned int numCoords = 0;
+		const int* coords = hb_font_get_var_coords_normalized( harfbuzzFont.font, &numCoords );
+		plan = hb_shape_plan_create_cached2( hb_font_get_face( harfbuzzFont.font ), &properties, features, numFeatures, coords, numCoords, NULL );
+	}
+
+	return plan;
+}
+
+namespace {
+
+// Calls visit( components ) with the glyphs of each ligature in a GSUB lookup of ligature substitutions, extension subtables are followed
+// Reads past the end of the table return zero counts, a malformed table only loses ligatures
+template<typename Visit>
+void forEachLigature( const uint8_t* gsub, size_t size, unsigned int lookupIndex, const Visit& visit )
+{
+	auto read = [gsub, size]( size_t offset ) -> uint32_t { return offset + 2 <= size ? uint32_t( gsub[offset] << 8 | gsub[offset + 1] ) : 0; };
+
+	size_t lookupList = read( 8 );
+
+	if( lookupIndex >= read( lookupList ) ) {
+		return;
+	}
+
+	size_t lookup = lookupList + read( lookupList + 2 + 2 * lookupIndex );
+	uint32_t lookupType = read( lookup );
+	uint32_t numSubtables = read( lookup + 4 );
+
+	for( uint32_t i = 0; i < numSubtables; i++ ) {
+		size_t subtable = lookup + read( lookup + 6 + 2 * i );
+		uint32_t subtableType = lookupType;
+
+		if( lookupType == 7 ) {
+			subtableType = read( subtable + 2 );
+			subtable += read( subtable + 4 ) << 16 | read( subtable + 6 );
+		}
+
+		if( subtableType != 4 || read( subtable ) != 1 ) {
+			continue;
+		}
+
+		// Ligature sets are in the order of their first glyphs in the coverage table
+		size_t coverage = subtable + read( subtable + 2 );
+		uint32_t numSets = read( subtable + 4 );
+		std::vector<uint32_t> firstGlyphs( numSets, 0 );
+
+		if( read( coverage ) == 1 ) {
+			for( uint32_t g = 0; g < read( coverage + 2 ) && g < numSets; g++ ) {
+				firstGlyphs[g] = read( coverage + 4 + 2 * g );
+			}
+		}
+		else if( read( coverage ) == 2 ) {
+			for( uint32_t r = 0; r < read( coverage + 2 ); r++ ) {
+				size_t range = coverage + 4 + 6 * r;
+
+				for( uint32_t glyph = read( range ), index = read( range + 4 ); glyph <= read( range + 2 ) && index < numSets; glyph++, index++ ) {
+					firstGlyphs[index] = glyph;
+				}
+			}
+		}
+
+		std::vector<uint32_t> components;
+
+		for( uint32_t s = 0; s < numSets; s++ ) {
+			size_t set = subtable + read( subtable + 6 + 2 * s );
+
+			for( uint32_t l = 0; l < read( set ); l++ ) {
+				size_t ligature = set + read( set + 2 + 2 * l );
+				uint32_t numComponents = read( ligature + 2 );
+
+				components.assign( 1, firstGlyphs[s] );
+
+				for( uint32_t c = 1; c < numComponents; c++ ) {
+					components.push_back( read( ligature + 4 + 2 * ( c - 1 ) ) );
+				}
+
+				visit( components );
+			}
+		}
+	}
+}
+
+} // anonymous namespace
+
+FontManager::SimpleShapingTable* FontManager::getSimpleShapingTable( const Font& font, const hb_segment_properties_t& properties, uint16_t featuresKey )
+{
+	FreetypeContext& context = getFreetypeContext();
+	auto fontIt = context.harfbuzzFonts.find( font.mHandle );
+
+	if( fontIt == context.harfbuzzFonts.end() || ! fontIt->second.font ) {
+		if( ! getHarfbuzzFont( font ) ) {
+			return NULL;
+		}
+
+		fontIt = context.harfbuzzFonts.find( font.mHandle );
+	}
+
+	FreetypeContext::HarfbuzzFont& harfbuzzFont = fontIt->second;
+
+	uint64_t key = uint64_t( properties.script ) << 32 | uint64_t( properties.direction ) << 16 | featuresKey;
+	auto inserted = harfbuzzFont.simpleShapingTables.emplace( std::piecewise_construct, std::forward_as_tuple( (const void*)properties.language, key ), std::forward_as_tuple() );
+	SimpleShapingTable& table = inserted.first->second;
+
+	if( inserted.second ) {
+		// Contextual substitutions + positioning depend on more than the next glyph, pairs can't represent them
+		// Neither can required ligatures (rlig), they may be as long as the font likes and can't be turned off
+		static const hb_tag_t contextualFeatures[] = { HB_TAG( 'c', 'a', 'l', 't' ), HB_TAG( 'c', 'l', 'i', 'g' ), HB_TAG( 'r', 'c', 'l', 't' ), HB_TAG( 'c', 'u', 'r', 's' ), HB_TAG( 'r', 'l', 'i', 'g' ) };
+		hb_face_t* face = hb_font_get_face( harfbuzzFont.font );
+
+		for( hb_tag_t tableTag : { HB_OT_TAG_GSUB, HB_OT_TAG_GPOS } ) {
+			hb_tag_t tags[64];
+			unsigned int start = 0;
+			unsigned int numTags;
+
+			do {
+				numTags = 64;
+				hb_ot_layout_table_get_feature_tags( face, tableTag, start, &numTags, tags );
+
+				for( unsigned int i = 0; i < numTags; i++ ) {
+					table.contextual |= std::find( std::begin( contextualFeatures ), std::end( contextualFeatures ), tags[i] ) != std::end( contextualFeatures );
+				}
+
+				start += numTags;
+			} while( numTags == 64 );
+		}
+
+		// Shaper sees three characters only around a two character ligature, so a standard ligature (liga) of Latin-1 characters
+		// needs a two character one at its start or end ("ffi" has "ff" + "fi"), and none can be longer than three characters
+		std::set<uint32_t> latinGlyphs;
+
+		for( hb_codepoint_t c = 0x20; c <= 0xFF; c++ ) {
+			hb_codepoint_t glyph;
+
+			if( hb_font_get_nominal_glyph( harfbuzzFont.font, c, &glyph ) ) {
+				latinGlyphs.insert( glyph );
+			}
+		}
+
+		hb_blob_t* gsub = hb_face_reference_table( face, HB_OT_TAG_GSUB );
+		unsigned int gsubSize = 0;
+		const uint8_t* gsubData = (const uint8_t*)hb_blob_get_data( gsub, &gsubSize );
+
+		hb_set_t* lookups = hb_set_create();
+		static const hb_tag_t ligaFeatures[] = { HB_TAG( 'l', 'i', 'g', 'a' ), HB_TAG_NONE };
+		hb_ot_layout_collect_lookups( face, HB_OT_TAG_GSUB, NULL, NULL, ligaFeatures, lookups );
+
+		std::set<std::pair<uint32_t, uint32_t>> pairs;
+		std::vector<std::vector<uint32_t>> triples;
+		hb_codepoint_t lookupIndex = HB_SET_VALUE_INVALID;
+
+		while( hb_set_next( lookups, &lookupIndex ) && ! table.longLigatures ) {
+			forEachLigature( gsubData, gsubSize, lookupIndex, [&]( const std::vector<uint32_t>& components ) {
+				if( std::all_of( components.begin(), components.end(), [&]( uint32_t glyph ) { return latinGlyphs.count( glyph ) > 0; } ) ) {
+					if( components.size() == 2 ) {
+						pairs.emplace( components[0], components[1] );
+					}
+					else if( components.size() == 3 ) {
+						triples.push_back( components );
+					}
+					else if( components.size() > 3 ) {
+						table.longLigatures = true;
+					}
+				}
+			} );
+		}
+
+		for( const auto& triple : triples ) {
+			table.longLigatures |= ! pairs.count( { triple[0], triple[1] } ) && ! pairs.count( { triple[1], triple[2] } );
+		}
+
+		hb_set_destroy( lookups );
+		hb_blob_destroy( gsub );
+	}
+
+	return &table;
+}
+
+void FontManager::setOpenTypeShaping( bool openType )
+{
+	// Every thread recreates its Harfbuzz fonts on their next use
+	mOpenTypeShaping.store( openType, std::memory_order_relaxed );
+
+	// Positions may round differently, runs shaped before don't match anymore
+	std::lock_guard<std::mutex> lock( mShapedRunsMutex );
+	mShapedRuns.clear();
+	mShapedRunOrder.clear();
+	mShapedRunBytes = 0;
+}
+
+void FontManager::ShapedRun::resize( size_t size )
+{
+	indices.resize( size );
+	clusters.resize( size );
+	clusterLengths.resize( size );
+	offsets.resize( size );
+	advances.resize( size );
+}
+
+void FontManager::ShapedRun::append( const ShapedRun& run, uint32_t textOffset )
+{
+	size_t start = size();
+
+	indices.insert( indices.end(), run.indices.begin(), run.indices.end() );
+	clusterLengths.insert( clusterLengths.end(), run.clusterLengths.begin(), run.clusterLengths.end() );
+	offsets.insert( offsets.end(), run.offsets.begin(), run.offsets.end() );
+	advances.insert( advances.end(), run.advances.begin(), run.advances.end() );
+
+	clusters.resize( size() );
+
+	for( size_t i = 0; i < run.size(); i++ ) {
+		clusters[start + i] = run.clusters[i] + textOffset;
+	}
+}
+
+uint64_t FontManager::getShapedRunHash( uint32_t handle, const std::string& text, const std::string& language, Script script, Direction direction, uint16_t features )
+{
+	const uint64_t prime = 0x100000001b3ULL;
+
+	uint64_t hash = std::hash<std::string>()( text );
+	hash = ( hash ^ std::hash<std::string>()( language ) ) * prime;
+	hash = ( hash ^ ( uint64_t( handle ) << 32 | features ) ) * prime;
+	hash = ( hash ^ ( uint64_t( script ) << 32 | uint32_t( direction ) ) ) * prime;
+
+	return hash;
+}
+
+FontManager::ShapedRunRef FontManager::findShapedRun( const Font& font, const std::string& text, const std::string& language, Script script, Direction direction, uint16_t features, bool countLookup )
+{
+	uint64_t hash = getShapedRunHash( font.mHandle, text, language, script, direction, features );
+
+	std::lock_guard<std::mutex> lock( mShapedRunsMutex );
+	auto it = mShapedRuns.find( hash );
+
+	if( it == mShapedRuns.end() ) {
+		mShapedRunMisses += countLookup ? 1 : 0;
+		return nullptr;
+	}
+
+	const ShapedRunEntry& entry = it->second;
+
+	if( entry.handle != font.mHandle || entry.features != features || entry.script != script || entry.direction != direction || entry.language != language || entry.text != text ) {
+		mShapedRunMisses += countLookup ? 1 : 0;
+		return nullptr;
+	}
+
+	mShapedRunOrder.splice( mShapedRunOrder.end(), mShapedRunOrder, entry.order );
+	mShapedRunHits += countLookup ? 1 : 0;
+
+	return entry.glyphs;
+}
+
+void FontManager::countShapedRunLookups( uint64_t hits, uint64_t misses )
+{
+	std::lock_guard<std::mutex> lock( mShapedRunsMutex );
+	mShapedRunHits += hits;
+	mShapedRunMisses += misses;
+}
+
+void FontManager::storeShapedRun( const Font& font, const std::string& text, const std::string& language, Script script, Direction direction, uint16_t features, const ShapedRunRef& glyphs )
+{
+	uint64_t maxBytes = getCacheLimits().maxShapedRunBytes;
+
+	// Entry, map node + order node, roughly
+	size_t bytes = sizeof( ShapedRunEntry ) + sizeof( ShapedRun ) + 64 + text.size() + language.size() + glyphs->getBytes();
+
+	if( bytes > maxBytes ) {
+		return;
+	}
+
+	uint64_t hash = getShapedRunHash( font.mHandle, text, language, script, direction, features );
+
+	std::lock_guard<std::mutex> lock( mShapedRunsMutex );
+
+	// Replaces a run with the same hash, either another thread shaped the same run or the hashes collided
+	auto it = mShapedRuns.find( hash );
+
+	if( it != mShapedRuns.end() ) {
+		eraseShapedRun( it );
+	}
+
+	ShapedRunEntry& entry = mShapedRuns[hash];
+	entry.handle = font.mHandle;
+	entry.faceId = font.mFaceId;
+	entry.features = features;
+	entry.script = script;
+	entry.direction = direction;
+	entry.language = language;
+	entry.text = text;
+	entry.glyphs = glyphs;
+	entry.bytes = bytes;
+	entry.order = mShapedRunOrder.insert( mShapedRunOrder.end(), hash );
+	mShapedRunBytes += bytes;
+
+	trimShapedRuns( maxBytes );
+}
+
+FontManager::ShapingCacheStats FontManager::getShapingCacheStats()
+{
+	ShapingCacheStats stats = ShapingCacheStats();
+
+	std::lock_guard<std::mutex> lock( mShapedRunsMutex );
+	stats.numRuns = mShapedRuns.size();
+	stats.bytes = mShapedRunBytes;
+	stats.hits = mShapedRunHits;
+	stats.misses = mShapedRunMisses;
+	stats.evictions = mShapedRunEvictions;
+
+	return stats;
+}
+
+void FontManager::trimShapedRuns( uint64_t maxBytes )
+{
+	while( uint64_t( mShapedRunBytes ) > maxBytes && ! mShapedRunOrder.empty() ) {
+		eraseShapedRun( mShapedRuns.find( mShapedRunOrder.front() ) );
+		mShapedRunEvictions++;
+	}
+}
+
+void FontManager::eraseShapedRun( std::unordered_map<uint64_t,ShapedRunEntry>::iterator it )
+{
+	mShapedRunBytes -= it->second.bytes;
+	mShapedRunOrder.erase( it->second.order );
+	mShapedRuns.erase( it );
+}
+
+hb_face_t* FontManager::getHarfbuzzFace( FTC_FaceID id )
+{
+	FaceRegistryRef registry = getRegistry();
+
+	// Instances share their base face's data, their coordinates are set on the font
+	auto instanceIt = registry->instancesForFaceIDs.find( id );
+
+	if( instanceIt != registry->instancesForFaceIDs.end() ) {
+		id = instanceIt->second.baseId;
+	}
+
+	std::lock_guard<std::mutex> lock( mHarfbuzzFacesMutex );
+	auto faceIt = mHarfbuzzFaces.find( id );
+
+	if( faceIt != mHarfbuzzFaces.end() ) {
+		return faceIt->second;
+	}
+
+	// Registered when Freetype opened the face, faces opened straight from a path don't have any
+	auto dataIt = registry->faceDataForFaceIDs.find( id );
+
+	if( dataIt == registry->faceDataForFaceIDs.end() ) {
+		return NULL;
+	}
+
+	auto faceIndexIt = registry->faceIndicesForFaceIDs.find( id );
+	unsigned int faceIndex = faceIndexIt != registry->faceIndicesForFaceIDs.end() ? (unsigned int)faceIndexIt->second : 0;
+
+	// The blob reads the font data in place and holds a reference to it, like a Freetype face does
+	const FaceDataRef& data = dataIt->second;
+	hb_blob_t* blob = hb_blob_create( reinterpret_cast<const char*>( data->getData() ), (unsigned int)data->getSize(), HB_MEMORY_MODE_READONLY,
+									  new FaceDataRef( data ), []( void* userData ) { delete static_cast<FaceDataRef*>( userData ); } );
+	hb_face_t* face = hb_face_create( blob, faceIndex );
+	hb_blob_destroy( blob );
+
+	// Shared by every thread's fonts
+	hb_face_make_immutable( face );
+	mHarfbuzzFaces[id] = face;
+
+	return face;
+}
+
+hb_buffer_t* FontManager::acquireHarfbuzzBuffer()
+{
+	FreetypeContext& context = getFreetypeContext();
+
+	if( context.harfbuzzBuffers.empty() ) {
+		hb_buffer_t* buffer = hb_buffer_create();
+		CI_ASSERT_MSG( hb_buffer_allocation_successful( buffer ), "Could not allocate Harfbuzz buffer." );
+		return buffer;
+	}
+
+	hb_buffer_t* buffer = context.harfbuzzBuffers.back();
+	context.harfbuzzBuffers.pop_back();
+	return buffer;
+}
+
+void FontManager::releaseHarfbuzzBuffer( hb_buffer_t* buffer )
+{
+	// Only a few shapers are alive at once, more buffers than that are just memory
+	static const size_t MAX_POOLED_BUFFERS = 8;
+
+	FreetypeContext& context = getFreetypeContext();
+
+	if( context.harfbuzzBuffers.size() < MAX_POOLED_BUFFERS ) {
+		// Keeps the buffer's allocation for the next text
+		hb_buffer_clear_contents( buffer );
+		context.harfbuzzBuffers.push_back( buffer );
+	}
+	else {
+		hb_buffer_destroy( buffer );
+	}
+}
+
+std::vector<FT_UInt> FontManager::getGlyphIndices( const Font& font, std::string string )
+{
+	std::vector<FT_UInt> indices;
+
+	// Get indices for a predetermined group of chars
+	if( !string.empty() ) {
+		for( auto& character : string ) {
+			indices.push_back( getGlyphIndex( font, character, 0 ) );
+		}
+	}
+
+	// Otherwise load all the indices, in codepoint order
+	else {
+		indices = getCharMapTable( font )->glyphs;
+	}
+
+	return indices;
+}
+
+std::vector<uint32_t> FontManager::getGlyphIndices( const Font& font, const std::pair<uint32_t, uint32_t> &unicodeRange )
+{
+	std::vector<FT_UInt> indices;
+	CharMapTableRef table = getCharMapTable( font );
+
+	auto begin = std::lower_bound( table->codepoints.begin(), table->codepoints.end(), unicodeRange.first );
+	auto end = std::upper_bound( begin, table->codepoints.end(), unicodeRange.second );
+
+	indices.assign( table->glyphs.begin() + ( begin - table->codepoints.begin() ), table->glyphs.begin() + ( end - table->codepoints.begin() ) );
+	return indices;
+}
+
+bool FontManager::hasGlyph( const Font& font, uint32_t codepoint )
+{
+	CharMapTableRef table = getCharMapTable( font );
+
+	if( ! table->covers( codepoint ) ) {
+		return false;
+	}
+
+	return std::binary_search( table->codepoints.begin(), table->codepoints.end(), codepoint );
+}
+
+FontManager::CharMapTableRef FontManager::getCharMapTable( const Font& font )
+{
+	{
+		std::lock_guard<std::mutex> lock( mCharMapTablesMutex );
+		auto it = mCharMapTables.find( font.mFaceId );
+
+		if( it != mCharMapTables.end() ) {
+			return it->second;
+		}
+	}
+
+	CharMapTableRef table = loadCharMapTable( font );
+
+	std::lock_guard<std::mutex> lock( mCharMapTablesMutex );
+	return mCharMapTables.emplace( font.mFaceId, table ).first->second;
+}
+
+FontManager::CharMapTableRef FontManager::loadCharMapTable( const Font& font )
+{
+	auto table = std::make_shared<CharMapTable>();
+	table->coverage.fill( 0 );
+
+	FT_Face face = getFace( font );
+
+	if( ! face ) {
+		return table;
+	}
+
+	// Walk the face's charmap once, the cmap cache would do a lookup per codepoint (including unmapped ones)
+	std::vector<std::pair<uint32_t,uint32_t>> mappings;
+	FT_UInt index;
+	FT_ULong character = FT_Get_First_Char( face, &index );
+
+	while( index != 0 ) {
+		mappings.push_back( std::make_pair( uint32_t( character ), uint32_t( index ) ) );
+		character = FT_Get_Next_Char( face, character, &index );
+	}
+
+	std::sort( mappings.begin(), mappings.end() );
+
+	table->codepoints.reserve( mappings.size() );
+	table->glyphs.reserve( mappings.size() );
+
+	for( const auto& mapping : mappings ) {
+		table->codepoints.push_back( mapping.first );
+		table->glyphs.push_back( mapping.second );
+
+		uint32_t block = mapping.first / CharMapTable::CHAR_MAP_BLOCK_SIZE;
+
+		if( block < CharMapTable::CHAR_MAP_NUM_BLOCKS ) {
+			table->coverage[block / 64] |= uint64_t( 1 ) << ( block % 64 );
+		}
+	}
+
+	return table;
+}
+
+FT_Glyph FontManager::getGlyph( const Font& font, unsigned int glyphIndex )
+{
+	//FT_Glyph glyph;
+	FT_Glyph glyph;
+	FT_Error error;
+	FTC_ScalerRec_ scaler = getScaler( font );
+	error = lookupImage( &scaler, FT_LOAD_DEFAULT, glyphIndex, ( FT_Glyph* )&glyph );
+
+	if( error != FT_Err_Ok ) {
+		std::stringstream errorMessage;
+		errorMessage << "Could not get glyph " << glyphIndex << " for face " << font.mFaceId << ".";
+		checkForFTError( error, errorMessage.str() );
+		return NULL;
+	}
+
+	return glyph;
+}
+
+FT_BitmapGlyph FontManager::getGlyphBitmap( const Font& font, unsigned int glyphIndex )
+{
+	//FT_Glyph glyph;
+	FT_BitmapGlyph glyph;
+	FT_Error error;
+	FTC_ScalerRec_ scaler = getScaler( font );
+	error = lookupImage( &scaler, FT_LOAD_RENDER | FT_RENDER_MODE_NORMAL, glyphIndex, ( FT_Glyph* )&glyph );
+
+	if( error != FT_Err_Ok ) {
+		std::stringstream errorMessage;
+		errorMessage << "Could not get glyph " << glyphIndex << " for face " << font.mFaceId << ".";
+		checkForFTError( error, errorMessage.str() );
+		return NULL;
+	}
+
+	return glyph;
+}
+
+FT_Error FontManager::lookupImage( FTC_ScalerRec_* scaler, FT_ULong loadFlags, FT_UInt glyphIndex, FT_Glyph* glyph )
+{
+	FreetypeContext& context = getFreetypeContext();
+	return FTC_ImageCache_LookupScaler( context.imageCache, scaler, loadFlags, glyphIndex, glyph, NULL );
+}
+
+FontManager::GlyphMetrics FontManager::getGlyphMetrics( const Font& font, unsigned int glyphIndex )
+{
+	FontRecord& record = getFontRecord( font );
+
+	{
+		std::lock_guard<std::mutex> lock( record.mutex );
+		GlyphMetricsTable& table = record.glyphMetrics;
+
+		if( glyphIndex < table.loaded.size() && table.loaded[glyphIndex] ) {
+			return table.metrics[glyphIndex];
+		}
+	}
+
+	// Load outside of the lock so other threads can keep reading the table
+	GlyphMetrics metrics = loadGlyphMetrics( font, glyphIndex );
+
+	std::lock_guard<std::mutex> lock( record.mutex );
+	GlyphMetricsTable& table = record.glyphMetrics;
+
+	// Grow the table to fit the glyph, it stays dense by glyph index
+	if( glyphIndex >= table.metrics.size() ) {
+		table.metrics.resize( glyphIndex + 1 );
+		table.loaded.resize( glyphIndex + 1, false );
+	}
+
+	table.metrics[glyphIndex] = metrics;
+	table.loaded[glyphIndex] = true;
+
+	return metrics;
+}
+
+FontManager::GlyphMetrics FontManager::getSubpixelGlyphMetrics( const Font& font, unsigned int glyphIndex, int phase, int numPhases )
+{
+	GlyphMetrics metrics = getGlyphMetrics( font, glyphIndex );
+	FT_Pos shift = getSubpixelShift( phase, numPhases );
+
+	// Empty glyphs (spaces) have nothing to move
+	if( shift == 0 || metrics.bitmapSize.x <= 0 || metrics.bitmapSize.y <= 0 ) {
+		return metrics;
+	}
+
+	// Same grid snapping as loadGlyphMetrics(), with the outline moved right by the shift
+	// (the cbox is stored in whole 1/64ths, so the conversion back is exact)
+	FT_Pos xMin = ( FT_Pos( metrics.cbox.x1 * 64.f ) + shift ) & ~63;
+	FT_Pos xMax = ( FT_Pos( metrics.cbox.x2 * 64.f ) + shift + 63 ) & ~63;
+
+	metrics.bitmapSize.x = int( ( xMax - xMin ) >> 6 );
+	metrics.bitmapOffset.x = int( xMin >> 6 );
+
+	return metrics;
+}
+
+std::vector<uint8_t> FontManager::renderSubpixelGlyph( const Font& font, unsigned int glyphIndex, int phase, int numPhases )
+{
+	GlyphMetrics metrics = getSubpixelGlyphMetrics( font, glyphIndex, phase, numPhases );
+	std::vector<uint8_t> pixels( size_t( std::max( metrics.bitmapSize.x, 0 ) ) * size_t( std::max( metrics.bitmapSize.y, 0 ) ), 0 );
+	FT_Glyph glyph = getGlyph( font, glyphIndex );
+
+	if( pixels.empty() || ! glyph ) {
+		return pixels;
+	}
+
+	if( glyph->format == FT_GLYPH_FORMAT_OUTLINE ) {
+		// The cached outline is shared, render a moved copy
+		const FT_Outline& source = reinterpret_cast<FT_OutlineGlyph>( glyph )->outline;
+		FT_Library library = getFreetypeContext().library;
+		FT_Outline outline;
+
+		if( FT_Outline_New( library, source.n_points, source.n_contours, &outline ) != FT_Err_Ok ) {
+			return pixels;
+		}
+
+		FT_Outline_Copy( &source, &outline );
+
+		// Move by the phase, and so the lower left corner of the bitmap is at the origin
+		FT_Pos bitmapBottom = FT_Pos( metrics.bitmapOffset.y - metrics.bitmapSize.y ) * 64;
+		FT_Outline_Translate( &outline, getSubpixelShift( phase, numPhases ) - FT_Pos( metrics.bitmapOffset.x ) * 64, -bitmapBottom );
+
+		FT_Bitmap bitmap;
+		bitmap.rows = metrics.bitmapSize.y;
+		bitmap.width = metrics.bitmapSize.x;
+		bitmap.pitch = metrics.bitmapSize.x;
+		bitmap.buffer = pixels.data();
+		bitmap.num_grays = 256;
+		bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+		bitmap.palette_mode = 0;
+		bitmap.palette = NULL;
+
+		FT_Error error = FT_Outline_Get_Bitmap( library, &outline, &bitmap );
+		FT_Outline_Done( library, &outline );
+
+		if( error != FT_Err_Ok ) {
+			std::stringstream errorMessage;
+			errorMessage << "Could not render glyph " << glyphIndex << " at subpixel phase " << phase << "/" << numPhases << ".";
+			checkForFTError( error, errorMessage.str() );
+		}
+	}
+	else if( glyph->format == FT_GLYPH_FORMAT_BITMAP ) {
+		// Embedded bitmaps can't be moved, they keep their pixels at the left edge of the (wider) bitmap
+		const FT_Bitmap& source = reinterpret_cast<FT_BitmapGlyph>( glyph )->bitmap;
+
+		int rows = std::min( int( source.rows ), metrics.bitmapSize.y );
+		int width = std::min( int( source.width ), metrics.bitmapSize.x );
+
+		for( int row = 0; row < rows; row++ ) {
+			// A negative pitch stores the rows bottom up
+			const uint8_t* sourceRow = source.pitch > 0 ? source.buffer + row * source.pitch : source.buffer + ( int( source.rows ) - 1 - row ) * -source.pitch;
+			auto pixelRow = pixels.begin() + row * metrics.bitmapSize.x;
+
+			if( source.pixel_mode == FT_PIXEL_MODE_GRAY ) {
+				std::copy( sourceRow, sourceRow + width, pixelRow );
+			}
+			else if( source.pixel_mode == FT_PIXEL_MODE_MONO ) {
+				// 1 bit per pixel, most significant bit first
+				for( int x = 0; x < width; x++ ) {
+					pixelRow[x] = ( sourceRow[x >> 3] & ( 0x80 >> ( x & 7 ) ) ) ? 255 : 0;
+				}
+			}
+		}
+	}
+
+	return pixels;
+}
+
+namespace {
+
+// Glyph coverage is run-length encoded a row at a time. Each token byte holds an op in its top 2 bits and the run length - 1
+// below, so a token covers up to 64 pixels. Coverage is mostly empty or fully covered with short runs of edge values between.
+// Quantized rows are rounded to 16 levels first and pack their literals 2 pixels per byte, low nibble first.
+enum CoverageOp : uint8_t {
+	COVERAGE_ZERO		= 0x00,	// run of 0
+	COVERAGE_FULL		= 0x40,	// run of 255
+	COVERAGE_REPEAT		= 0x80,	// run of the value in the next byte
+	COVERAGE_LITERAL	= 0xC0	// the next run length bytes as they are
+};
+
+const size_t COVERAGE_MAX_RUN = 64;
+
+size_t getCoverageRun( const uint8_t* pixels, size_t count )
+{
+	size_t run = 1;
+
+	while( run < count && run < COVERAGE_MAX_RUN && pixels[run] == pixels[0] ) {
+		run++;
+	}
+
+	return run;
+}
+
+// Rounds coverage to a multiple of 17, 0 + 255 stay exact
+uint8_t quantizeCoverage( uint8_t value )
+{
+	return uint8_t( ( ( value + 8 ) / 17 ) * 17 );
+}
+
+void encodeCoverageRow( const uint8_t* row, size_t width, bool quantized, std::vector<uint8_t>& encoded )
+{
+	size_t x = 0;
+
+	while( x < width ) {
+		uint8_t value = row[x];
+		size_t run = getCoverageRun( row + x, width - x );
+
+		if( value == 0 || value == 255 ) {
+			encoded.push_back( ( value ? COVERAGE_FULL : COVERAGE_ZERO ) | uint8_t( run - 1 ) );
+			x += run;
+		}
+		else if( run >= 3 ) {
+			encoded.push_back( COVERAGE_REPEAT | uint8_t( run - 1 ) );
+			encoded.push_back( value );
+			x += run;
+		}
+		else {
+			// Copy edge values up to the next run that's cheaper to encode
+			size_t end = x + 1;
+
+			while( end < width && end - x < COVERAGE_MAX_RUN && row[end] != 0 && row[end] != 255 && getCoverageRun( row + end, width - end ) < 3 ) {
+				end++;
+			}
+
+			encoded.push_back( COVERAGE_LITERAL | uint8_t( end - x - 1 ) );
+
+			if( quantized ) {
+				for( size_t i = x; i < end; i += 2 ) {
+					uint8_t high = i + 1 < end ? row[i + 1] / 17 : 0;
+					encoded.push_back( uint8_t( row[i] / 17 ) | uint8_t( high << 4 ) );
+				}
+			}
+			else {
+				encoded.insert( encoded.end(), row + x, row + end );
+			}
+
+			x = end;
+		}
+	}
+}
+
+const uint8_t* decodeCoverageRow( const uint8_t* encoded, uint8_t* row, size_t width, bool quantized )
+{
+	size_t x = 0;
+
+	while( x < width ) {
+		uint8_t token = *encoded++;
+		size_t run = size_t( token & 0x3F ) + 1;
+
+		switch( token & 0xC0 ) {
+			case COVERAGE_ZERO:
+				std::memset( row + x, 0, run );
+				break;
+			case COVERAGE_FULL:
+				std::memset( row + x, 255, run );
+				break;
+			case COVERAGE_REPEAT:
+				std::memset( row + x, *encoded++, run );
+				break;
+			default:
+				if( quantized ) {
+					for( size_t i = 0; i < run; i++ ) {
+						row[x + i] = uint8_t( ( ( encoded[i / 2] >> ( ( i & 1 ) * 4 ) ) & 0x0F ) * 17 );
+					}
+
+					encoded += ( run + 1 ) / 2;
+				}
+				else {
+					std::memcpy( row + x, encoded, run );
+					encoded += run;
+				}
+				break;
+		}
+
+		x += run;
+	}
+
+	return encoded;
+}
+
+} // anonymous namespace
+
+FontManager::StoredGlyphBitmap FontManager::storeGlyphBitmap( const Font& font, unsigned int glyphIndex, int phase, int numPhases )
+{
+	const GlyphBitmapTable::Entry* entry;
+	GlyphBitmapTableRef table = getGlyphBitmapEntry( font, glyphIndex, phase, numPhases, entry );
+	return entry->bitmap;
+}
+
+FontManager::StoredGlyphBitmap FontManager::decodeGlyphBitmap( const Font& font, unsigned int glyphIndex, uint8_t* dest, size_t destPitch, int phase, int numPhases )
+{
+	const GlyphBitmapTable::Entry* entry;
+	GlyphBitmapTableRef table = getGlyphBitmapEntry( font, glyphIndex, phase, numPhases, entry );
+
+	// The held table keeps the slab alive if the store evicts it while decoding
+	const uint8_t* encoded = entry->data;
+
+	for( int row = 0; row < entry->bitmap.size.y; row++ ) {
+		encoded = decodeCoverageRow( encoded, dest + row * destPitch, size_t( entry->bitmap.size.x ), table->quantized );
+	}
+
+	return entry->bitmap;
+}
+
+FontManager::GlyphBitmapTableRef FontManager::getGlyphBitmapEntry( const Font& font, unsigned int glyphIndex, int phase, int numPhases, const GlyphBitmapTable::Entry*& entry )
+{
+	uint64_t key = getGlyphBitmapKey( glyphIndex, phase, numPhases );
+
+	{
+		std::lock_guard<std::mutex> lock( mGlyphBitmapsMutex );
+		auto tableIt = mGlyphBitmapTables.find( font.mHandle );
+
+		if( tableIt != mGlyphBitmapTables.end() ) {
+			auto glyphIt = tableIt->second->glyphs.find( key );
+
+			if( glyphIt != tableIt->second->glyphs.end() ) {
+				tableIt->second->lastUse = ++mGlyphBitmapClock;
+				mGlyphBitmapHits++;
+				entry = &glyphIt->second;
+				return tableIt->second;
+			}
+		}
+	}
+
+	// Rasterize outside of the lock, the bitmap is rendered from the cached outline
+	// so the Freetype image cache never holds it
+	GlyphMetrics metrics = getSubpixelGlyphMetrics( font, glyphIndex, phase, numPhases );
+	std::vector<uint8_t> pixels = renderSubpixelGlyph( font, glyphIndex, phase, numPhases );
+	ci::ivec2 size = pixels.empty() ? ci::ivec2( 0 ) : metrics.bitmapSize;
+	uint64_t maxBytes = getCacheLimits().maxGlyphBitmapBytes;
+
+	std::lock_guard<std::mutex> lock( mGlyphBitmapsMutex );
+	GlyphBitmapTableRef& table = mGlyphBitmapTables[font.mHandle];
+
+	if( ! table ) {
+		table = std::make_shared<GlyphBitmapTable>();
+		table->faceId = font.mFaceId;
+		table->quantized = mGlyphBitmapQuantized;
+	}
+
+	// Another thread may have stored the glyph while this one was rendering it
+	auto glyphIt = table->glyphs.find( key );
+
+	if( glyphIt == table->glyphs.end() ) {
+		size_t tableBytes = table->bytes;
+
+		// Encoding is cheap next to rendering, it's done here so it matches the table's encoding
+		if( table->quantized ) {
+			std::transform( pixels.begin(), pixels.end(), pixels.begin(), quantizeCoverage );
+		}
+
+		std::vector<uint8_t> encoded;
+
+		for( int row = 0; row < size.y; row++ ) {
+			encodeCoverageRow( pixels.data() + row * size.x, size_t( size.x ), table->quantized, encoded );
+		}
+
+		GlyphBitmapTable::Entry stored;
+		stored.bitmap.size = size;
+		stored.bitmap.offset = metrics.bitmapOffset;
+		stored.bitmap.encodedBytes = uint32_t( encoded.size() );
+		stored.data = nullptr;
+
+		if( ! encoded.empty() ) {
+			uint8_t* data = table->allocate( encoded.size() );
+			std::memcpy( data, encoded.data(), encoded.size() );
+			stored.data = data;
+		}
+
+		glyphIt = table->glyphs.emplace( key, stored ).first;
+		table->bytes += sizeof( GlyphBitmapTable::Entry );
+		table->rawBytes += pixels.size();
+		table->encodedBytes += encoded.size();
+		mGlyphBitmapBytes += table->bytes - tableBytes;
+		mGlyphBitmapMisses++;
+	}
+
+	table->lastUse = ++mGlyphBitmapClock;
+	entry = &glyphIt->second;
+	GlyphBitmapTableRef ref = table;
+
+	trimGlyphBitmaps( maxBytes );
+	return ref;
+}
+
+FontManager::GlyphBitmapStats FontManager::getGlyphBitmapStats()
+{
+	GlyphBitmapStats stats = GlyphBitmapStats();
+
+	std::lock_guard<std::mutex> lock( mGlyphBitmapsMutex );
+
+	for( const auto& table : mGlyphBitmapTables ) {
+		stats.numGlyphs += table.second->glyphs.size();
+		stats.rawBytes += table.second->rawBytes;
+		stats.encodedBytes += table.second->encodedBytes;
+		stats.bytes += table.second->bytes;
+	}
+
+	stats.bytesPerGlyph = stats.numGlyphs ? float( stats.bytes ) / float( stats.numGlyphs ) : 0.f;
+	stats.hits = mGlyphBitmapHits;
+	stats.misses = mGlyphBitmapMisses;
+	stats.evictions = mGlyphBitmapEvictions;
+
+	return stats;
+}
+
+void FontManager::setGlyphBitmapQuantized( bool quantized )
+{
+	std::lock_guard<std::mutex> lock( mGlyphBitmapsMutex );
+
+	if( quantized != mGlyphBitmapQuantized ) {
+		mGlyphBitmapQuantized = quantized;
+		mGlyphBitmapTables.clear();
+		mGlyphBitmapBytes = 0;
+	}
+}
+
+bool FontManager::isGlyphBitmapQuantized()
+{
+	std::lock_guard<std::mutex> lock( mGlyphBitmapsMutex );
+	return mGlyphBitmapQuantized;
+}
+
+uint8_t* FontManager::GlyphBitmapTable::allocate( size_t size )
+{
+	// Coverage is read a byte at a time, slabs are packed without alignment
+	if( size > BITMAP_BLOCK_SIZE / 4 ) {
+		blocks.emplace_back( new uint8_t[size] );
+		bytes += size;
+		return blocks.back().get();
+	}
+
+	if( blockUsed + size > BITMAP_BLOCK_SIZE ) {
+		blocks.emplace_back( new uint8_t[BITMAP_BLOCK_SIZE] );
+		block = blocks.back().get();
+		blockUsed = 0;
+		bytes += BITMAP_BLOCK_SIZE;
+	}
+
+	uint8_t* data = block + blockUsed;
+	blockUsed += size;
+	return data;
+}
+
+void FontManager::trimGlyphBitmaps( uint64_t maxBytes )
+{
+	// The font that was just used is the most recent, so it goes last
+	while( uint64_t( mGlyphBitmapBytes ) > maxBytes && ! mGlyphBitmapTables.empty() ) {
+		auto oldest = mGlyphBitmapTables.begin();
+
+		for( auto it = mGlyphBitmapTables.begin(); it != mGlyphBitmapTables.end(); ++it ) {
+			if( it->second->lastUse < oldest->second->lastUse ) {
+				oldest = it;
+			}
+		}
+
+		mGlyphBitmapBytes -= oldest->second->bytes;
+		mGlyphBitmapEvictions++;
+		mGlyphBitmapTables.erase( oldest );
+	}
+}
+
+FontManager::GlyphMetrics FontManager::loadGlyphMetrics( const Font& font, unsigned int glyphIndex )
+{
+	// Glyphs that can't be loaded get empty metrics, ci::Rectf and the glm vectors aren't zeroed by their constructors
+	GlyphMetrics metrics;
+	metrics.advance = ci::vec2( 0 );
+	metrics.bearing = ci::vec2( 0 );
+	metrics.cbox = ci::Rectf( 0, 0, 0, 0 );
+	metrics.bitmapSize = ci::ivec2( 0 );
+	metrics.bitmapOffset = ci::ivec2( 0 );
+
+	// Looking up the size activates it on the face, then load the outline without rendering
+	FT_Size size = getSize( font );
+
+	if( ! size ) {
+		return metrics;
+	}
+
+	FT_Face face = size->face;
+	FT_Error error = FT_Load_Glyph( face, glyphIndex, FT_LOAD_DEFAULT );
+
+	if( error != FT_Err_Ok ) {
+		std::stringstream errorMessage;
+		errorMessage << "Could not load metrics for glyph " << glyphIndex << " for face " << font.mFaceId << ".";
+		checkForFTError( error, errorMessage.str() );
+		return metrics;
+	}
+
+	FT_GlyphSlot slot = face->glyph;
+	metrics.advance = ci::vec2( slot->advance.x / 64.f, slot->advance.y / 64.f );
+	metrics.bearing = ci::vec2( slot->metrics.horiBearingX / 64.f, slot->metrics.horiBearingY / 64.f );
+
+	if( slot->format == FT_GLYPH_FORMAT_OUTLINE ) {
+		FT_BBox cbox;
+		FT_Outline_Get_CBox( &slot->outline, &cbox );
+		metrics.cbox = ci::Rectf( cbox.xMin / 64.f, cbox.yMin / 64.f, cbox.xMax / 64.f, cbox.yMax / 64.f );
+
+		// Snap the cbox to the pixel grid the same way the renderer does
+		// to get the bitmap extents
+		FT_Pos xMin = cbox.xMin & ~63;
+		FT_Pos yMin = cbox.yMin & ~63;
+		FT_Pos xMax = ( cbox.xMax + 63 ) & ~63;
+		FT_Pos yMax = ( cbox.yMax + 63 ) & ~63;
+
+		metrics.bitmapSize = ci::ivec2( ( xMax - xMin ) >> 6, ( yMax - yMin ) >> 6 );
+		metrics.bitmapOffset = ci::ivec2( xMin >> 6, yMax >> 6 );
+	}
+	else {
+		// Embedded bitmaps (color emoji, bitmap-only faces) are already rasterized
+		metrics.bitmapSize = ci::ivec2( slot->bitmap.width, slot->bitmap.rows );
+		metrics.bitmapOffset = ci::ivec2( slot->bitmap_left, slot->bitmap_top );
+		metrics.cbox = ci::Rectf( metrics.bitmapOffset.x, metrics.bitmapOffset.y - metrics.bitmapSize.y, metrics.bitmapOffset.x + metrics.bitmapSize.x, metrics.bitmapOffset.y );
+	}
+
+	return metrics;
+}
+
+FontManager::GlyphPathRef FontManager::getGlyphPath( const Font& font, unsigned int glyphIndex )
+{
+	{
+		std::lock_guard<std::mutex> lock( mGlyphPathsMutex );
+		auto tableIt = mGlyphPathTables.find( font.mFaceId );
+
+		if( tableIt != mGlyphPathTables.end() ) {
+			auto pathIt = tableIt->second->paths.find( glyphIndex );
+
+			if( pathIt != tableIt->second->paths.end() ) {
+				tableIt->second->lastUse = ++mGlyphPathClock;
+				mGlyphPathHits++;
+
+				// The ref shares ownership of the table, so the arena outlives an eviction
+				return GlyphPathRef( tableIt->second, &pathIt->second );
+			}
+		}
+	}
+
+	// Decompose outside of the lock so other threads can keep reading paths
+	std::vector<uint8_t> verbs;
+	std::vector<ci::vec2> points;
+	GlyphPath path = loadGlyphPath( font, glyphIndex, verbs, points );
+	uint64_t maxBytes = getCacheLimits().maxPathBytes;
+
+	std::lock_guard<std::mutex> lock( mGlyphPathsMutex );
+	GlyphPathTableRef& table = mGlyphPathTables[font.mFaceId];
+
+	if( ! table ) {
+		table = std::make_shared<GlyphPathTable>();
+	}
+
+	// Another thread may have added the path while this one was loading it
+	auto pathIt = table->paths.find( glyphIndex );
+
+	if( pathIt == table->paths.end() ) {
+		size_t tableBytes = table->bytes;
+		size_t pointBytes = points.size() * sizeof( ci::vec2 );
+
+		if( ! path.empty() ) {
+			uint8_t* data = table->allocate( pointBytes + verbs.size() );
+			std::memcpy( data, points.data(), pointBytes );
+			std::memcpy( data + pointBytes, verbs.data(), verbs.size() );
+			path.points = reinterpret_cast<const ci::vec2*>( data );
+			path.verbs = data + pointBytes;
+		}
+
+		pathIt = table->paths.emplace( glyphIndex, path ).first;
+		table->bytes += sizeof( GlyphPath );
+		mGlyphPathBytes += table->bytes - tableBytes;
+		mGlyphPathMisses++;
+	}
+
+	table->lastUse = ++mGlyphPathClock;
+	GlyphPathRef ref( table, &pathIt->second );
+
+	trimGlyphPaths( maxBytes );
+	return ref;
+}
+
+namespace {
+
+// Collects an outline's segments as GlyphPath verbs + points
+struct GlyphPathBuilder {
+	void addVerb( uint8_t verb ) { verbs->push_back( verb ); }
+	void addPoint( const FT_Vector* point ) { points->push_back( ci::vec2( float( point->x ), float( point->y ) ) ); }
+
+	static int moveTo( const FT_Vector* to, void* user )
+	{
+		GlyphPathBuilder* builder = static_cast<GlyphPathBuilder*>( user );
+
+		// Freetype doesn't report closing a contour, the next one starting closes it
+		if( ! builder->verbs->empty() ) {
+			builder->addVerb( FontManager::GlyphPath::VERB_CLOSE );
+		}
+
+		builder->addVerb( FontManager::GlyphPath::VERB_MOVE );
+		builder->addPoint( to );
+		return 0;
+	}
+
+	static int lineTo( const FT_Vector* to, void* user )
+	{
+		GlyphPathBuilder* builder = static_cast<GlyphPathBuilder*>( user );
+		builder->addVerb( FontManager::GlyphPath::VERB_LINE );
+		builder->addPoint( to );
+		return 0;
+	}
+
+	static int conicTo( const FT_Vector* control, const FT_Vector* to, void* user )
+	{
+		GlyphPathBuilder* builder = static_cast<GlyphPathBuilder*>( user );
+		builder->addVerb( FontManager::GlyphPath::VERB_QUAD );
+		builder->addPoint( control );
+		builder->addPoint( to );
+		return 0;
+	}
+
+	static int cubicTo( const FT_Vector* control1, const FT_Vector* control2, const FT_Vector* to, void* user )
+	{
+		GlyphPathBuilder* builder = static_cast<GlyphPathBuilder*>( user );
+		builder->addVerb( FontManager::GlyphPath::VERB_CUBIC );
+		builder->addPoint( control1 );
+		builder->addPoint( control2 );
+		builder->addPoint( to );
+		return 0;
+	}
+
+	std::vector<uint8_t>*	verbs;
+	std::vector<ci::vec2>*	points;
+};
+
+} // anonymous namespace
+
+FontManager::GlyphPath FontManager::loadGlyphPath( const Font& font, unsigned int glyphIndex, std::vector<uint8_t>& verbs, std::vector<ci::vec2>& points )
+{
+	GlyphPath path = GlyphPath();
+
+	// Freetype only loads glyphs into a face with an active size, even unscaled ones
+	FT_Size size = getSize( font );
+
+	if( ! size ) {
+		return path;
+	}
+
+	FT_Face face = size->face;
+	path.unitsPerEm = face->units_per_EM;
+
+	// Unscaled + unhinted, so the outline is the same for every size
+	FT_Error error = FT_Load_Glyph( face, glyphIndex, FT_LOAD_NO_SCALE | FT_LOAD_NO_BITMAP );
+
+	if( error != FT_Err_Ok ) {
+		std::stringstream errorMessage;
+		errorMessage << "Could not load outline for glyph " << glyphIndex << " for face " << font.mFaceId << ".";
+		checkForFTError( error, errorMessage.str() );
+		return path;
+	}
+
+	FT_GlyphSlot slot = face->glyph;
+
+	if( slot->format != FT_GLYPH_FORMAT_OUTLINE || slot->outline.n_points == 0 ) {
+		return path;
+	}
+
+	GlyphPathBuilder builder;
+	builder.verbs = &verbs;
+	builder.points = &points;
+
+	verbs.reserve( slot->outline.n_points + slot->outline.n_contours );
+	points.reserve( slot->outline.n_points );
+
+	FT_Outline_Funcs funcs;
+	funcs.move_to = GlyphPathBuilder::moveTo;
+	funcs.line_to = GlyphPathBuilder::lineTo;
+	funcs.conic_to = GlyphPathBuilder::conicTo;
+	funcs.cubic_to = GlyphPathBuilder::cubicTo;
+	funcs.shift = 0;
+	funcs.delta = 0;
+
+	error = FT_Outline_Decompose( &slot->outline, &funcs, &builder );
+
+	if( error != FT_Err_Ok ) {
+		std::stringstream errorMessage;
+		errorMessage << "Could not decompose outline for glyph " << glyphIndex << " for face " << font.mFaceId << ".";
+		checkForFTError( error, errorMessage.str() );
+		verbs.clear();
+		points.clear();
+		return path;
+	}
+
+	if( ! verbs.empty() ) {
+		verbs.push_back( GlyphPath::VERB_CLOSE );
+	}
+
+	FT_BBox cbox;
+	FT_Outline_Get_CBox( &slot->outline, &cbox );
+	path.bounds = ci::Rectf( float( cbox.xMin ), float( cbox.yMin ), float( cbox.xMax ), float( cbox.yMax ) );
+	path.numVerbs = uint32_t( verbs.size() );
+	path.numPoints = uint32_t( points.size() );
+
+	return path;
+}
+
+float FontManager::getGlyphPathScale( const Font& font )
+{
+	FT_Size size = getSize( font );
+
+	// x_scale converts font units to 26.6 pixels, in 16.16 fixed point
+	return size ? size->metrics.x_scale / ( 65536.f * 64.f ) : 0.f;
+}
+
+ci::Shape2d FontManager::getGlyphShape( const Font& font, unsigned int glyphIndex )
+{
+	ci::Shape2d shape;
+	GlyphPathRef path = getGlyphPath( font, glyphIndex );
+	float scale = getGlyphPathScale( font );
+
+	auto toPixels = [scale]( const ci::vec2& point ) { return ci::vec2( point.x * scale, -point.y * scale ); };
+	const ci::vec2* points = path->points;
+
+	for( uint32_t i = 0; i < path->numVerbs; i++ ) {
+		switch( path->verbs[i] ) {
+			case GlyphPath::VERB_MOVE:
+				shape.moveTo( toPixels( points[0] ) );
+				points += 1;
+				break;
+			case GlyphPath::VERB_LINE:
+				shape.lineTo( toPixels( points[0] ) );
+				points += 1;
+				break;
+			case GlyphPath::VERB_QUAD:
+				shape.quadTo( toPixels( points[0] ), toPixels( points[1] ) );
+				points += 2;
+				break;
+			case GlyphPath::VERB_CUBIC:
+				shape.curveTo( toPixels( points[0] ), toPixels( points[1] ), toPixels( points[2] ) );
+				points += 3;
+				break;
+			case GlyphPath::VERB_CLOSE:
+				shape.close();
+				break;
+		}
+	}
+
+	return shape;
+}
+
+uint8_t* FontManager::GlyphPathTable::allocate( size_t size )
+{
+	// Keep every path's points aligned
+	size = ( size + 7 ) & ~size_t( 7 );
+
+	if( size > PATH_BLOCK_SIZE / 4 ) {
+		blocks.emplace_back( new uint8_t[size] );
+		bytes += size;
+		return blocks.back().get();
+	}
+
+	if( blockUsed + size > PATH_BLOCK_SIZE ) {
+		blocks.emplace_back( new uint8_t[PATH_BLOCK_SIZE] );
+		block = blocks.back().get();
+		blockUsed = 0;
+		bytes += PATH_BLOCK_SIZE;
+	}
+
+	uint8_t* data = block + blockUsed;
+	blockUsed += size;
+	return data;
+}
+
+void FontManager::trimGlyphPaths( uint64_t maxBytes )
+{
+	// The face that was just used is the most recent, so it goes last
+	while( uint64_t( mGlyphPathBytes ) > maxBytes && ! mGlyphPathTables.empty() ) {
+		auto oldest = mGlyphPathTables.begin();
+
+		for( auto it = mGlyphPathTables.begin(); it != mGlyphPathTables.end(); ++it ) {
+			if( it->second->lastUse < oldest->second->lastUse ) {
+				oldest = it;
+			}
+		}
+
+		mGlyphPathBytes -= oldest->second->bytes;
+		mGlyphPathEvictions++;
+		mGlyphPathTables.erase( oldest );
+	}
+}
+
+ci::vec2 FontManager::getGlyphSize( const Font& font, unsigned int glyphIndex )
+{
+	return ci::vec2( getGlyphMetrics( font, glyphIndex ).bitmapSize );
+}
+
+ci::vec2 FontManager::getMaxGlyphSize( const Font& font )
+{
+	return getFontMetrics( font ).maxGlyphSize;
+}
+
+FTC_ScalerRec_ FontManager::getScaler( const  Font& font )
+{
+	return getFontMetrics( font ).scaler;
+}
+
+FTC_ScalerRec_ FontManager::makeScaler( const Font& font ) const
+{
+	FTC_ScalerRec_ scaler = FTC_ScalerRec();
+	scaler.face_id = ( FTC_FaceID )font.mFaceId;
+	scaler.pixel = 1;
+	scaler.width = float( font.mSize );
+	scaler.height = float( font.mSize );
+	scaler.x_res = ( FT_UInt )mResolution.x;
+	scaler.y_res = ( FT_UInt )mResolution.y;
+
+	return scaler;
+}
+
+void FontManager::initResolution()
+{
+#ifdef CINDER_MSW
+	HDC screen = GetDC( NULL );
+	mResolution.x = GetDeviceCaps( screen, LOGPIXELSX );
+	mResolution.y = GetDeviceCaps( screen, LOGPIXELSY );
+	ReleaseDC( NULL, screen );
+#else
+	mResolution = ci::vec2( 96 );
+#endif
+}
+
+// This function gets called by the cache when a new face_id is requested
+FT_Error FontManager::faceRequestor( FTC_FaceID face_id, FT_Library library, FT_Pointer req_data, FT_Face* aface )
+{
+	FreetypeContext* context = static_cast<FreetypeContext*>( req_data );
+	context->counters.faceMisses++;
+
+	if( ! context->openedFaces.insert( face_id ).second ) {
+		context->counters.faceReopens++;
+	}
+
+	FT_Error error = openFace( face_id, library, aface );
+
+	if( error == FT_Err_Ok ) {
+		( *aface )->generic.finalizer = &FontManager::faceDone;
+	}
+
+	return error;
+}
+
+FT_Error FontManager::openFace( FTC_FaceID face_id, FT_Library library, FT_Face* aface )
+{
+	FaceRegistryRef registry = FontManager::get()->getRegistry();
+
+	FT_Error error;
+
+	// Variable font instances open their base face and move it to the instance's coordinates
+	auto instanceIt = registry->instancesForFaceIDs.find( face_id );
+
+	if( instanceIt != registry->instancesForFaceIDs.end() ) {
+		error = openFace( instanceIt->second.baseId, library, aface );
+
+		if( error == FT_Err_Ok ) {
+			std::stringstream errorMessage;
+			errorMessage << "Could not set the variations of instance " << face_id << ", using the default instance.";
+			FontManager::checkForFTError( applyVariations( library, *aface, instanceIt->second.variations ), errorMessage.str() );
+		}
+
+		return error;
+	}
+
+	auto faceIndexIt = registry->faceIndicesForFaceIDs.find( face_id );
+	FT_Long faceIndex = faceIndexIt != registry->faceIndicesForFaceIDs.end() ? faceIndexIt->second : 0;
+
+	// Open the face over memory mapped or buffer font data, shared by every thread's cache
+	auto dataIt = registry->faceDataForFaceIDs.find( face_id );
+
+	if( dataIt != registry->faceDataForFaceIDs.end() ) {
+		error = openMemoryFace( library, dataIt->second, faceIndex, aface );
+
+		if( error != FT_Err_Ok ) {
+			std::stringstream errorMessage;
+			errorMessage << "Could not load face from font data: " << dataIt->second->getFilePath();
+			FontManager::checkForFTError( error, errorMessage.str() );
+		}
+
+		return error;
+	}
+
+	// Try to load the font from a file
+	auto pathIt = registry->facePathsForFaceID.find( face_id );
+
+	if( pathIt != registry->facePathsForFaceID.end() ) {
+		ci::fs::path fontPath = pathIt->second;
+
+		// Faces registered from a font index are mapped the first time they are used
+		FaceDataRef data = FaceData::create( fontPath );
+
+		if( data != nullptr ) {
+			FontManager::get()->registerFaceData( face_id, data );
+			error = openMemoryFace( library, data, faceIndex, aface );
+		}
+		else {
+			error = FT_New_Face( library,
+								 fontPath.string().c_str(),
+								 faceIndex,
+								 aface );
+		}
+
+		if( error != FT_Err_Ok ) {
+			std::stringstream errorMessage;
+			errorMessage << "Could not load face for font file: " << fontPath;
+			FontManager::checkForFTError( error, errorMessage.str() );
+		}
+
+		return error;
+	}
+
+	// Otherwise try to load it as a system font
+	auto familyStyleIt = registry->familyAndStyleForFaceIDs.find( face_id );
+
+	if( familyStyleIt != registry->familyAndStyleForFaceIDs.end() ) {
+		const FaceFamilyAndStyle& familyStyle = familyStyleIt->second;
+
+		// Map the system font file if the platform can tell where it is, otherwise read its bytes
+		uint32_t systemFaceIndex = 0;
+		ci::fs::path systemFontPath = SystemFonts::get()->getFontPath( familyStyle.family, familyStyle.style, &systemFaceIndex );
+		FaceDataRef data;
+
+		if( ! systemFontPath.empty() ) {
+			data = FaceData::create( systemFontPath );
+			faceIndex = systemFaceIndex;
+		}
+
+		if( data == nullptr ) {
+			data = FaceData::create( SystemFonts::get()->getFontBuffer( familyStyle.family, familyStyle.style ) );
+			faceIndex = 0;
+		}
+
+		if( data != nullptr ) {
+			// Keep the system font bytes, faces reference them for as long as they are open
+			// and other threads can open the face without reading the font again
+			FontManager::get()->registerFaceData( face_id, data, faceIndex );
+			error = openMemoryFace( library, data, faceIndex, aface );
+
+			if( error != FT_Err_Ok ) {
+				std::stringstream errorMessage;
+				errorMessage << "Could not load system font with family-name: " << familyStyle.family << " and style: " << familyStyle.style;
+				FontManager::checkForFTError( error, errorMessage.str() );
+			}
+
+			return error;
+		}
+	}
+
+	return FT_Err_Cannot_Open_Resource;
+}
+
+FT_Error FontManager::applyVariations( FT_Library library, FT_Face face, const FontVariations& variations )
+{
+	FT_MM_Var* mmVar;
+	FT_Error error = FT_Get_MM_Var( face, &mmVar );
+
+	if( error != FT_Err_Ok ) {
+		return error;
+	}
+
+	std::vector<FT_Fixed> coords( mmVar->num_axis );
+
+	for( FT_UInt i = 0; i < mmVar->num_axis; i++ ) {
+		coords[i] = mmVar->axis[i].def;
+
+		for( const auto& variation : variations ) {
+			if( variation.tag == mmVar->axis[i].tag ) {
+				coords[i] = FT_Fixed( std::lround( variation.value * 65536.f ) );
+			}
+		}
+	}
+
+	error = FT_Set_Var_Design_Coordinates( face, mmVar->num_axis, coords.data() );
+	FT_Done_MM_Var( library, mmVar );
+
+	return error;
+}
+
+FT_Error FontManager::openMemoryFace( FT_Library library, const FaceDataRef& data, FT_Long faceIndex, FT_Face* aface )
+{
+	FT_Error error = FT_New_Memory_Face( library, data->getData(), static_cast<FT_Long>( data->getSize() ), faceIndex, aface );
+
+	if( error == FT_Err_Ok ) {
+		// Freetype reads from the bytes until the face is done, hold a reference until then (see faceDone)
+		( *aface )->generic.data = new FaceDataRef( data );
+	}
+
+	return error;
+}
+
+void FontManager::faceDone( void* object )
+{
+	FT_Face face = static_cast<FT_Face>( object );
+	FreetypeContext& context = getFreetypeContext( face );
+
+	if( ! context.closing ) {
+		context.counters.faceEvictions++;
+	}
+
+	delete static_cast<FaceDataRef*>( face->generic.data );
+}
+
+void FontManager::sizeDone( void* object )
+{
+	FT_Size size = static_cast<FT_Size>( object );
+	FreetypeContext& context = getFreetypeContext( size->face );
+
+	if( ! context.closing ) {
+		context.counters.sizeEvictions++;
+	}
+}
+
+// Freetype Initialization
+FontManager::FreetypeContext& FontManager::getFreetypeContext()
+{
+	std::unique_ptr<FreetypeContext>& context = getFreetypeContextStorage();
+
+	if( ! context ) {
+		context.reset( new FreetypeContext( FontManager::get().get() ) );
+	}
+
+	// Faces unloaded or removed on any thread are closed here before the cache is used
+	context->manager->flushClosedFaces( *context );
+
+	return *context;
+}
+
+std::unique_ptr<FontManager::FreetypeContext>& FontManager::getFreetypeContextStorage()
+{
+	// Freetype libraries and caches are not thread safe, give every thread its own
+	static thread_local std::unique_ptr<FreetypeContext> context;
+	return context;
+}
+
+FontManager::FreetypeContext::FreetypeContext( FontManager* manager )
+	: manager( manager )
+	, heapBytes( 0 )
+	, closing( false )
+	, numClosedFaces( 0 )
+{
+	CacheLimits limits = manager->getCacheLimits();
+
+	memory.user = this;
+	memory.alloc = &FreetypeContext::allocate;
+	memory.realloc = &FreetypeContext::reallocate;
+	memory.free = &FreetypeContext::release;
+
+	// Init Freetype, same as FT_Init_FreeType but with our allocator
+	FT_Error error;
+	error = FT_New_Library( &memory, &library );
+	checkForFTError( error, "Could not initialize Freetype." );
+
+	FT_Add_Default_Modules( library );
+	FT_Set_Default_Properties( library );
+
+	// Create Cache Manager
+	error = FTC_Manager_New( library, limits.maxFaces, limits.maxSizes, limits.maxBytes, &FontManager::faceRequestor, this, &cacheManager );
+	checkForFTError( error, "Could not initialize FTCacheManager" );
+
+	// Create Char Map Cache
+	error = FTC_CMapCache_New( cacheManager, &cmapCache );
+	checkForFTError( error, "Could not initialize FTCMapCache" );
+
+	// Create Image Cache (Glyph Images)
+	error = FTC_ImageCache_New( cacheManager, &imageCache );
+	checkForFTError( error, "Could not initialize FTCImageCache" );
+
+	manager->registerFreetypeContext( this );
+}
+
+FontManager::FreetypeContext::~FreetypeContext()
+{
+	// The manager may already be shutting down when the load thread exits, don't go through get()
+	manager->unregisterFreetypeContext( this );
+
+	for( auto& harfbuzzFont : harfbuzzFonts ) {
+		harfbuzzFont.second.release();
+	}
+
+	for( hb_buffer_t* buffer : harfbuzzBuffers ) {
+		hb_buffer_destroy( buffer );
+	}
+
+	// Releases the cmap + image caches and all cached faces and sizes,
+	// faces closed from here on aren't evictions
+	closing = true;
+	FTC_Manager_Done( cacheManager );
+
+	// The library doesn't own our memory record, don't use FT_Done_FreeType
+	FT_Done_Library( library );
+}
+
+void FontManager::FreetypeContext::HarfbuzzFont::release()
+{
+	// Plans point to the font's face without holding it
+	for( auto& plan : shapePlans ) {
+		hb_shape_plan_destroy( plan.second );
+	}
+
+	shapePlans.clear();
+	simpleShapingTables.clear();
+
+	if( font ) {
+		hb_font_destroy( font );
+		font = NULL;
+	}
+}
+
+// Freetype allocations carry their size in front of the block so releases can be counted
+static const size_t FT_ALLOCATION_HEADER_SIZE = 16;
+
+void* FontManager::FreetypeContext::allocate( FT_Memory memory, long size )
+{
+	FreetypeContext* context = static_cast<FreetypeContext*>( memory->user );
+	char* block = static_cast<char*>( malloc( size + FT_ALLOCATION_HEADER_SIZE ) );
+
+	if( ! block ) {
+		return NULL;
+	}
+
+	*reinterpret_cast<long*>( block ) = size;
+	context->heapBytes.fetch_add( size, std::memory_order_relaxed );
+
+	return block + FT_ALLOCATION_HEADER_SIZE;
+}
+
+void* FontManager::FreetypeContext::reallocate( FT_Memory memory, long /*currentSize*/, long newSize, void* block )
+{
+	FreetypeContext* context = static_cast<FreetypeContext*>( memory->user );
+	char* header = block ? static_cast<char*>( block ) - FT_ALLOCATION_HEADER_SIZE : NULL;
+	long previousSize = header ? *reinterpret_cast<long*>( header ) : 0;
+
+	char* newBlock = static_cast<char*>( realloc( header, newSize + FT_ALLOCATION_HEADER_SIZE ) );
+
+	if( ! newBlock ) {
+		return NULL;
+	}
+
+	*reinterpret_cast<long*>( newBlock ) = newSize;
+	context->heapBytes.fetch_add( newSize - previousSize, std::memory_order_relaxed );
+
+	return newBlock + FT_ALLOCATION_HEADER_SIZE;
+}
+
+void FontManager::FreetypeContext::release( FT_Memory memory, void* block )
+{
+	if( ! block ) {
+		return;
+	}
+
+	FreetypeContext* context = static_cast<FreetypeContext*>( memory->user );
+	char* header = static_cast<char*>( block ) - FT_ALLOCATION_HEADER_SIZE;
+
+	context->heapBytes.fetch_sub( *reinterpret_cast<long*>( header ), std::memory_order_relaxed );
+	free( header );
+}
+
+// Cache limits + stats
+void FontManager::setCacheLimits( const CacheLimits& limits )
+{
+	bool freetypeLimitsChanged;
+
+	{
+		std::lock_guard<std::mutex> lock( mContextsMutex );
+		freetypeLimitsChanged = limits.maxFaces != mCacheLimits.maxFaces || limits.maxSizes != mCacheLimits.maxSizes || limits.maxBytes != mCacheLimits.maxBytes;
+		mCacheLimits = limits;
+	}
+
+	// Rebuild this thread's caches with the new limits, only the shared limits changing leaves its FT objects alone
+	std::unique_ptr<FreetypeContext>& context = getFreetypeContextStorage();
+
+	if( context && freetypeLimitsChanged ) {
+		context.reset( new FreetypeContext( this ) );
+	}
+
+	unloadUnusedFaces( limits.maxFaceBytes );
+
+	{
+		std::lock_guard<std::mutex> lock( mShapedRunsMutex );
+		trimShapedRuns( limits.maxShapedRunBytes );
+	}
+}
+
+FontManager::CacheLimits FontManager::getCacheLimits()
+{
+	std::lock_guard<std::mutex> lock( mContextsMutex );
+	return mCacheLimits;
+}
+
+FontManager::CacheStats FontManager::getCacheStats()
+{
+	std::lock_guard<std::mutex> lock( mContextsMutex );
+	CacheStats stats = mRetiredStats;
+
+	for( const auto& context : mContexts ) {
+		context->counters.addTo( stats );
+		stats.heapBytes += context->heapBytes.load( std::memory_order_relaxed );
+	}
+
+	// Outlines are shared by every thread
+	std::lock_guard<std::mutex> pathsLock( mGlyphPathsMutex );
+	stats.pathHits = mGlyphPathHits;
+	stats.pathMisses = mGlyphPathMisses;
+	stats.pathEvictions = mGlyphPathEvictions;
+	stats.pathBytes = mGlyphPathBytes;
+
+	return stats;
+}
+
+void FontManager::resetCacheStats()
+{
+	std::lock_guard<std::mutex> lock( mContextsMutex );
+	mRetiredStats = CacheStats();
+
+	for( const auto& context : mContexts ) {
+		context->counters.reset();
+	}
+
+	std::lock_guard<std::mutex> pathsLock( mGlyphPathsMutex );
+	mGlyphPathHits = 0;
+	mGlyphPathMisses = 0;
+	mGlyphPathEvictions = 0;
+
+	std::lock_guard<std::mutex> bitmapsLock( mGlyphBitmapsMutex );
+	mGlyphBitmapHits = 0;
+	mGlyphBitmapMisses = 0;
+	mGlyphBitmapEvictions = 0;
+
+	std::lock_guard<std::mutex> runsLock( mShapedRunsMutex );
+	mShapedRunHits = 0;
+	mShapedRunMisses = 0;
+	mShapedRunEvictions = 0;
+}
+
+void FontManager::registerFreetypeContext( FreetypeContext* context )
+{
+	// Faces closed before the context existed aren't in its cache, it starts past them
+	std::lock_guard<std::mutex> closedFacesLock( mClosedFacesMutex );
+	std::lock_guard<std::mutex> lock( mContextsMutex );
+	context->numClosedFaces = mFirstClosedFace + mClosedFaces.size();
+	mContexts.push_back( context );
+}
+
+void FontManager::unregisterFreetypeContext( FreetypeContext* context )
+{
+	std::lock_guard<std::mutex> lock( mContextsMutex );
+
+	// Keep the counters of exiting threads
+	context->counters.addTo( mRetiredStats );
+	mContexts.erase( std::remove( mContexts.begin(), mContexts.end(), context ), mContexts.end() );
+}
+
+void FontManager::CacheCounters::reset()
+{
+	faceHits = 0;
+	faceMisses = 0;
+	faceReopens = 0;
+	faceEvictions = 0;
+	sizeHits = 0;
+	sizeMisses = 0;
+	sizeEvictions = 0;
+}
+
+void FontManager::CacheCounters::addTo( CacheStats& stats ) const
+{
+	stats.faceHits += faceHits;
+	stats.faceMisses += faceMisses;
+	stats.faceReopens += faceReopens;
+	stats.faceEvictions += faceEvictions;
+	stats.sizeHits += sizeHits;
+	stats.sizeMisses += sizeMisses;
+	stats.sizeEvictions += sizeEvictions;
+}
+
+void FontManager::publishRegistry( const std::shared_ptr<FaceRegistry>& registry )
+{
+	// Same font data getFaceUsage() counts as unloadable, buffers can't be read again
+	std::unordered_set<FTC_FaceID> bufferFaces;
+
+	for( const auto& buffer : registry->faceIDsForBuffers ) {
+		bufferFaces.insert( buffer.second );
+	}
+
+	registry->dataBytes = 0;
+
+	for( const auto& faceData : registry->faceDataForFaceIDs ) {
+		if( ! bufferFaces.count( faceData.first ) ) {
+			registry->dataBytes += faceData.second->getSize();
+		}
+	}
+
+	std::atomic_store( &mRegistry, FaceRegistryRef( registry ) );
+}
+
+void FontManager::registerFaceData( FTC_FaceID id, const FaceDataRef& data, FT_Long faceIndex )
+{
+	uint64_t contentKey = getContentKey( data, faceIndex );
+
+	std::lock_guard<std::mutex> lock( mRegistryMutex );
+
+	if( mRegistry->faceDataForFaceIDs.count( id ) ) {
+		return;
+	}
+
+	auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+	registry->faceDataForFaceIDs[id] = data;
+
+	if( faceIndex != 0 ) {
+		registry->faceIndicesForFaceIDs[id] = faceIndex;
+	}
+
+	// Faces mapped when first used (system fonts, font indices) already have an id,
+	// only copies loaded after this one can resolve to it
+	if( ! registry->contentKeysForFaceIDs.count( id ) && registry->faceIDsForContentKeys.emplace( contentKey, id ).second ) {
+		registry->contentKeysForFaceIDs[id] = contentKey;
+	}
+
+	publishRegistry( registry );
+}
+
+void FontManager::registerFamilyStyleForFaceID( const FaceFamilyAndStyle& familyStyle, FTC_FaceID id, const FaceAttributes& attributes )
+{
+	uint64_t key = getFamilyStyleKey( familyStyle );
+
+	std::lock_guard<std::mutex> lock( mRegistryMutex );
+
+	auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+	registry->familyAndStyleForFaceIDs[id] = familyStyle;
+	registry->familyStyleKeysForFaceIDs[id] = key;
+	registry->faceIDsForFamilyStyleKeys[key] = id;
+	registerFaceAttributes( *registry, id, uint32_t( key >> 32 ), attributes );
+	publishRegistry( registry );
+}
+
+void FontManager::registerFaceAttributes( FaceRegistry& registry, FTC_FaceID id, uint32_t familyId, const FaceAttributes& attributes )
+{
+	unregisterFaceAttributes( registry, id );
+
+	uint64_t key = getAttributeKey( familyId, attributes );
+	registry.attributesForFaceIDs[id] = attributes;
+	registry.attributeKeysForFaceIDs[id] = key;
+	registry.faceIDsForAttributeKeys.emplace( key, id );
+	registry.faceIDsForFamilyIds[familyId].push_back( id );
+}
+
+void FontManager::unregisterFaceAttributes( FaceRegistry& registry, FTC_FaceID id )
+{
+	auto keyIt = registry.attributeKeysForFaceIDs.find( id );
+
+	if( keyIt == registry.attributeKeysForFaceIDs.end() ) {
+		return;
+	}
+
+	uint64_t key = keyIt->second;
+	uint32_t familyId = uint32_t( key >> 32 );
+	std::vector<FTC_FaceID>& family = registry.faceIDsForFamilyIds[familyId];
+	family.erase( std::remove( family.begin(), family.end(), id ), family.end() );
+
+	registry.attributeKeysForFaceIDs.erase( keyIt );
+	registry.attributesForFaceIDs.erase( id );
+
+	// Another face of the family with the same attributes takes over the exact match
+	auto exactIt = registry.faceIDsForAttributeKeys.find( key );
+
+	if( exactIt != registry.faceIDsForAttributeKeys.end() && exactIt->second == id ) {
+		registry.faceIDsForAttributeKeys.erase( exactIt );
+
+		for( FTC_FaceID faceId : family ) {
+			if( registry.attributeKeysForFaceIDs[faceId] == key ) {
+				registry.faceIDsForAttributeKeys[key] = faceId;
+				break;
+			}
+		}
+	}
+
+	if( family.empty() ) {
+		registry.faceIDsForFamilyIds.erase( familyId );
+	}
+}
+
+bool FontManager::findNearestFace( const FaceRegistry& registry, uint32_t familyId, const FaceAttributes& attributes, FTC_FaceID& id )
+{
+	auto familyIt = registry.faceIDsForFamilyIds.find( familyId );
+
+	if( familyIt == registry.faceIDsForFamilyIds.end() ) {
+		return false;
+	}
+
+	bool found = false;
+	std::tuple<int,int,int> best;
+
+	for( FTC_FaceID faceId : familyIt->second ) {
+		const FaceAttributes& face = registry.attributesForFaceIDs.at( faceId );
+		auto rank = std::make_tuple( getWidthRank( attributes.width, face.width ), getSlantRank( attributes.slant, face.slant ), getWeightRank( attributes.weight, face.weight ) );
+
+		if( ! found || rank < best ) {
+			best = rank;
+			id = faceId;
+			found = true;
+		}
+	}
+
+	return found;
+}
+
+uint32_t FontManager::matchFace( uint32_t familyId, const FaceAttributes& attributes, uint32_t styleId )
+{
+	FaceRegistryRef registry = getRegistry();
+
+	// The face registered under the style name, if it's the one with the attributes
+	if( styleId != INVALID_NAME_ID ) {
+		auto styleIt = registry->faceIDsForFamilyStyleKeys.find( getFamilyStyleKey( familyId, styleId ) );
+
+		if( styleIt != registry->faceIDsForFamilyStyleKeys.end() ) {
+			auto attributesIt = registry->attributesForFaceIDs.find( styleIt->second );
+
+			if( attributesIt != registry->attributesForFaceIDs.end() && attributesIt->second == attributes ) {
+				return ( uint32_t )( size_t )styleIt->second;
+			}
+		}
+	}
+
+	auto exactIt = registry->faceIDsForAttributeKeys.find( getAttributeKey( familyId, attributes ) );
+
+	if( exactIt != registry->faceIDsForAttributeKeys.end() ) {
+		return ( uint32_t )( size_t )exactIt->second;
+	}
+
+	// A family without faces can only come from the system fonts, load it by the style name as before
+	uint32_t styleNameId = internName( attributes.getStyleName() );
+
+	if( ! registry->faceIDsForFamilyIds.count( familyId ) ) {
+		return getFaceId( familyId, styleNameId );
+	}
+
+	// System families may have the style without it being loaded yet, each style name is only tried once
+	if( registry->systemFamilyIds.count( familyId ) && ! registry->faceIDsForFamilyStyleKeys.count( getFamilyStyleKey( familyId, styleNameId ) ) ) {
+		loadFace( FaceFamilyAndStyle( getInternedName( familyId ), getInternedName( styleNameId ) ) );
+		registry = getRegistry();
+	}
+
+	FTC_FaceID id;
+
+	if( findNearestFace( *registry, familyId, attributes, id ) ) {
+		return ( uint32_t )( size_t )id;
+	}
+
+	return getFaceId( familyId, styleNameId );
+}
+
+FaceAttributes FontManager::getFaceAttributes( const Font& font )
+{
+	FTC_FaceID id = ( FTC_FaceID )( size_t )font.getFaceId();
+
+	{
+		FaceRegistryRef registry = getRegistry();
+		auto it = registry->attributesForFaceIDs.find( id );
+
+		if( it != registry->attributesForFaceIDs.end() ) {
+			return it->second;
+		}
+	}
+
+	// Unnamed variable font instances aren't matched by attributes, read them from the face
+	FT_Face face = getFace( font );
+	return face ? FontIndex::readFaceAttributes( face ) : FaceAttributes();
+}
+
+uint64_t FontManager::getFamilyStyleKey( const FaceFamilyAndStyle& familyStyle )
+{
+	return getFamilyStyleKey( internName( familyStyle.family ), internName( familyStyle.style ) );
+}
+
+size_t FontManager::getFaceId( const ci::fs::path& path )
+{
+	if( getRegistry()->faceIDsForPaths.count( path.string() ) == 0 ) {
+		loadFace( path );
+	}
+
+	FaceRegistryRef registry = getRegistry();
+	return (size_t)registry->faceIDsForPaths.at( path.string() );
+}
+
+size_t FontManager::getFaceId( const ci::BufferRef& buffer )
+{
+	if( getRegistry()->faceIDsForBuffers.count( buffer->getData() ) == 0 ) {
+		loadFace( buffer );
+	}
+
+	FaceRegistryRef registry = getRegistry();
+	return (size_t)registry->faceIDsForBuffers.at( buffer->getData() );
+}
+
+size_t FontManager::getFaceId( std::string family, std::string style )
+{
+	return getFaceId( internName( family ), internName( style ) );
+}
+
+uint32_t FontManager::getFaceId( uint32_t familyId, uint32_t styleId )
+{
+	uint64_t key = getFamilyStyleKey( familyId, styleId );
+
+	{
+		FaceRegistryRef registry = getRegistry();
+		auto it = registry->faceIDsForFamilyStyleKeys.find( key );
+
+		if( it != registry->faceIDsForFamilyStyleKeys.end() ) {
+			return (uint32_t)( size_t )it->second;
+		}
+
+		// Another spelling of a style the family has, without trying to load it from the system
+		bool recognized;
+		FaceAttributes attributes = FaceAttributes::fromStyleName( getInternedName( styleId ), &recognized );
+		auto attributesIt = registry->faceIDsForAttributeKeys.find( getAttributeKey( familyId, attributes ) );
+
+		if( recognized && attributesIt != registry->faceIDsForAttributeKeys.end() ) {
+			return (uint32_t)( size_t )attributesIt->second;
+		}
+	}
+
+	loadFace( FaceFamilyAndStyle( getInternedName( familyId ), getInternedName( styleId ) ) );
+
+	FaceRegistryRef registry = getRegistry();
+	return (uint32_t)( size_t )registry->faceIDsForFamilyStyleKeys.at( key );
+}
+
+void FontManager::loadFace( const FaceFamilyAndStyle& familyStyle )
+{
+	FTC_FaceID faceId;
+	uint64_t key = getFamilyStyleKey( familyStyle );
+
+	{
+		std::lock_guard<std::mutex> lock( mRegistryMutex );
+
+		if( mRegistry->faceIDsForFamilyStyleKeys.count( key ) ) {
+			return;
+		}
+
+		mNextFaceId++;
+
+		faceId = ( FTC_FaceID )mNextFaceId;
+
+		auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+		registry->familyAndStyleForFaceIDs[faceId] = familyStyle;
+		registry->familyStyleKeysForFaceIDs[faceId] = key;
+		registry->faceIDsForFamilyStyleKeys[key] = faceId;
+		registry->systemFamilyIds.insert( uint32_t( key >> 32 ) );
+		publishRegistry( registry );
+	}
+
+	FT_Face face = getFace( faceId );
+
+	// The system can return a different face than the style that was asked for, it's matched by its own attributes.
+	// Faces that couldn't be loaded aren't matched at all.
+	if( face ) {
+		FaceAttributes attributes = FontIndex::readFaceAttributes( face );
+
+		std::lock_guard<std::mutex> lock( mRegistryMutex );
+		auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+		registerFaceAttributes( *registry, faceId, uint32_t( key >> 32 ), attributes );
+		publishRegistry( registry );
+	}
+}
+
+void FontManager::removeFace( FTC_FaceID id )
+{
+	releaseFaceTables( id );
+
+	std::vector<FTC_FaceID> removedInstances;
+
+	{
+		std::lock_guard<std::mutex> lock( mRegistryMutex );
+		auto registry = std::make_shared<FaceRegistry>( *mRegistry );
+
+		// Remove family/style cached id
+		auto keyIt = registry->familyStyleKeysForFaceIDs.find( id );
+
+		if( keyIt != registry->familyStyleKeysForFaceIDs.end() ) {
+			registry->faceIDsForFamilyStyleKeys.erase( keyIt->second );
+			registry->familyStyleKeysForFaceIDs.erase( keyIt );
+		}
+
+		registry->familyAndStyleForFaceIDs.erase( id );
+		unregisterFaceAttributes( *registry, id );
+
+		// Drop the font data, faces that are still open keep their own reference
+		registry->faceDataForFaceIDs.erase( id );
+
+		for( auto it = registry->faceIDsForBuffers.begin(); it != registry->faceIDsForBuffers.end(); ) {
+			if( it->second == id ) {
+				registry->aliasBuffers.erase( it->first );
+				it = registry->faceIDsForBuffers.erase( it );
+			}
+			else {
+				++it;
+			}
+		}
+
+		// Remove path cached ids, including the paths of copies that resolved to the face
+		for( auto it = registry->faceIDsForPaths.begin(); it != registry->faceIDsForPaths.end(); ) {
+			if( it->second == id ) {
+				it = registry->faceIDsForPaths.erase( it );
+			}
+			else {
+				++it;
+			}
+		}
+
+		registry->facePathsForFaceID.erase( id );
+
+		// Remove content cached id
+		auto contentIt = registry->contentKeysForFaceIDs.find( id );
+
+		if( contentIt != registry->contentKeysForFaceIDs.end() ) {
+			registry->faceIDsForContentKeys.erase( contentIt->second );
+			registry->contentKeysForFaceIDs.erase( contentIt );
+		}
+
+		registry->aliasCountsForFaceIDs.erase( id );
+		registry->aliasBytesForFaceIDs.erase( id );
+
+		// Instances can't be opened without their face
+		for( auto it = registry->faceIDsForInstanceKeys.begin(); it != registry->faceIDsForInstanceKeys.end(); ) {
+			if( it->second == id || registry->instancesForFaceIDs.at( it->second ).baseId == id ) {
+				FTC_FaceID instanceId = it->second;
+				removedInstances.push_back( instanceId );
+				registry->instancesForFaceIDs.erase( instanceId );
+
+				// Named instances are styles of the family
+				auto instanceKeyIt = registry->familyStyleKeysForFaceIDs.find( instanceId );
+
+				if( instanceKeyIt != registry->familyStyleKeysForFaceIDs.end() ) {
+					registry->faceIDsForFamilyStyleKeys.erase( instanceKeyIt->second );
+					registry->familyStyleKeysForFaceIDs.erase( instanceKeyIt );
+				}
+
+				registry->familyAndStyleForFaceIDs.erase( instanceId );
+				unregisterFaceAttributes( *registry, instanceId );
+				it = registry->faceIDsForInstanceKeys.erase( it );
+			}
+			else {
+				++it;
+			}
+		}
+
+		registry->faceIndicesForFaceIDs.erase( id );
+
+		publishRegistry( registry );
+	}
+
+	// Empty the face from every thread's cache
+	closeFaceInAllContexts( id );
+
+	for( FTC_FaceID instanceId : removedInstances ) {
+		if( instanceId != id ) {
+			releaseFaceTables( instanceId );
+			closeFaceInAllContexts( instanceId );
+		}
+	}
+}
+
+void FontManager::releaseFaceTables( FTC_FaceID id )
+{
+	{
+		std::lock_guard<std::mutex> lock( mFontRecordsMutex );
+		releaseGlyphMetrics( id );
+	}
+
+	releaseGlyphTables( id );
+}
+
+void FontManager::releaseGlyphMetrics( FTC_FaceID id )
+{
+	// Release the glyph metrics for every size of the face
+	// The size metrics are left for fonts that still hold the handle
+	for( uint32_t handle = 0; handle < mNumFontRecords; handle++ ) {
+		FontRecord& record = getFontRecord( handle );
+
+		if( ( FTC_FaceID )( size_t )record.faceId == id ) {
+			std::lock_guard<std::mutex> recordLock( record.mutex );
+			record.glyphMetrics = GlyphMetricsTable();
+		}
+	}
+}
+
+void FontManager::releaseGlyphTables( FTC_FaceID id )
+{
+	{
+		std::lock_guard<std::mutex> lock( mGlyphClassTablesMutex );
+		mGlyphClassTables.erase( ( uint32_t )( size_t )id );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mCharMapTablesMutex );
+		mCharMapTables.erase( ( uint32_t )( size_t )id );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mGlyphPathsMutex );
+		auto it = mGlyphPathTables.find( ( uint32_t )( size_t )id );
+
+		if( it != mGlyphPathTables.end() ) {
+			mGlyphPathBytes -= it->second->bytes;
+			mGlyphPathTables.erase( it );
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mGlyphBitmapsMutex );
+
+		for( auto it = mGlyphBitmapTables.begin(); it != mGlyphBitmapTables.end(); ) {
+			if( ( FTC_FaceID )( size_t )it->second->faceId == id ) {
+				mGlyphBitmapBytes -= it->second->bytes;
+				it = mGlyphBitmapTables.erase( it );
+			}
+			else {
+				++it;
+			}
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( mShapedRunsMutex );
+
+		for( auto it = mShapedRuns.begin(); it != mShapedRuns.end(); ) {
+			auto next = std::next( it );
+
+			if( ( FTC_FaceID )( size_t )it->second.faceId == id ) {
+				eraseShapedRun( it );
+			}
+
+			it = next;
+		}
+	}
 }
 
 // Error Checking
-void FontManager::checkForFTError( FT_Error error, std::string description )
+void FontManager::checkForFTError( FT_Error error, const std::string& description )
 {
 	if( error != FT_Err_Ok ) {
 		std::stringstream ss;
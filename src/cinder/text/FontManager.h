@@ -1,17 +1,41 @@
 #pragma once
 
 #include "cinder/Filesystem.h"
+#include "cinder/Rect.h"
+#include "cinder/Shape2d.h"
 #include "cinder/Vector.h"
 #include "cinder/app/App.h"
+#include "cinder/text/FaceData.h"
 #include "cinder/text/Font.h"
-
+#include "cinder/text/FontIndex.h"
+#include "cinder/text/Types.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <freetype/ft2build.h>
 #include FT_FREETYPE_H
 #include <freetype/ftcache.h>
 
+// Harfbuzz forward declarations
+typedef struct hb_buffer_t hb_buffer_t;
+typedef struct hb_face_t hb_face_t;
+typedef struct hb_feature_t hb_feature_t;
+typedef struct hb_font_t hb_font_t;
+typedef struct hb_segment_properties_t hb_segment_properties_t;
+typedef struct hb_shape_plan_t hb_shape_plan_t;
+
 namespace cinder { namespace text {
 
 class FontManager;
@@ -23,7 +47,7 @@ typedef std::shared_ptr<FontManager> FontManagerRef;
 struct FaceFamilyAndStyle {
 	FaceFamilyAndStyle() = default;
 	FaceFamilyAndStyle( FT_Face face )
-		: FaceFamilyAndStyle( face->family_name, face->style_name )
+		: FaceFamilyAndStyle( face && face->family_name ? face->family_name : "", face && face->style_name ? face->style_name : "" )
 	{}
 	FaceFamilyAndStyle( std::string family, std::string style )
 		: family( family )
@@ -74,37 +98,384 @@ struct hash<cinder::text::FaceFamilyAndStyle> {
 
 namespace cinder { namespace text {
 
+// FontManager is safe to use from multiple threads
+// Each thread gets its own Freetype library + caches, so FT_Face, FT_Size and
+// FT_Glyph objects returned here belong to (and should only be used on) the calling thread
 class FontManager
 {
 	friend struct Font;
 	
   public:
-	static FontManagerRef get();
+	// Glyph metrics read from the outline only, the glyph is never rasterized
+	struct GlyphMetrics {
+		ci::vec2	advance;		// pen advance in pixels
+		ci::vec2	bearing;		// horizontal left + top side bearing in pixels
+		ci::Rectf	cbox;			// outline control box in pixels (y up)
+		ci::ivec2	bitmapSize;		// size of the bitmap the rasterizer would produce
+		ci::ivec2	bitmapOffset;	// bitmap left + top, same as FT_BitmapGlyph left/top
+	};
+
+	// Memory used by a face's font data
+	struct FaceMemoryInfo {
+		uint32_t		faceId;
+		ci::fs::path	filePath;		// empty for faces loaded from a buffer
+		bool			memoryMapped;
+		size_t			size;			// bytes of font data
+		size_t			residentBytes;	// bytes currently in physical memory
+		size_t			tableBytes;		// cmap, glyph class, glyph metrics + outline tables
+		uint32_t		refCount;		// Font references to any size of the face, 0 once it can be unloaded
+		uint32_t		numAliases;		// other paths + buffers with the same contents that resolved to this face
+		size_t			savedBytes;		// font data of aliased paths + buffers, opened as this face instead of their own
+	};
+
+	// References to a font (face + size), every Font object counts as one while it exists
+	struct FontUsage {
+		uint32_t		handle;
+		uint32_t		faceId;
+		std::string		family;
+		std::string		style;
+		unsigned int	size;
+		uint32_t		refCount;
+		// ScopedFontOwners references were taken in + how many of them each holds, references taken outside one aren't listed
+		std::vector<std::pair<std::string,uint32_t>>	owners;
+	};
+
+	// A glyph's coverage in the glyph bitmap store
+	struct StoredGlyphBitmap {
+		ci::ivec2	size;			// bitmap size in pixels, same as GlyphMetrics::bitmapSize
+		ci::ivec2	offset;			// bitmap left + top
+		uint32_t	encodedBytes;	// bytes of run-length encoded coverage
+	};
+
+	// Memory used by the glyph bitmap store, summed over every font
+	struct GlyphBitmapStats {
+		size_t		numGlyphs;
+		size_t		rawBytes;		// the stored glyphs as 8-bit bitmaps
+		size_t		encodedBytes;	// their encoded coverage
+		size_t		bytes;			// slabs + entries held by the store
+		float		bytesPerGlyph;	// bytes / numGlyphs
+		uint64_t	hits;
+		uint64_t	misses;
+		uint64_t	evictions;		// fonts whose bitmaps were dropped to stay under maxGlyphBitmapBytes
+	};
+
+	// A run's shaped glyphs in logical order as parallel arrays, see Shaper::shape()
+	// Glyph i's text is the byte range clusters[i], clusterLengths[i] of the run's text, which isn't copied
+	struct ShapedRun {
+		ShapedRun() : unsafeToConcatAtStart( false ), unsafeToConcatAtEnd( false ) {}
+
+		size_t size() const { return indices.size(); }
+		bool empty() const { return indices.empty(); }
+		void resize( size_t size );
+		//! Appends another run's glyphs, their clusters moved by textOffset bytes
+		void append( const ShapedRun& run, uint32_t textOffset );
+		size_t getBytes() const { return size() * ( 3 * sizeof( uint32_t ) + 2 * sizeof( ci::vec2 ) ); }
+
+		std::vector<uint32_t>	indices;
+		std::vector<uint32_t>	clusters;
+		std::vector<uint32_t>	clusterLengths;	// up to the next glyph's cluster, 0 for all but the last glyph of a cluster
+		std::vector<ci::vec2>	offsets;
+		std::vector<ci::vec2>	advances;
+
+		// Shaping the first + last glyph looked at text outside of the run
+		bool					unsafeToConcatAtStart;
+		bool					unsafeToConcatAtEnd;
+	};
+	// Shared with the shaping cache
+	typedef std::shared_ptr<const ShapedRun> ShapedRunRef;
+
+	// Harfbuzz' glyphs for Latin-1 characters, character pairs + the characters around ligatures, each shaped alone
+	// Shaper fills it as characters come up and shapes simple text from it without Harfbuzz, see Shaper::setSimpleShaping()
+	struct SimpleShapingTable {
+		// One to three characters shaped with the font, positions in 26.6 pixels
+		struct Sequence {
+			Sequence() : numGlyphs( -1 ), cluster( 0 ), glyphs{ 0, 0 }, advances{ 0, 0 } {}
+
+			int8_t		numGlyphs;	// -1 until shaped, 0 if it didn't shape into one or two glyphs without offsets
+			uint8_t		cluster;	// of the second glyph
+			uint32_t	glyphs[2];
+			int32_t		advances[2];
+		};
+
+		SimpleShapingTable() : contextual( false ), longLigatures( false ) {}
+
+		bool									contextual;		// the font has lookups that reach past a pair of glyphs, the table isn't used
+		bool									longLigatures;	// the font's standard ligatures (liga) include ones the table can't represent, it is only used with them off
+		Sequence								characters[256];	// by codepoint
+		std::unordered_map<uint32_t, Sequence>	sequences;		// pairs + triples, by their codepoints a byte each
+	};
+
+	// Memory used by the shaping cache + its counters
+	struct ShapingCacheStats {
+		size_t		numRuns;
+		size_t		bytes;
+		uint64_t	hits;
+		uint64_t	misses;
+		uint64_t	evictions;	// runs dropped to stay under maxShapedRunBytes
+	};
+
+	// An axis of a variable font, values are in design units
+	struct VariationAxis {
+		uint32_t	tag;
+		std::string	name;
+		float		minimum;
+		float		defaultValue;
+		float		maximum;
+	};
+
+	//! Attributes the font references taken on this thread to an owner while it exists, reported by getFontUsage()
+	//! Fonts created, copied or assigned in the scope count towards the owner until they are destroyed or reassigned
+	class ScopedFontOwner {
+	  public:
+		ScopedFontOwner( const std::string& owner );
+		~ScopedFontOwner();
+
+	  private:
+		uint32_t mPreviousOwnerId;
+	};
+
+	// Limits for each thread's Freetype cache manager
+	struct CacheLimits {
+		CacheLimits() : maxFaces( 32 ), maxSizes( 64 ), maxBytes( 4 * 1024 * 1024 ), maxPathBytes( 8 * 1024 * 1024 ), maxFaceBytes( 64 * 1024 * 1024 ), maxGlyphBitmapBytes( 16 * 1024 * 1024 ), maxShapedRunBytes( 4 * 1024 * 1024 ) {}
+
+		uint32_t	maxFaces;		// open FT_Faces
+		uint32_t	maxSizes;		// FT_Sizes, one per face + size
+		uint64_t	maxBytes;		// cmap + glyph image cache nodes
+		uint64_t	maxPathBytes;	// glyph outlines, shared by every thread
+		uint64_t	maxFaceBytes;	// font data + tables of loaded faces, past this faces without references are unloaded
+		uint64_t	maxGlyphBitmapBytes;	// encoded glyph coverage, shared by every thread
+		uint64_t	maxShapedRunBytes;		// shaped runs of text, shared by every thread, 0 turns the shaping cache off
+	};
+
+	// Cache counters summed over every thread
+	// Face misses count every face open, a reopen is a miss for a face that was open before and got evicted.
+	// The Freetype cmap + image caches have no counters, Freetype doesn't report their lookups or evictions.
+	// heapBytes shows when maxBytes is the limiting factor, the glyph caches FontManager keeps have their own counters.
+	struct CacheStats {
+		uint64_t	faceHits;
+		uint64_t	faceMisses;
+		uint64_t	faceReopens;
+		uint64_t	faceEvictions;
+
+		uint64_t	sizeHits;
+		uint64_t	sizeMisses;
+		uint64_t	sizeEvictions;
+
+		uint64_t	pathHits;
+		uint64_t	pathMisses;
+		uint64_t	pathEvictions;	// faces whose outlines were dropped to stay under maxPathBytes
+
+		int64_t		heapBytes;	// memory currently allocated by Freetype
+		int64_t		pathBytes;	// memory held by cached glyph outlines
+	};
+
+	// Size metrics for a font (face + size), computed once and never modified
+	struct FontMetrics {
+		float			ascender;		// pixels above the baseline
+		float			descender;		// pixels below the baseline (negative)
+		float			height;			// default line height in pixels
+		float			baseline;		// distance from the bottom of the line to the baseline
+		ci::vec2		maxGlyphSize;	// face bbox scaled to the font size
+		ci::vec2		dpi;			// resolution used for the scaler
+		FTC_ScalerRec_	scaler;
+	};
+
+	// Outline of a glyph in font units (y up), shared by every size of a face
+	// The verbs + points live in the face's outline arena, which the GlyphPathRef keeps alive
+	struct GlyphPath {
+		enum Verb : uint8_t {
+			VERB_MOVE,		// 1 point
+			VERB_LINE,		// 1 point
+			VERB_QUAD,		// 2 points, control + end
+			VERB_CUBIC,		// 3 points, 2 controls + end
+			VERB_CLOSE		// no points, closes the current contour
+		};
+
+		bool empty() const { return numVerbs == 0; }
+
+		const uint8_t*	verbs;
+		const ci::vec2*	points;
+		uint32_t		numVerbs;
+		uint32_t		numPoints;
+		ci::Rectf		bounds;		// outline control box
+		uint16_t		unitsPerEm;
+	};
+	typedef std::shared_ptr<const GlyphPath> GlyphPathRef;
+
+	// Layout classes for glyphs, read from the face's cmap
+	enum GlyphClass : uint8_t {
+		GLYPH_CLASS_WHITESPACE	= 1 << 0,	// space separators (Zs)
+		GLYPH_CLASS_NEWLINE		= 1 << 1,	// line + paragraph separators
+		GLYPH_CLASS_NO_BREAK	= 1 << 2	// spaces that don't allow a line break
+	};
+
+	static const FontManagerRef& get();
+	~FontManager();
 
 	// Preload a face so that it can be referenced in rich text
 	// If family or style are not provided they will be read from the font
 	void loadFace( const ci::fs::path& path, const std::string& family = "", const std::string& style = "" );
 	void loadFace( const ci::DataSourceRef& dataSource, const std::string& family = "", const std::string& style = "" );
+	//! Loads a face from font bytes in memory, the buffer is referenced (not copied) for the lifetime of the face
+	void loadFace( const ci::BufferRef& buffer, const std::string& family = "", const std::string& style = "" );
+
+	//! Loads a face on the font loading thread, the future holds the face id once the face is opened and its names are read
+	//! If the face can't be opened the future holds the exception instead. The callback is only called on success, on the loading thread.
+	std::shared_future<uint32_t> loadFaceAsync( const ci::fs::path& path, const std::string& family = "", const std::string& style = "", const std::function<void( uint32_t faceId )>& callback = nullptr );
+	//! Loads a font's size metrics, glyph classes and the metrics of its Latin-1 glyphs on the font loading thread
+	//! These are shared by every thread. The future holds an exception if the face can't be opened at the size,
+	//! the callback is only called on success, on the loading thread.
+	std::shared_future<void> loadFontAsync( const Font& font, const std::function<void( const Font& font )>& callback = nullptr );
+	//! Runs a task on the font loading thread, tasks run one at a time in the order they were queued
+	//! Exceptions a task throws are logged, they don't stop the tasks after it.
+	void runOnLoadThread( const std::function<void()>& task );
+
+	//! Registers every face in a font directory by family + style, faces are only opened once they are used
+	//! The index at indexPath is kept between runs, only new or modified font files are read
+	void loadFontDirectory( const ci::fs::path& directory, const ci::fs::path& indexPath );
+	//! Registers the faces in a font index by family + style without opening them
+	void loadFontIndex( const FontIndexRef& index );
+
+	//! Sets the limits for the Freetype caches. Caches are created per thread, the limits apply to caches
+	//! created afterwards. If maxFaces, maxSizes or maxBytes change the calling thread's caches are rebuilt,
+	//! which invalidates every FT_Face, FT_Size, FT_Glyph and hb_font_t the calling thread got from the FontManager.
+	//! Call this before loading fonts, or don't hold on to those across the call. The shared limits apply right away.
+	void setCacheLimits( const CacheLimits& limits );
+	CacheLimits getCacheLimits();
+
+	//! Returns the cache counters for all threads, including threads that have exited
+	CacheStats getCacheStats();
+	void resetCacheStats();
+
+	//! Returns the font data memory usage for a face
+	FaceMemoryInfo getFaceMemoryInfo( const Font& font );
+	//! Returns the font data memory usage for every face with loaded font data
+	std::vector<FaceMemoryInfo> getFaceMemoryReport();
+
+	//! Returns every font with the Font objects referencing it
+	std::vector<FontUsage> getFontUsage();
+	//! Returns the number of Font objects referencing a font (face + size)
+	uint32_t getFontRefCount( uint32_t handle );
+	//! The handle of fonts that couldn't get one of their own (too many fonts), it never resolves to a face
+	static const uint32_t INVALID_FONT_HANDLE = 0;
+	//! Unloads faces that no Font references, least recently used first, until the loaded faces fit in maxBytes
+	//! This happens on its own past CacheLimits::maxFaceBytes whenever a new font is created.
+	//! Unloading drops the face's font data + tables and closes it in every thread's cache, it's reopened if used again.
+	//! Returns the number of faces unloaded.
+	size_t unloadUnusedFaces( uint64_t maxBytes = 0 );
 
 	// Get the font family or style for a previously loaded or system font
 	std::string getFontFamily( const Font& font );
 	std::string getFontStyle( const Font& font );
 
+	//! Returns the interned id of a family or style name, names are matched case-insensitively
+	//! Ids are never reused or released, the table holds every distinct name for the lifetime of the process.
+	uint32_t internName( const std::string& name );
+	//! Returns the name for an interned id, spelled the way it was first interned
+	std::string getInternedName( uint32_t nameId );
+
+	// Interned family or style ids for a previously loaded or system font
+	uint32_t getFontFamilyId( const Font& font );
+	uint32_t getFontStyleId( const Font& font );
+
+	//! Returns the face id for an interned family + style, loading the face if needed
+	//! A style that isn't registered under its name resolves to the family's face with the attributes the name describes,
+	//! so "SemiBold", "Semi Bold" and "Demibold" are the same face.
+	uint32_t getFaceId( uint32_t familyId, uint32_t styleId );
+
+	//! Returns the face of a family closest to the attributes, picked the way CSS font matching does:
+	//! the nearest width first, then the slant, then the nearest weight. Exact matches are a single lookup.
+	//! styleId picks between faces with the same attributes ("Display" and "Regular" are both 400 upright).
+	//! Only families without any faces and system font families are loaded from the system, once per style.
+	uint32_t matchFace( uint32_t familyId, const FaceAttributes& attributes, uint32_t styleId = INVALID_NAME_ID );
+	//! Returns the weight, width + slant a face is matched by, read from its OS/2 table once it's opened
+	FaceAttributes getFaceAttributes( const Font& font );
+
+	static const uint32_t INVALID_NAME_ID = 0xFFFFFFFF;
+
+	//! Returns the face id of a variable font instance, created the first time it's requested
+	//! Coordinates are clamped to the axes' ranges and axes at their default are dropped, so equal instances share an id.
+	//! Returns faceId itself for the default instance and for faces that aren't variable fonts.
+	//! Instances are opened over the face's font data, only the Freetype face + caches are per instance.
+	uint32_t getFaceInstanceId( uint32_t faceId, const FontVariations& variations );
+	//! Returns the coordinates of a font's instance, empty for the default instance
+	FontVariations getFontVariations( const Font& font );
+	//! Returns the axes of a variable font, empty for static fonts
+	std::vector<VariationAxis> getVariationAxes( const Font& font );
+	//! Returns the named instances of a variable font ("Bold", "Condensed Light", ...) with their coordinates
+	//! Loading a variable font registers these as styles of its family, so Font( family, "Bold", size ) picks the instance.
+	std::vector<std::pair<std::string,FontVariations>> getNamedInstances( const Font& font );
+
 	// Freetype functions, used by renderers and shapers
 	uint32_t getGlyphIndex( const Font& font, FT_UInt32 charCode, FT_Int mapIndex = 0 );
 	std::vector<uint32_t> getGlyphIndices( const Font& font, std::string string = "" );
 	//! Get Glyph Indices for a unicode range
 	std::vector<uint32_t> getGlyphIndices( const Font& font, const std::pair<uint32_t, uint32_t> &unicodeRange );
+	//! Returns true if the font's face maps the codepoint to a glyph, reads the face's cmap snapshot
+	bool hasGlyph( const Font& font, uint32_t codepoint );
 
 	FT_Glyph getGlyph( const Font& font, unsigned int glyphIndex );
 	FT_BitmapGlyph getGlyphBitmap( const Font& font, unsigned int glyphIndex );
 
+	//! Returns the outline metrics for a glyph, cached per font in a dense table
+	GlyphMetrics getGlyphMetrics( const Font& font, unsigned int glyphIndex );
+
+	//! Returns the metrics for a glyph rasterized with its outline moved right by phase / numPhases of a pixel
+	//! Only the bitmap size + offset change, phase 0 is the same as getGlyphMetrics()
+	GlyphMetrics getSubpixelGlyphMetrics( const Font& font, unsigned int glyphIndex, int phase, int numPhases );
+	//! Rasterizes a glyph with its outline moved right by phase / numPhases of a pixel, for subpixel positioning
+	//! Returns 8-bit coverage rows (top down, pitch == width) with the size + offset of getSubpixelGlyphMetrics()
+	std::vector<uint8_t> renderSubpixelGlyph( const Font& font, unsigned int glyphIndex, int phase, int numPhases );
+	//! Returns the outline shift for a subpixel phase in 26.6 fixed point (1/64 pixel)
+	static int getSubpixelShift( int phase, int numPhases ) { return numPhases > 1 ? ( 64 * ( phase % numPhases ) ) / numPhases : 0; }
+
+	//! Rasterizes a glyph into the glyph bitmap store the first time it's requested, safe to call from any thread
+	//! The store keeps the coverage run-length encoded per font, so re-uploading an atlas doesn't rasterize again.
+	//! Phases are the subpixel variants of renderSubpixelGlyph(), phase 0 is the regular glyph.
+	StoredGlyphBitmap storeGlyphBitmap( const Font& font, unsigned int glyphIndex, int phase = 0, int numPhases = 1 );
+	//! Decodes a stored glyph's 8-bit coverage into dest (top down, rows destPitch bytes apart), storing it first if needed
+	//! dest needs room for the storeGlyphBitmap() size. Returns the stored glyph.
+	StoredGlyphBitmap decodeGlyphBitmap( const Font& font, unsigned int glyphIndex, uint8_t* dest, size_t destPitch, int phase = 0, int numPhases = 1 );
+	//! Returns the glyph bitmap store's memory use + counters
+	GlyphBitmapStats getGlyphBitmapStats();
+	//! Stores glyph coverage quantized to 16 levels instead of exactly, which roughly halves small glyphs
+	//! Changing it empties the glyph bitmap store.
+	void setGlyphBitmapQuantized( bool quantized );
+	bool isGlyphBitmapQuantized();
+
+	//! Returns the glyphs cached for a run of text shaped with a font, segment properties + features, nullptr if it isn't cached
+	//! features is a Shaper::FeatureSet key. The run becomes the most recently used.
+	//! Lookups with countLookup false leave the hit + miss counters alone, see countShapedRunLookups()
+	ShapedRunRef findShapedRun( const Font& font, const std::string& text, const std::string& language, Script script, Direction direction, uint16_t features, bool countLookup = true );
+	//! Counts uncounted lookups once their result is used, a run's words only count when the run is joined from them
+	void countShapedRunLookups( uint64_t hits, uint64_t misses );
+	//! Caches a run's glyphs, the least recently used runs are dropped past CacheLimits::maxShapedRunBytes
+	void storeShapedRun( const Font& font, const std::string& text, const std::string& language, Script script, Direction direction, uint16_t features, const ShapedRunRef& glyphs );
+	//! Returns the shaping cache's memory use + counters
+	ShapingCacheStats getShapingCacheStats();
+
+	//! Returns a glyph's outline in font units, cached once per face so every size shares it
+	//! Bitmap-only glyphs have an empty path. A held path stays valid after the cache evicts it.
+	GlyphPathRef getGlyphPath( const Font& font, unsigned int glyphIndex );
+	//! Returns the scale from font units to pixels for a font
+	float getGlyphPathScale( const Font& font );
+	//! Returns a glyph's outline in pixels at the font's size, relative to the pen position with y down
+	ci::Shape2d getGlyphShape( const Font& font, unsigned int glyphIndex );
+
+	//! Returns the GlyphClass flags for a glyph, the classes are built once per face
+	uint8_t getGlyphClasses( const Font& font, uint32_t glyphIndex );
+	bool isWhitespaceGlyph( const Font& font, uint32_t glyphIndex ) { return ( getGlyphClasses( font, glyphIndex ) & GLYPH_CLASS_WHITESPACE ) != 0; }
+	bool isNewlineGlyph( const Font& font, uint32_t glyphIndex ) { return ( getGlyphClasses( font, glyphIndex ) & GLYPH_CLASS_NEWLINE ) != 0; }
+
 	unsigned int getNumGlyphs( const Font& font );
 	ci::vec2 getGlyphSize( const Font& font, unsigned int glyphIndex );
 	ci::vec2 getMaxGlyphSize( const Font& font );
 
 	float getLineHeight( const Font& font );
 
+	//! Returns the size metrics for a font, looked up once per face + size
+	const FontMetrics& getFontMetrics( const Font& font );
+
 	FT_Face getFace( const Font& font );
 	FT_Face getFace( size_t faceId );
 	FT_Face getFace( FTC_FaceID faceId );
@@ -112,41 +483,469 @@ class FontManager
 	FT_Size getSize( const Font& font );
 	FTC_ScalerRec_ getScaler( const Font& font );
 
+	//! Returns this thread's Harfbuzz font for a font, created once per face + size and kept until the face is closed
+	//! Looking it up makes the font's size the active size of its face, shape right after without looking up other sizes
+	hb_font_t* getHarfbuzzFont( const Font& font );
+	//! Returns an empty Harfbuzz buffer from this thread's pool, hand it back with releaseHarfbuzzBuffer()
+	hb_buffer_t* acquireHarfbuzzBuffer();
+	void releaseHarfbuzzBuffer( hb_buffer_t* buffer );
+	//! Returns this thread's shape plan for a font's face, segment properties + features, kept with its Harfbuzz font
+	//! featuresKey identifies the features (see Shaper::FeatureSet::getKey()), the same key must always come with the same features
+	hb_shape_plan_t* getHarfbuzzShapePlan( const Font& font, const hb_segment_properties_t& properties, const hb_feature_t* features, unsigned int numFeatures, uint16_t featuresKey );
+	//! Returns this thread's simple shaping table for a font, segment properties + features, kept with its Harfbuzz font
+	//! Valid until the font's Harfbuzz font is recreated, don't hold it across FontManager calls
+	SimpleShapingTable* getSimpleShapingTable( const Font& font, const hb_segment_properties_t& properties, uint16_t featuresKey );
+
+	//! Shapes with Harfbuzz' own OpenType font functions instead of through Freetype, off by default
+	//! Advances + glyph lookups then read the font tables directly instead of loading glyphs with FT_Load_Glyph.
+	//! The Harfbuzz face is created over the face's font data without copying it and shared by all threads + sizes.
+	//! Faces without font data in memory (see FaceData) and bitmap-only faces keep shaping through Freetype
+	void setOpenTypeShaping( bool openType );
+	bool isOpenTypeShaping() const { return mOpenTypeShaping.load( std::memory_order_relaxed ); }
+
   protected:
 	FontManager();
 
-	// Load freetype libs
-	void initFreetype();
+	// Cache counters for one thread's caches
+	// Only the owning thread writes them, atomics let getCacheStats() read them from any thread
+	struct CacheCounters {
+		CacheCounters() { reset(); }
+		void reset();
+		void addTo( CacheStats& stats ) const;
+
+		std::atomic<uint64_t>	faceHits, faceMisses, faceReopens, faceEvictions;
+		std::atomic<uint64_t>	sizeHits, sizeMisses, sizeEvictions;
+	};
+
+	// Freetype libs + caches, created lazily once per thread
+	struct FreetypeContext {
+		FreetypeContext( FontManager* manager );
+		~FreetypeContext();
+
+		FontManager*	manager;
+
+		FT_Library		library;
+		FTC_Manager		cacheManager;
+		FTC_CMapCache	cmapCache;
+		FTC_ImageCache	imageCache;
+
+		// Freetype allocates through this context
+		FT_MemoryRec_			memory;
+		std::atomic<int64_t>	heapBytes;
+
+		CacheCounters					counters;
+		std::unordered_set<FTC_FaceID>	openedFaces;
+
+		// Harfbuzz fonts by font handle, they hold a reference to the FT_Face they were created for
+		// Shape plans belong to the font's face, by language + script, direction and features
+		// Simple shaping tables belong to the font itself, advances depend on its size, keyed like the plans
+		struct HarfbuzzFont {
+			void release();
+
+			hb_font_t*	font;
+			FTC_FaceID	faceId;
+			bool		openType;	// created while OpenType shaping was on, it may still have fallen back to Freetype
+			std::map<std::pair<const void*, uint64_t>, hb_shape_plan_t*>	shapePlans;
+			std::map<std::pair<const void*, uint64_t>, SimpleShapingTable>	simpleShapingTables;
+		};
+		std::unordered_map<uint32_t, HarfbuzzFont>	harfbuzzFonts;
+		std::vector<hb_buffer_t*>					harfbuzzBuffers;
+		bool							closing;
+		size_t							numClosedFaces;	// closed faces already removed from this cache, guarded by mClosedFacesMutex
+
+		static void* allocate( FT_Memory memory, long size );
+		static void* reallocate( FT_Memory memory, long currentSize, long newSize, void* block );
+		static void release( FT_Memory memory, void* block );
+	};
+
+	static FreetypeContext& getFreetypeContext();
+	static std::unique_ptr<FreetypeContext>& getFreetypeContextStorage();
+	static FreetypeContext& getFreetypeContext( FT_Face face ) { return *static_cast<FreetypeContext*>( face->memory->user ); }
+
+	// Cache lookups that count hits + misses
+	FT_Error lookupSize( FTC_ScalerRec_* scaler, FT_Size* size );
+	FT_Error lookupImage( FTC_ScalerRec_* scaler, FT_ULong loadFlags, FT_UInt glyphIndex, FT_Glyph* glyph );
+
+	void registerFreetypeContext( FreetypeContext* context );
+	void unregisterFreetypeContext( FreetypeContext* context );
+
+	// Query the display resolution once, used for all scalers
+	void initResolution();
+	FTC_ScalerRec_ makeScaler( const Font& font ) const;
+	FontMetrics loadFontMetrics( const Font& font );
 
 	// Callback function used by FTCache, loads fonts when not present and requested
 	static FT_Error faceRequestor( FTC_FaceID face_id, FT_Library library, FT_Pointer req_data, FT_Face* aface );
+	static FT_Error openFace( FTC_FaceID face_id, FT_Library library, FT_Face* aface );
+	// Opens a face over font data in memory, the face keeps the data alive until it is done
+	static FT_Error openMemoryFace( FT_Library library, const FaceDataRef& data, FT_Long faceIndex, FT_Face* aface );
+	// Sets the design coordinates of a variable font face, axes that aren't in variations get their default
+	static FT_Error applyVariations( FT_Library library, FT_Face face, const FontVariations& variations );
+	// Finalizers for faces + sizes created by the caches
+	static void faceDone( void* face );
+	static void sizeDone( void* size );
 
 	// FT Error message wrapper
-	static void checkForFTError( FT_Error error, std::string description );
+	static void checkForFTError( FT_Error error, const std::string& description );
 	static const char* getFTErrorMessage( FT_Error error );
 
 	size_t getFaceId( const ci::fs::path& path );
+	size_t getFaceId( const ci::BufferRef& buffer );
 	size_t getFaceId( std::string family, std::string style );
 
+	// Returns the handle for a face + size with a reference the caller releases, allocating its record on first use
+	// The reference is taken under mFontRecordsMutex, so trimFaces() can't unload the face in between
+	uint32_t getFontHandle( uint32_t faceId, unsigned int size );
+
+	// Font reference counting, called by Font. Fonts that outlive the manager (statics at exit) are ignored.
+	// Each reference counts towards the owner it was taken in, a Font keeps the id to release it with
+	static void retainFont( uint32_t handle, uint32_t ownerId );
+	static void releaseFont( uint32_t handle, uint32_t ownerId );
+	static uint32_t getCurrentFontOwnerId() { return sCurrentFontOwnerId; }
+	uint32_t getFontOwnerId( const std::string& owner );
+
+	// Font data + glyph caches of the loaded faces, kept as they change so new fonts can check the budget without a scan
+	uint64_t getTrackedFaceBytes();
+	// Unloads unused faces other than keepFaceId until the loaded faces fit in maxBytes
+	size_t trimFaces( uint64_t maxBytes, uint32_t keepFaceId );
+	// Drops the glyph metrics, cmap, glyph class, outline + glyph bitmap tables of a face
+	void releaseFaceTables( FTC_FaceID id );
+	// The glyph metrics part of releaseFaceTables(), mFontRecordsMutex must be held
+	void releaseGlyphMetrics( FTC_FaceID id );
+	// The rest of releaseFaceTables(), the tables outside the font records
+	void releaseGlyphTables( FTC_FaceID id );
+	// References to each face in use, a base face's include its instances', in one pass over the records
+	// mFontRecordsMutex must be held
+	std::unordered_map<uint32_t,uint32_t> getFaceRefCounts();
+	// References, last use and unloadable bytes of every face with tables or font data
+	struct FaceUsage {
+		FaceUsage() : refCount( 0 ), lastUse( 0 ), tableBytes( 0 ), dataBytes( 0 ) {}
+
+		uint32_t	refCount;
+		uint64_t	lastUse;
+		size_t		tableBytes;
+		size_t		dataBytes;	// font data that can be mapped or read again, buffer faces keep theirs
+	};
+	std::unordered_map<uint32_t,FaceUsage> getFaceUsage();
+	// Releases a face's tables + font data, mFontRecordsMutex must be held so no reference is taken meanwhile
+	void unloadFace( FTC_FaceID id );
+	// Removes a face from every thread's cache, each thread flushes it the next time it uses its context
+	void closeFaceInAllContexts( FTC_FaceID id );
+	void flushClosedFaces( FreetypeContext& context );
+
 	void loadFace( const FaceFamilyAndStyle& familyStyle );
+	// Registers the family + style of a newly added face, read from the face if not provided
+	void registerFamilyStyleFromFace( FTC_FaceID id, const std::string& family, const std::string& style );
 	void removeFace( FTC_FaceID id );
 
-  private:
-	uint32_t mNextFaceId;
+	GlyphMetrics loadGlyphMetrics( const Font& font, unsigned int glyphIndex );
+	// Decomposes a glyph's unscaled outline, the verbs + points are copied into the arena by getGlyphPath()
+	GlyphPath loadGlyphPath( const Font& font, unsigned int glyphIndex, std::vector<uint8_t>& verbs, std::vector<ci::vec2>& points );
 
+  private:
 	// Lookup tables for FTC_FaceID caching
-	std::unordered_map<std::string,FTC_FaceID> mFaceIDsForPaths;
-	std::unordered_map<FTC_FaceID,std::string> mFacePathsForFaceID;
-
-	void registerFamilyStyleForFaceID( const FaceFamilyAndStyle& familyStyle, FTC_FaceID id );
-	std::unordered_map<FTC_FaceID,FaceFamilyAndStyle> mFamilyAndStyleForFaceIDs;
-	std::unordered_map<FaceFamilyAndStyle,FTC_FaceID> mFaceIDsForFamilyAndStyle;
-
-	// Freetype libs + caches
-	FT_Library mFTLibrary;
-	FTC_Manager mFTCacheManager;
-	FTC_CMapCache mFTCMapCache;
-	FTC_ImageCache mFTCImageCache;
+	// The registry is read-mostly, lookups grab the current snapshot without locking,
+	// writers copy it under mRegistryMutex and publish the modified copy
+	struct FaceRegistry {
+		std::unordered_map<std::string,FTC_FaceID> faceIDsForPaths;
+		std::unordered_map<FTC_FaceID,std::string> facePathsForFaceID;
+		// Faces inside font collections, faces that aren't listed are the first face in their file
+		std::unordered_map<FTC_FaceID,FT_Long> faceIndicesForFaceIDs;
+
+		// Font bytes faces are opened from, memory mapped files or referenced buffers
+		std::unordered_map<FTC_FaceID,FaceDataRef> faceDataForFaceIDs;
+		std::unordered_map<const void*,FTC_FaceID> faceIDsForBuffers;
+
+		// Faces by a hash of their font data + face index, identical fonts loaded again resolve to the first face
+		std::unordered_map<uint64_t,FTC_FaceID> faceIDsForContentKeys;
+		std::unordered_map<FTC_FaceID,uint64_t> contentKeysForFaceIDs;
+		std::unordered_map<FTC_FaceID,uint32_t> aliasCountsForFaceIDs;
+		std::unordered_map<FTC_FaceID,size_t>	aliasBytesForFaceIDs;
+		// Buffers that resolved to another face, held so their address can't be reused by a different buffer
+		std::unordered_map<const void*,ci::BufferRef> aliasBuffers;
+
+		// Variable font instances, opened over their base face's font data with the instance's coordinates
+		struct FaceInstance {
+			FTC_FaceID		baseId;
+			FontVariations	variations;
+		};
+		std::unordered_map<FTC_FaceID,FaceInstance> instancesForFaceIDs;
+		std::unordered_map<std::string,FTC_FaceID> faceIDsForInstanceKeys;
+
+		// Family + style are keyed by their interned name ids, see getFamilyStyleKey()
+		std::unordered_map<FTC_FaceID,FaceFamilyAndStyle> familyAndStyleForFaceIDs;
+		std::unordered_map<FTC_FaceID,uint64_t> familyStyleKeysForFaceIDs;
+		std::unordered_map<uint64_t,FTC_FaceID> faceIDsForFamilyStyleKeys;
+
+		// Faces by family + attributes, see getAttributeKey(), the first face with the attributes wins
+		// A family's faces are only searched when there's no exact match
+		std::unordered_map<FTC_FaceID,FaceAttributes> attributesForFaceIDs;
+		std::unordered_map<FTC_FaceID,uint64_t> attributeKeysForFaceIDs;
+		std::unordered_map<uint64_t,FTC_FaceID> faceIDsForAttributeKeys;
+		std::unordered_map<uint32_t,std::vector<FTC_FaceID>> faceIDsForFamilyIds;
+		// Families loaded by name from the system fonts, their other styles can be loaded the same way
+		std::unordered_set<uint32_t> systemFamilyIds;
+
+		// Size of the font data that can be unloaded (not buffers), set by publishRegistry()
+		uint64_t dataBytes = 0;
+	};
+	typedef std::shared_ptr<const FaceRegistry> FaceRegistryRef;
+
+	FaceRegistryRef getRegistry() const { return std::atomic_load( &mRegistry ); }
+	void publishRegistry( const std::shared_ptr<FaceRegistry>& registry );
+	void registerFamilyStyleForFaceID( const FaceFamilyAndStyle& familyStyle, FTC_FaceID id, const FaceAttributes& attributes );
+	void registerFaceData( FTC_FaceID id, const FaceDataRef& data, FT_Long faceIndex = 0 );
+	// Adds user family + style names to a face another path or buffer resolved to, without renaming it
+	void registerFamilyStyleAlias( FTC_FaceID id, const std::string& family, const std::string& style );
+	// Registers the named instances of a variable font as styles of its family
+	void registerNamedInstances( FTC_FaceID id, const std::string& family );
+	// Clamps variations to the axes of a face, or an instance's base face, into the instance + its registry key
+	// Returns false if the face isn't a variable font, an empty instance is the base face itself
+	bool resolveFaceInstance( uint32_t faceId, const FontVariations& variations, FTC_FaceID& baseId, FontVariations& instance, std::string& key );
+	// Adds an instance to a registry copy, mRegistryMutex must be held
+	FTC_FaceID registerFaceInstance( FaceRegistry& registry, FTC_FaceID baseId, const FontVariations& instance, const std::string& key );
+	std::vector<std::pair<std::string,FontVariations>> getNamedInstances( FT_Face face );
+	static uint64_t getContentKey( const FaceDataRef& data, FT_Long faceIndex ) { return data->getContentHash() * 1099511628211ull + uint64_t( faceIndex ); }
+	uint64_t getFamilyStyleKey( const FaceFamilyAndStyle& familyStyle );
+	static uint64_t getFamilyStyleKey( uint32_t familyId, uint32_t styleId ) { return ( uint64_t( familyId ) << 32 ) | styleId; }
+	static uint64_t getAttributeKey( uint32_t familyId, const FaceAttributes& attributes ) { return ( uint64_t( familyId ) << 32 ) | ( uint64_t( attributes.weight ) << 16 ) | ( uint64_t( attributes.width ) << 8 ) | attributes.slant; }
+	// Index a face by its family + attributes in a registry copy, replacing what it was indexed by before
+	static void registerFaceAttributes( FaceRegistry& registry, FTC_FaceID id, uint32_t familyId, const FaceAttributes& attributes );
+	static void unregisterFaceAttributes( FaceRegistry& registry, FTC_FaceID id );
+	// Sets id to the closest of a family's faces to the attributes, returns false if the family has no faces
+	static bool findNearestFace( const FaceRegistry& registry, uint32_t familyId, const FaceAttributes& attributes, FTC_FaceID& id );
+
+	std::mutex		mRegistryMutex;
+	FaceRegistryRef	mRegistry;
+	uint32_t		mNextFaceId;
+
+	// Interned family + style names, by id in the spelling first seen
+	// Every spelling that was passed in and the lowercase name map to the same id
+	std::mutex									mNamesMutex;
+	std::vector<std::string>					mNames;
+	std::unordered_map<std::string,uint32_t>	mNameIds;
+
+	// Glyph metrics per font (face + size), indexed by glyph index
+	struct GlyphMetricsTable {
+		std::vector<GlyphMetrics>	metrics;
+		std::vector<bool>			loaded;
+	};
+
+	// GlyphClass flags per glyph index, shared by every size of a face
+	// Only glyphs up to the highest classified index are stored
+	struct GlyphClassTable {
+		uint8_t get( uint32_t glyphIndex ) const { return glyphIndex < classes.size() ? classes[glyphIndex] : 0; }
+		std::vector<uint8_t> classes;
+	};
+	typedef std::shared_ptr<const GlyphClassTable> GlyphClassTableRef;
+
+	GlyphClassTableRef getGlyphClassTable( const Font& font );
+	GlyphClassTableRef loadGlyphClassTable( const Font& font );
+
+	std::mutex										mGlyphClassTablesMutex;
+	std::unordered_map<uint32_t,GlyphClassTableRef>	mGlyphClassTables;
+
+	// Snapshot of a face's unicode cmap, built once per face
+	// Codepoints are sorted with their glyphs in a parallel array, so ranges are a binary search + contiguous scan.
+	// The coverage bits mark the blocks of CHAR_MAP_BLOCK_SIZE codepoints that have at least one glyph.
+	struct CharMapTable {
+		static const uint32_t CHAR_MAP_BLOCK_SIZE = 256;
+		static const uint32_t CHAR_MAP_NUM_BLOCKS = 0x110000 / CHAR_MAP_BLOCK_SIZE;
+
+		bool covers( uint32_t codepoint ) const
+		{
+			uint32_t block = codepoint / CHAR_MAP_BLOCK_SIZE;
+			return block < CHAR_MAP_NUM_BLOCKS && ( coverage[block / 64] & ( uint64_t( 1 ) << ( block % 64 ) ) ) != 0;
+		}
+
+		std::vector<uint32_t>	codepoints;
+		std::vector<uint32_t>	glyphs;
+		std::array<uint64_t,CHAR_MAP_NUM_BLOCKS / 64> coverage;
+	};
+	typedef std::shared_ptr<const CharMapTable> CharMapTableRef;
+
+	CharMapTableRef getCharMapTable( const Font& font );
+	CharMapTableRef loadCharMapTable( const Font& font );
+
+	std::mutex										mCharMapTablesMutex;
+	std::unordered_map<uint32_t,CharMapTableRef>	mCharMapTables;
+
+	// Glyph outlines of a face, packed into blocks that never move
+	// Paths are only added, so a path can be read without locking while its table is alive.
+	// Each path's points + verbs are contiguous, paths larger than a quarter block get a block of their own.
+	struct GlyphPathTable {
+		static const size_t PATH_BLOCK_SIZE = 8 * 1024;
+
+		GlyphPathTable() : block( nullptr ), blockUsed( PATH_BLOCK_SIZE ), bytes( 0 ), lastUse( 0 ) {}
+		uint8_t* allocate( size_t size );
+
+		std::unordered_map<uint32_t,GlyphPath>	paths;
+		std::vector<std::unique_ptr<uint8_t[]>>	blocks;
+		uint8_t*								block;
+		size_t									blockUsed;
+		size_t									bytes;		// blocks + path entries
+		uint64_t								lastUse;
+	};
+	typedef std::shared_ptr<GlyphPathTable> GlyphPathTableRef;
+
+	// Drops the least recently used faces' outlines until the cache fits in maxBytes, called with mGlyphPathsMutex held
+	void trimGlyphPaths( uint64_t maxBytes );
+
+	std::mutex										mGlyphPathsMutex;
+	std::unordered_map<uint32_t,GlyphPathTableRef>	mGlyphPathTables;
+	uint64_t										mGlyphPathClock;
+	int64_t											mGlyphPathBytes;
+	uint64_t										mGlyphPathHits, mGlyphPathMisses, mGlyphPathEvictions;
+
+	// Encoded glyph coverage of a font (face + size), packed into slabs that never move
+	// Like the outlines, glyphs are only added so a glyph can be decoded without locking while its table is alive.
+	struct GlyphBitmapTable {
+		static const size_t BITMAP_BLOCK_SIZE = 16 * 1024;
+
+		struct Entry {
+			StoredGlyphBitmap	bitmap;
+			const uint8_t*		data;
+		};
+
+		GlyphBitmapTable() : faceId( 0 ), quantized( false ), block( nullptr ), blockUsed( BITMAP_BLOCK_SIZE ), bytes( 0 ), rawBytes( 0 ), encodedBytes( 0 ), lastUse( 0 ) {}
+		uint8_t* allocate( size_t size );
+
+		uint32_t								faceId;
+		bool									quantized;	// literals are packed 2 pixels per byte
+		std::unordered_map<uint64_t,Entry>		glyphs;		// by getGlyphBitmapKey()
+		std::vector<std::unique_ptr<uint8_t[]>>	blocks;
+		uint8_t*								block;
+		size_t									blockUsed;
+		size_t									bytes;		// blocks + glyph entries
+		size_t									rawBytes;
+		size_t									encodedBytes;
+		uint64_t								lastUse;
+	};
+	typedef std::shared_ptr<GlyphBitmapTable> GlyphBitmapTableRef;
+
+	// Phase 0 of every subpixel count is the regular glyph, so they share a key
+	static uint64_t getGlyphBitmapKey( unsigned int glyphIndex, int phase, int numPhases ) { return ( numPhases > 1 && phase % numPhases ) ? glyphIndex | ( uint64_t( phase % numPhases ) << 32 ) | ( uint64_t( numPhases ) << 48 ) : glyphIndex; }
+	// Returns the table holding a glyph's entry, storing it first if needed. The table keeps the entry's data alive.
+	GlyphBitmapTableRef getGlyphBitmapEntry( const Font& font, unsigned int glyphIndex, int phase, int numPhases, const GlyphBitmapTable::Entry*& entry );
+	// Drops the least recently used fonts' bitmaps until the store fits in maxBytes, called with mGlyphBitmapsMutex held
+	void trimGlyphBitmaps( uint64_t maxBytes );
+
+	std::mutex										mGlyphBitmapsMutex;
+	std::unordered_map<uint32_t,GlyphBitmapTableRef>	mGlyphBitmapTables;	// by font handle
+	uint64_t										mGlyphBitmapClock;
+	int64_t											mGlyphBitmapBytes;
+	uint64_t										mGlyphBitmapHits, mGlyphBitmapMisses, mGlyphBitmapEvictions;
+	bool											mGlyphBitmapQuantized;
+
+	// Harfbuzz faces over font data for OpenType shaping, by the face id owning the data (instances use their base face's)
+	// Returns NULL if the face has no font data in memory. Thread fonts hold their own reference to the face
+	hb_face_t* getHarfbuzzFace( FTC_FaceID id );
+
+	// Shaped runs by a hash of their font, text, segment properties + features
+	// The entry keeps the full key, a run whose hash matches but key doesn't is a miss
+	struct ShapedRunEntry {
+		uint32_t						handle;
+		uint32_t						faceId;
+		uint16_t						features;
+		Script							script;
+		Direction						direction;
+		std::string						language;
+		std::string						text;
+		ShapedRunRef					glyphs;
+		size_t							bytes;
+		std::list<uint64_t>::iterator	order;
+	};
+
+	static uint64_t getShapedRunHash( uint32_t handle, const std::string& text, const std::string& language, Script script, Direction direction, uint16_t features );
+	// Drops the least recently used runs until the cache fits in maxBytes, called with mShapedRunsMutex held
+	void trimShapedRuns( uint64_t maxBytes );
+	void eraseShapedRun( std::unordered_map<uint64_t,ShapedRunEntry>::iterator it );
+
+	std::mutex										mShapedRunsMutex;
+	std::unordered_map<uint64_t,ShapedRunEntry>		mShapedRuns;
+	std::list<uint64_t>								mShapedRunOrder;	// hashes, least recently used first
+	int64_t											mShapedRunBytes;
+	uint64_t										mShapedRunHits, mShapedRunMisses, mShapedRunEvictions;
+
+	std::mutex										mHarfbuzzFacesMutex;
+	std::unordered_map<FTC_FaceID, hb_face_t*>		mHarfbuzzFaces;
+	std::atomic<bool>								mOpenTypeShaping;
+
+	// Size metrics, glyph classes + glyph metrics for a font (face + size), addressed by the font's handle
+	// The size metrics + glyph classes never change once loaded, so they are read without locking
+	struct FontRecord {
+		FontRecord() : faceId( 0 ), size( 0 ), refCount( 0 ), lastUse( 0 ), loaded( false ) {}
+
+		uint32_t			faceId;
+		unsigned int		size;
+
+		// Font objects referencing the record, and when the last one went away
+		std::atomic<uint32_t>	refCount;
+		std::atomic<uint64_t>	lastUse;
+		// References taken in a ScopedFontOwner by owner id, the count alone is kept lock free for the others
+		std::mutex									ownersMutex;
+		std::vector<std::pair<uint32_t,uint32_t>>	ownerRefCounts;
+
+		std::mutex			mutex;
+		std::atomic<bool>	loaded;
+		FontMetrics			metrics;
+		GlyphClassTableRef	glyphClasses;
+		GlyphMetricsTable	glyphMetrics;
+	};
+
+	// Returns the font's record with its size metrics + glyph classes loaded
+	FontRecord& getLoadedFontRecord( const Font& font );
+	// Adds to or subtracts from the references a ScopedFontOwner holds on the record, owner 0 isn't counted
+	static void countOwnerRefs( FontRecord& record, uint32_t ownerId, int delta );
+
+	// Records are allocated in fixed chunks that never move,
+	// so a handle can be resolved with two array lookups and no lock
+	static const size_t FONT_RECORD_CHUNK_SIZE = 256;
+	static const size_t FONT_RECORD_MAX_CHUNKS = 1024;
+
+	FontRecord& getFontRecord( const Font& font ) { return getFontRecord( font.mHandle ); }
+	FontRecord& getFontRecord( uint32_t handle ) { return mFontRecordChunks[handle / FONT_RECORD_CHUNK_SIZE].load( std::memory_order_acquire )[handle % FONT_RECORD_CHUNK_SIZE]; }
+
+	std::mutex										mFontRecordsMutex;
+	std::unordered_map<uint64_t,uint32_t>			mFontHandles;
+	uint32_t										mNumFontRecords;
+	std::array<std::atomic<FontRecord*>,FONT_RECORD_MAX_CHUNKS> mFontRecordChunks;
+	std::atomic<uint64_t>							mFontUseClock;
+	// mFontUseClock when the last trimFaces() found nothing to unload, new fonts don't trim again until a release
+	std::atomic<uint64_t>							mStuckTrimUseClock;
+
+	// Owners Font references are attributed to, id 0 is no owner
+	std::mutex									mFontOwnersMutex;
+	std::vector<std::string>					mFontOwners;
+	std::unordered_map<std::string,uint32_t>	mFontOwnerIds;
+
+	// The manager Fonts reference count with, cleared when it's destroyed
+	static std::atomic<FontManager*>	sInstance;
+	static thread_local uint32_t		sCurrentFontOwnerId;
+
+	// Faces removed or unloaded, in order, each thread's context removes them from its cache
+	// Faces every context has removed are dropped, mClosedFaces starts at closed face mFirstClosedFace
+	std::mutex						mClosedFacesMutex;
+	std::vector<FTC_FaceID>			mClosedFaces;
+	size_t							mFirstClosedFace;
+	std::atomic<size_t>				mNumClosedFaces;
+
+	// Background thread for async loads, started with the first task
+	void loadThreadFn();
+
+	std::mutex							mLoadMutex;
+	std::condition_variable				mLoadCondition;
+	std::deque<std::function<void()>>	mLoadTasks;
+	std::thread							mLoadThread;
+	bool								mLoadThreadExiting;
+
+	// Live per-thread contexts, counters from exited threads are kept in mRetiredStats
+	std::mutex						mContextsMutex;
+	std::vector<FreetypeContext*>	mContexts;
+	CacheStats						mRetiredStats;
+	CacheLimits						mCacheLimits;
+
+	ci::vec2 mResolution;
 };
 
 } } // namespace cinder::text
@@ -4,6 +4,8 @@
 #include "hb.h"
 #include "hb-ft.h"
 
+#include <unordered_map>
+
 namespace cinder { namespace text {
 // Create harfbuzz functions
 namespace
@@ -13,74 +15,97 @@ namespace
 	const hb_tag_t CligTag = HB_TAG( 'c', 'l', 'i', 'g' ); // contextual ligature substitution
 	const hb_tag_t CaltTag = HB_TAG( 'c', 'a', 'l', 't' ); // contextual alternate
 
+	// Indexed by Shaper::Feature
+	const hb_tag_t FeatureTags[] = { LigaTag, KernTag, CligTag, CaltTag };
+
+	// Harfbuzz parses language tags + looks them up in a locked list, remember them per thread
+	hb_language_t getLanguage( const std::string& tag )
+	{
+		static thread_local std::unordered_map<std::string, hb_language_t> languages;
+
+		auto it = languages.find( tag );
+
+		if( it == languages.end() ) {
+			it = languages.emplace( tag, hb_language_from_string( tag.c_str(), (int)tag.size() ) ).first;
+		}
+
+		return it->second;
+	}
 
-	static hb_feature_t LigatureOff = { LigaTag, 0, 0, std::numeric_limits<unsigned int>::max() };
-	static hb_feature_t LigatureOn = { LigaTag, 1, 0, std::numeric_limits<unsigned int>::max() };
-	static hb_feature_t KerningOff = { KernTag, 0, 0, std::numeric_limits<unsigned int>::max() };
-	static hb_feature_t KerningOn = { KernTag, 1, 0, std::numeric_limits<unsigned int>::max() };
-	static hb_feature_t CligOff = { CligTag, 0, 0, std::numeric_limits<unsigned int>::max() };
-	static hb_feature_t CligOn = { CligTag, 1, 0, std::numeric_limits<unsigned int>::max() };
-	static hb_feature_t CaltOff = { CaltTag, 0, 0, std::numeric_limits<unsigned int>::max() };
-	static hb_feature_t CaltOn = { CaltTag, 1, 0, std::numeric_limits<unsigned int>::max() };
+	hb_segment_properties_t getSegmentProperties( const Shaper::Text& text )
+	{
+		hb_segment_properties_t properties = HB_SEGMENT_PROPERTIES_DEFAULT;
+		properties.direction = (hb_direction_t)text.direction;
+		properties.script = (hb_script_t)text.script;
+		properties.language = getLanguage( text.language );
+		return properties;
+	}
 
+	// Latin-1 characters simple text is made of
+	// Other controls are left to Harfbuzz, as is the soft hyphen, which it hides + kerns across
+	bool isSimpleCharacter( uint8_t c )
+	{
+		return c == '\t' || c == '\n' || c == '\r' || ( c >= 0x20 && c < 0x7F ) || ( c >= 0xA0 && c != 0xAD );
+	}
+	// Returns the UTF-8 length of the space at i, 0 if it isn't one
+	// No-break spaces (U+00A0, U+2007, U+202F) are part of their word
+	size_t getSpaceLength( const std::string& text, size_t i )
+	{
+		uint8_t c = text[i];
+		if( c == ' ' || ( c >= '\t' && c <= '\r' ) ) {
+			return 1;
+		}
+		if( i + 2 >= text.size() || c < 0xE1 || c > 0xE3 ) {
+			return 0;
+		}
+		uint8_t c1 = text[i + 1], c2 = text[i + 2];
+		bool space = ( c == 0xE1 && c1 == 0x9A && c2 == 0x80 )	// U+1680 ogham space mark
+			|| ( c == 0xE2 && c1 == 0x80 && ( ( c2 >= 0x80 && c2 <= 0x8A && c2 != 0x87 ) || c2 == 0xA8 || c2 == 0xA9 ) )	// U+2000 - U+200A, line + paragraph separators
+			|| ( c == 0xE2 && c1 == 0x81 && c2 == 0x9F )	// U+205F medium mathematical space
+			|| ( c == 0xE3 && c1 == 0x80 && c2 == 0x80 );	// U+3000 ideographic space
+		return space ? 3 : 0;
+	}
 }
 
-Shaper::Shaper( const Font& font )
+unsigned int Shaper::FeatureSet::getHarfbuzzFeatures( hb_feature_t* features ) const
 {
-	FT_Face face = FontManager::get()->getSize( font )->face;
-	mFont = hb_ft_font_create( face, NULL );
+	unsigned int numFeatures = 0;
+
+	for( int feature = LIGATURES; feature <= CALT; feature++ ) {
+		uint8_t bit = getBit( Feature( feature ) );
 
-	mBuffer = hb_buffer_create();
+		if( ( mEnabled | mDisabled ) & bit ) {
+			features[numFeatures++] = { FeatureTags[feature], ( mEnabled & bit ) ? 1u : 0u, HB_FEATURE_GLOBAL_START, HB_FEATURE_GLOBAL_END };
+		}
+	}
 
-	CI_ASSERT_MSG( hb_buffer_allocation_successful( mBuffer ), "Could not allocate Harfbuzz buffer." );
+	return numFeatures;
+}
+
+Shaper::Shaper( const Font& font, const FeatureSet& features )
+	: mFont( font )
+	, mBuffer( NULL )
+	, mFeatures( features )
+	, mWordShaping( true )
+	, mSimpleShaping( true )
+{
 }
 
 Shaper::~Shaper()
 {
-	hb_buffer_destroy( mBuffer );
-	hb_font_destroy( mFont );
+	if( mBuffer ) {
+		FontManager::get()->releaseHarfbuzzBuffer( mBuffer );
+	}
 }
 
 void Shaper::addFeature( Feature feature )
 {
-	switch( feature ) {
-		case LIGATURES:
-			mFeatures.push_back( LigatureOn );
-			break;
-
-		case KERNING:
-			mFeatures.push_back( KerningOn );
-			break;
-
-		case CLIG:
-			mFeatures.push_back( CligOn );
-			break;
-
-		case CALT:
-			mFeatures.push_back( CaltOn );
-			break;
-	}
+	mFeatures.add( feature );
 }
 
 void Shaper::removeFeature( Feature feature )
 {
-	switch( feature ) {
-		case LIGATURES:
-			mFeatures.push_back( LigatureOff );
-			break;
-
-		case KERNING:
-			mFeatures.push_back( KerningOff );
-			break;
-
-		case CLIG:
-			mFeatures.push_back( CligOff );
-			break;
-
-		case CALT:
-			mFeatures.push_back( CaltOff );
-			break;
-	}
+	mFeatures.remove( feature );
 }
 
 // Reverse Harfbuzz arrays, used for RTL text shaping
@@ -100,10 +125,145 @@ void reverseHBArray( t* arr, int length )
 	}
 }
 
-std::vector<Shaper::Glyph> Shaper::getShapedText( Text& text )
+Shaper::GlyphsRef Shaper::shape( const Text& text )
+{
+	return getShapedRun( text, mWordShaping, mSimpleShaping );
+}
+
+std::vector<Shaper::Glyph> Shaper::getShapedText( const Text& text )
+{
+	GlyphsRef run = shape( text );
+	std::vector<Glyph> glyphs;
+
+	if( run ) {
+		glyphs.resize( run->size() );
+
+		for( size_t i = 0; i < run->size(); i++ ) {
+			glyphs[i] = { run->indices[i], run->offsets[i], run->advances[i], run->clusters[i], run->clusterLengths[i] };
+		}
+	}
+
+	return glyphs;
+}
+
+FontManager::ShapedRunRef Shaper::getShapedRun( const Text& text, bool byWords, bool simple )
 {
+	// Runs shaped before with the same font, properties + features come from the shaping cache without any Harfbuzz work
+	FontManager::ShapedRunRef run = FontManager::get()->findShapedRun( mFont, text.data, text.language, text.script, text.direction, mFeatures.getKey() );
+
+	if( ! run ) {
+		if( simple ) {
+			run = shapeSimpleRun( text );
+		}
+
+		if( ! run && byWords ) {
+			run = shapeWords( text );
+		}
+
+		if( ! run ) {
+			run = shapeRun( text );
+		}
+
+		if( run ) {
+			FontManager::get()->storeShapedRun( mFont, text.data, text.language, text.script, text.direction, mFeatures.getKey(), run );
+		}
+	}
+
+	return run;
+}
+
+FontManager::ShapedRunRef Shaper::shapeWords( const Text& text )
+{
+#if HB_VERSION_ATLEAST( 4, 0, 0 )
+	// Words end after the spaces that follow them, so lookups reaching past a word see its space
+	std::vector<size_t> wordStarts( 1, 0 );
+	bool afterSpace = false;
+
+	for( size_t i = 0; i < text.data.size(); ) {
+		size_t spaceLength = getSpaceLength( text.data, i );
+
+		if( ! spaceLength && afterSpace ) {
+			wordStarts.push_back( i );
+		}
+
+		afterSpace = spaceLength > 0;
+		i += spaceLength ? spaceLength : 1;
+	}
+
+	if( wordStarts.size() < 2 ) {
+		return nullptr;
+	}
+
+	// Words shaped here are only stored, and the lookups only counted, once every word can be joined
+	auto run = std::make_shared<FontManager::ShapedRun>();
+	std::vector<std::pair<Text,FontManager::ShapedRunRef>> shapedWords;
+	uint64_t hits = 0;
+
+	for( size_t i = 0; i < wordStarts.size(); i++ ) {
+		size_t start = wordStarts[i];
+		size_t end = i + 1 < wordStarts.size() ? wordStarts[i + 1] : text.data.size();
+
+		Text word = { text.data.substr( start, end - start ), text.language, text.script, text.direction };
+		FontManager::ShapedRunRef wordRun = FontManager::get()->findShapedRun( mFont, word.data, word.language, word.script, word.direction, mFeatures.getKey(), false );
+
+		if( wordRun ) {
+			hits++;
+		}
+		else {
+			wordRun = shapeRun( word );
+
+			if( ! wordRun ) {
+				return nullptr;
+			}
+
+			shapedWords.emplace_back( word, wordRun );
+		}
+
+		// A word shaped differently next to other text can't be joined to it, shape the whole run instead
+		if( ( i > 0 && wordRun->unsafeToConcatAtStart ) || ( end < text.data.size() && wordRun->unsafeToConcatAtEnd ) ) {
+			return nullptr;
+		}
+
+		// The joined run's edges are those of its first and last words
+		if( i == 0 ) {
+			run->unsafeToConcatAtStart = wordRun->unsafeToConcatAtStart;
+		}
+
+		run->unsafeToConcatAtEnd = wordRun->unsafeToConcatAtEnd;
+		run->append( *wordRun, (uint32_t)start );
+	}
+
+	for( const auto& shapedWord : shapedWords ) {
+		const Text& word = shapedWord.first;
+		FontManager::get()->storeShapedRun( mFont, word.data, word.language, word.script, word.direction, mFeatures.getKey(), shapedWord.second );
+	}
+
+	FontManager::get()->countShapedRunLookups( hits, shapedWords.size() );
+	return run;
+#else
+	// Older Harfbuzz versions can't tell whether words can be joined
+	return nullptr;
+#endif
+}
+
+FontManager::ShapedRunRef Shaper::shapeRun( const Text& text )
+{
+	// Looked up per text, other sizes of the face may have been activated since the last one
+	hb_font_t* font = FontManager::get()->getHarfbuzzFont( mFont );
+
+	if( ! font ) {
+		return nullptr;
+	}
+
+	if( ! mBuffer ) {
+		mBuffer = FontManager::get()->acquireHarfbuzzBuffer();
+	}
+
 	// Clear our buffer and add the text to it
-	hb_buffer_reset( mBuffer );
+	hb_buffer_clear_contents( mBuffer );
+#if HB_VERSION_ATLEAST( 4, 0, 0 )
+	hb_buffer_set_flags( mBuffer, HB_BUFFER_FLAG_PRODUCE_UNSAFE_TO_CONCAT );
+#endif
 	hb_buffer_add_utf8( mBuffer, text.c_data(), text.data.length(), 0, text.data.length() );
 
 	// Set Segment properties
@@ -111,12 +271,15 @@ std::vector<Shaper::Glyph> Shaper::getShapedText( Text& text )
 	//hb_buffer_guess_segment_properties( mBuffer );
 
 	// Alternatively we can set direction, script and language
-	hb_buffer_set_direction( mBuffer, (hb_direction_t)text.direction );
-	hb_buffer_set_script( mBuffer, (hb_script_t)text.script );
-	hb_buffer_set_language( mBuffer, hb_language_from_string( text.language.c_str(), text.language.size() ) );
+	hb_segment_properties_t properties = getSegmentProperties( text );
+	hb_buffer_set_segment_properties( mBuffer, &properties );
 
-	// Shape the text
-	hb_shape( mFont, mBuffer, mFeatures.empty() ? NULL : &mFeatures[0], mFeatures.size() );
+	// Shape the text with the plan for these properties + features, plans are created once per face
+	hb_feature_t features[4];
+	unsigned int numFeatures = mFeatures.getHarfbuzzFeatures( features );
+
+	hb_shape_plan_t* plan = FontManager::get()->getHarfbuzzShapePlan( mFont, properties, features, numFeatures, mFeatures.getKey() );
+	hb_shape_plan_execute( plan, font, mBuffer, features, numFeatures );
 
 	unsigned int glyph_count;
 	hb_glyph_info_t* glyph_info = hb_buffer_get_glyph_infos( mBuffer, &glyph_count );
@@ -133,39 +296,228 @@ std::vector<Shaper::Glyph> Shaper::getShapedText( Text& text )
 		reverseHBArray( glyph_pos, glyph_count );
 	}
 
-	// Create glyphs w/original text and cluster info
-	// in case they need to be deconstructed later
-	std::vector<Glyph> glyphs;
+	auto run = std::make_shared<FontManager::ShapedRun>();
+	run->resize( glyph_count );
+
+	for( unsigned int i = 0; i < glyph_count; i++ ) {
+		run->indices[i] = glyph_info[i].codepoint;
+		run->clusters[i] = glyph_info[i].cluster;
+
+		// A glyph's text runs up to the next glyph's cluster, glyphs sharing a cluster leave it to the last one
+		int clusterEnd = i + 1 < glyph_count ? (int)glyph_info[i + 1].cluster : (int)text.data.length();
+		run->clusterLengths[i] = (uint32_t)std::max( clusterEnd - (int)glyph_info[i].cluster, 0 );
+
+		run->offsets[i] = ci::vec2( glyph_pos[i].x_offset / 64.f, glyph_pos[i].y_advance / 64.f );
+		run->advances[i] = ci::vec2( glyph_pos[i].x_advance / 64.f, glyph_pos[i].y_advance / 64.f );
+	}
+
+	// Only the run's edges matter for joining it to other runs
+#if HB_VERSION_ATLEAST( 4, 0, 0 )
+	run->unsafeToConcatAtStart = glyph_count && ( hb_glyph_info_get_glyph_flags( &glyph_info[0] ) & HB_GLYPH_FLAG_UNSAFE_TO_CONCAT );
+	run->unsafeToConcatAtEnd = glyph_count && ( hb_glyph_info_get_glyph_flags( &glyph_info[glyph_count - 1] ) & HB_GLYPH_FLAG_UNSAFE_TO_CONCAT );
+#else
+	run->unsafeToConcatAtStart = true;
+	run->unsafeToConcatAtEnd = true;
+#endif
+
+	return run;
+}
 
-	for( int i = 0; i < glyph_count; i++ ) {
-		Glyph glyph;
-		glyph.index = glyph_info[i].codepoint;
-		glyph.cluster = glyph_info[i].cluster;
+FontManager::ShapedRunRef Shaper::shapeSimpleRun( const Text& text )
+{
+	if( text.direction != Direction::LTR || ( text.script != Script::LATIN && text.script != Script::COMMON && text.script != Script::INVALID ) ) {
+		return nullptr;
+	}
+
+	// Decode the text to Latin-1, a character's cluster is the offset of its first byte
+	static thread_local std::vector<uint8_t> codepoints;
+	static thread_local std::vector<uint32_t> clusters;
+	codepoints.clear();
+	clusters.clear();
 
-		// Assign string values to clusters
-		// for decomposing at a later time
-		int clusterLength = 0;
+	for( size_t i = 0; i < text.data.size(); i++ ) {
+		uint8_t c = uint8_t( text.data[i] );
+		clusters.push_back( (uint32_t)i );
 
-		if( i != glyph_count - 1 ) {
-			clusterLength = glyph_info[i + 1].cluster - glyph_info[i].cluster;
+		// U+0080 - U+00FF take two bytes
+		if( ( c == 0xC2 || c == 0xC3 ) && i + 1 < text.data.size() && ( uint8_t( text.data[i + 1] ) & 0xC0 ) == 0x80 ) {
+			c = uint8_t( ( c & 0x03 ) << 6 | ( uint8_t( text.data[++i] ) & 0x3F ) );
 		}
-		else {
-			clusterLength = text.data.length() - glyph_info[i].cluster;
+		else if( c >= 0x80 ) {
+			return nullptr;
+		}
+
+		if( ! isSimpleCharacter( c ) ) {
+			return nullptr;
 		}
 
-		glyph.text = text.data.substr( glyph_info[i].cluster, clusterLength );
+		codepoints.push_back( c );
+	}
+
+	if( codepoints.empty() ) {
+		return nullptr;
+	}
+
+	hb_font_t* font = FontManager::get()->getHarfbuzzFont( mFont );
 
-		for( int j = glyph.cluster; j < glyph.cluster + clusterLength; j++ ) {
-			glyph.textIndices.push_back( j );
+	if( ! font ) {
+		return nullptr;
+	}
+
+	// Sequences are shaped with the plan the whole run would be
+	hb_segment_properties_t properties = getSegmentProperties( text );
+	hb_feature_t features[4];
+	unsigned int numFeatures = mFeatures.getHarfbuzzFeatures( features );
+
+	hb_shape_plan_t* plan = FontManager::get()->getHarfbuzzShapePlan( mFont, properties, features, numFeatures, mFeatures.getKey() );
+	FontManager::SimpleShapingTable* table = FontManager::get()->getSimpleShapingTable( mFont, properties, mFeatures.getKey() );
+
+	// The pairs would miss some of the font's standard ligatures, the table only shapes text with them removed
+	if( ! plan || ! table || table->contextual || ( table->longLigatures && ! mFeatures.isRemoved( LIGATURES ) ) ) {
+		return nullptr;
+	}
+
+	typedef FontManager::SimpleShapingTable::Sequence Sequence;
+	const uint8_t* chars = codepoints.data();
+	size_t length = codepoints.size();
+
+	auto getCharacter = [&]( size_t i ) -> const Sequence& { return getSequence( *table, font, plan, properties, &chars[i], 1 ); };
+	auto getPair = [&]( size_t i ) -> const Sequence& { return getSequence( *table, font, plan, properties, &chars[i], 2 ); };
+	auto getTriple = [&]( size_t i ) -> const Sequence& { return getSequence( *table, font, plan, properties, &chars[i], 3 ); };
+
+	// Every character has to shape into one glyph on its own
+	for( size_t i = 0; i < length; i++ ) {
+		if( getCharacter( i ).numGlyphs != 1 ) {
+			return nullptr;
 		}
+	}
 
-		glyph.offset = ci::vec2( glyph_pos[i].x_offset / 64.f, glyph_pos[i].y_advance / 64.f );
-		glyph.advance = ci::vec2( glyph_pos[i].x_advance / 64.f, glyph_pos[i].y_advance / 64.f );
+	auto run = std::make_shared<FontManager::ShapedRun>();
+	run->resize( length );
+	size_t numGlyphs = 0;
+
+	for( size_t i = 0; i < length; ) {
+		uint32_t glyph = getCharacter( i ).glyphs[0];
+		int32_t advance = getCharacter( i ).advances[0];
+		size_t next = i + 1;
+
+		if( next < length ) {
+			const Sequence& pair = getPair( i );
+
+			if( pair.numGlyphs == 1 ) {
+				// A ligature, a third character joining it ("ffi") isn't in the table
+				glyph = pair.glyphs[0];
+				advance = pair.advances[0];
+				next = i + 2;
+
+				if( next < length && getPair( i + 1 ).numGlyphs == 1 ) {
+					return nullptr;
+				}
+			}
+			else if( pair.numGlyphs == 2 && pair.glyphs[0] == glyph && pair.glyphs[1] == getCharacter( next ).glyphs[0] && pair.cluster == 1 && pair.advances[1] == getCharacter( next ).advances[0] ) {
+				// Kerning only moves the second glyph through the first one's advance
+				advance = pair.advances[0];
+			}
+			else {
+				return nullptr;
+			}
+		}
+
+		// Next to a ligature the glyphs kern with the ligature instead of its first character, those come from the three characters
+		if( next < length ) {
+			bool nextIsLigature = next + 1 < length && getPair( next ).numGlyphs == 1;
+			bool isLigature = next == i + 2;
+
+			if( nextIsLigature && isLigature ) {
+				return nullptr;
+			}
+
+			if( nextIsLigature || isLigature ) {
+				const Sequence& triple = getTriple( i );
+				uint32_t nextGlyph = nextIsLigature ? getPair( next ).glyphs[0] : getCharacter( next ).glyphs[0];
+				int32_t nextAdvance = nextIsLigature ? getPair( next ).advances[0] : getCharacter( next ).advances[0];
+
+				if( triple.numGlyphs != 2 || triple.glyphs[0] != glyph || triple.glyphs[1] != nextGlyph || triple.cluster != next - i || triple.advances[1] != nextAdvance ) {
+					return nullptr;
+				}
 
-		glyphs.push_back( glyph );
+				advance = triple.advances[0];
+			}
+		}
+
+		run->indices[numGlyphs] = glyph;
+		run->clusters[numGlyphs] = clusters[i];
+		run->offsets[numGlyphs] = ci::vec2( 0.f );
+		run->advances[numGlyphs] = ci::vec2( advance / 64.f, 0.f );
+		numGlyphs++;
+
+		i = next;
 	}
 
-	return glyphs;
-}
+	run->resize( numGlyphs );
+
+	for( size_t i = 0; i < numGlyphs; i++ ) {
+		uint32_t clusterEnd = i + 1 < numGlyphs ? run->clusters[i + 1] : (uint32_t)text.data.size();
+		run->clusterLengths[i] = clusterEnd - run->clusters[i];
+	}
+
+	// Simple runs don't know which glyphs looked past their text, they are never joined to others
+	run->unsafeToConcatAtStart = true;
+	run->unsafeToConcatAtEnd = true;
+
+	return run;
+}
+
+const FontManager::SimpleShapingTable::Sequence& Shaper::getSequence( FontManager::SimpleShapingTable& table, hb_font_t* font, hb_shape_plan_t* plan, const hb_segment_properties_t& properties, const uint8_t* codepoints, unsigned int length )
+{
+	uint32_t key = 0;
+	uint32_t unicodes[3];
+
+	for( unsigned int i = 0; i < length; i++ ) {
+		key = key << 8 | codepoints[i];
+		unicodes[i] = codepoints[i];
+	}
+
+	// Triples start with a character from 0x09 up, their keys never collide with pairs
+	FontManager::SimpleShapingTable::Sequence& sequence = length == 1 ? table.characters[key] : table.sequences[key];
+
+	if( sequence.numGlyphs >= 0 ) {
+		return sequence;
+	}
+
+	if( ! mBuffer ) {
+		mBuffer = FontManager::get()->acquireHarfbuzzBuffer();
+	}
+
+	hb_buffer_clear_contents( mBuffer );
+	hb_buffer_add_utf32( mBuffer, unicodes, length, 0, length );
+	hb_buffer_set_segment_properties( mBuffer, &properties );
+
+	hb_feature_t features[4];
+	unsigned int numFeatures = mFeatures.getHarfbuzzFeatures( features );
+	hb_shape_plan_execute( plan, font, mBuffer, features, numFeatures );
+
+	unsigned int numGlyphs;
+	hb_glyph_info_t* glyphInfo = hb_buffer_get_glyph_infos( mBuffer, &numGlyphs );
+	hb_glyph_position_t* glyphPos = hb_buffer_get_glyph_positions( mBuffer, &numGlyphs );
+
+	sequence.numGlyphs = numGlyphs <= 2 ? (int8_t)numGlyphs : 0;
+
+	for( unsigned int i = 0; i < numGlyphs && sequence.numGlyphs; i++ ) {
+		if( glyphPos[i].x_offset || glyphPos[i].y_offset || glyphPos[i].y_advance ) {
+			sequence.numGlyphs = 0;
+		}
+		else {
+			sequence.glyphs[i] = glyphInfo[i].codepoint;
+			sequence.advances[i] = glyphPos[i].x_advance;
+		}
+	}
+
+	if( numGlyphs == 2 ) {
+		sequence.cluster = (uint8_t)glyphInfo[1].cluster;
+	}
+
+	return sequence;
+}
 
 } } // namespace cinder::text
@@ -2,6 +2,7 @@
 
 #include "cinder/Vector.h"
 #include "cinder/text/Font.h"
+#include "cinder/text/FontManager.h"
 #include "cinder/text/Types.h"
 
 #include <memory>
@@ -24,38 +25,100 @@ class Shaper
 		CALT
 	};
 
+	// Features switched on or off for shaping, the others keep the font's default
+	// The same changes in any order or repeated give the same set, shape plans are cached by getKey()
+	class FeatureSet {
+	  public:
+		FeatureSet() : mEnabled( 0 ), mDisabled( 0 ) {}
+
+		FeatureSet& add( Feature feature ) { mEnabled |= getBit( feature ); mDisabled &= ~getBit( feature ); return *this; }
+		FeatureSet& remove( Feature feature ) { mDisabled |= getBit( feature ); mEnabled &= ~getBit( feature ); return *this; }
+		//! Leaves the feature at the font's default
+		FeatureSet& reset( Feature feature ) { mEnabled &= ~getBit( feature ); mDisabled &= ~getBit( feature ); return *this; }
+
+		uint16_t getKey() const { return uint16_t( mEnabled | mDisabled << 8 ); }
+		//! Writes the set as Harfbuzz features in a fixed order, returns how many (at most one per Feature)
+		unsigned int getHarfbuzzFeatures( hb_feature_t* features ) const;
+
+		bool operator==( const FeatureSet& other ) const { return getKey() == other.getKey(); }
+		//! Whether the feature is switched off, rather than left at the font's default
+		bool isRemoved( Feature feature ) const { return ( mDisabled & getBit( feature ) ) != 0; }
+
+	  private:
+		static uint8_t getBit( Feature feature ) { return uint8_t( 1 << feature ); }
+
+		uint8_t mEnabled;
+		uint8_t mDisabled;
+	};
+
 	typedef struct {
 		std::string data;
 		std::string language;
 		Script script;
 		Direction direction;
-		const char* c_data() { return data.c_str(); };
+		const char* c_data() const { return data.c_str(); };
 	} Text;
 
+	// A shaped glyph, its text is the byte range cluster, clusterLength of the shaped text
 	typedef struct {
 		uint32_t index;
 
 		ci::vec2 offset;
 		ci::vec2 advance;
 		uint32_t cluster;
-		std::string text;
-		std::vector<int> textIndices;
+		uint32_t clusterLength;
 	} Glyph;
 
-	Shaper( const Font& font );
+	// Shaped glyphs in logical order as parallel arrays, see FontManager::ShapedRun
+	typedef FontManager::ShapedRun Glyphs;
+	typedef FontManager::ShapedRunRef GlyphsRef;
+
+	//! The Harfbuzz font and buffer come from the FontManager, constructing a Shaper allocates neither
+	//! Shaped runs are cached by the FontManager, see FontManager::findShapedRun()
+	Shaper( const Font& font, const FeatureSet& features = FeatureSet() );
 	~Shaper();
 
-	std::vector<Shaper::Glyph> getShapedText( Text& text );
+	//! Returns the text's glyphs, shared with the shaping cache instead of copied. nullptr if the font couldn't be used.
+	GlyphsRef shape( const Text& text );
+	//! Returns a copy of the text's glyphs as Glyph structs
+	std::vector<Shaper::Glyph> getShapedText( const Text& text );
 	void addFeature( Feature feature );
 	void removeFeature( Feature feature );
 
+	//! Shapes text word by word so words shared by different texts are shaped once, on by default
+	//! Words are separated after whitespace, no-break spaces excepted. Text whose shaping crosses a word boundary (a kerning
+	//! pair or ligature with a space, a contextual lookup that could reach the next word, ...) is shaped as a whole, the glyphs
+	//! are the same either way. Harfbuzz flags those boundaries conservatively: fonts with many contextual lookups or kerning
+	//! on spaces join few words, Arabic ones hardly any. Needs Harfbuzz 4.0 or later.
+	void setWordShaping( bool wordShaping ) { mWordShaping = wordShaping; }
+	bool isWordShaping() const { return mWordShaping; }
+	//! Shapes simple text from tables of the font's Harfbuzz output instead of with Harfbuzz, on by default
+	//! Simple text is left to right Latin, Common or unset script text of Latin-1 characters, in a font without contextual
+	//! features (calt, clig, rclt, curs) or required ligatures (rlig). Standard ligatures (liga) longer than three characters,
+	//! or of three without a two character one at their start or end, need liga removed.
+	//! Glyphs come from the characters, kerned pairs and two character ligatures the font shaped alone, see
+	//! FontManager::SimpleShapingTable. Text they can't represent is shaped with Harfbuzz, the glyphs are the same either way.
+	void setSimpleShaping( bool simpleShaping ) { mSimpleShaping = simpleShaping; }
+	bool isSimpleShaping() const { return mSimpleShaping; }
+
   private:
-	// Harfbuzz
-	hb_font_t* 	getHarfbuzzFont( Font& font ) { return mFont; };
+	// Returns a run from the shaping cache, shaping + storing it if needed
+	// Words of a run are shaped with Harfbuzz, simple runs can't tell if they are safe to join
+	FontManager::ShapedRunRef getShapedRun( const Text& text, bool byWords, bool simple );
+	// Joins the cached runs of the text's words, nullptr if they can't be joined
+	FontManager::ShapedRunRef shapeWords( const Text& text );
+	// Shapes a run with Harfbuzz, in logical order
+	FontManager::ShapedRunRef shapeRun( const Text& text );
+	// Shapes a run from the font's simple shaping table, nullptr if it isn't simple text
+	FontManager::ShapedRunRef shapeSimpleRun( const Text& text );
+	// Shapes one to three characters into the simple shaping table with Harfbuzz
+	const FontManager::SimpleShapingTable::Sequence& getSequence( FontManager::SimpleShapingTable& table, hb_font_t* font, hb_shape_plan_t* plan, const hb_segment_properties_t& properties, const uint8_t* codepoints, unsigned int length );
 
-	hb_font_t* 					mFont;
-	hb_buffer_t*				mBuffer;
-	std::vector<hb_feature_t>	mFeatures;
+	Font						mFont;
+	hb_buffer_t*				mBuffer;	// from FontManager's buffer pool on the first shaped run, returned on destruction
+	FeatureSet					mFeatures;
+	bool						mWordShaping;
+	bool						mSimpleShaping;
 };
 
 } } // namespace cinder::text
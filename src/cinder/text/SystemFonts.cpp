@@ -7,13 +7,44 @@
 	#include "cinder/msw/cindermswgdiplus.h"
 	#include <strsafe.h>
 #elif defined( CINDER_MAC )
+	#include "cinder/Log.h"
 	#include <CoreText/CoreText.h>
+	#include <freetype/ft2build.h>
+	#include FT_FREETYPE_H
+#elif defined( CINDER_LINUX )
+	#include "cinder/Log.h"
+	#include "cinder/text/FontIndex.h"
+	#include <chrono>
+	#include <sstream>
 #endif
 
+#include <algorithm>
+#include <cstdlib>
 #include <unordered_map>
 
 namespace cinder { namespace text {
 
+void SystemFonts::setIndexDirectory( const ci::fs::path& directory )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	mIndexDirectory = directory;
+}
+
+ci::fs::path SystemFonts::getDefaultIndexDirectory()
+{
+	const char* home = std::getenv( "HOME" );
+	const char* cacheHome = std::getenv( "XDG_CACHE_HOME" );
+
+	if( cacheHome && *cacheHome ) {
+		return ci::fs::path( cacheHome ) / "cinder-text";
+	}
+	else if( home && *home ) {
+		return ci::fs::path( home ) / ".cache" / "cinder-text";
+	}
+
+	return ci::fs::temp_directory_path() / "cinder-text";
+}
+
 // Windows
 #if defined( CINDER_MSW_DESKTOP )
 HDC mFontDC = nullptr;
@@ -89,6 +120,8 @@ void SystemFonts::listFaces()
 
 ci::BufferRef SystemFonts::getFontBuffer( std::string family, std::string style )
 {
+	std::lock_guard<std::mutex> lock( mMutex );
+
 	::LOGFONT lf;
 	lf.lfCharSet = ANSI_CHARSET;
 	lf.lfFaceName[0] = '\0';
@@ -126,9 +159,16 @@ ci::BufferRef SystemFonts::getFontBuffer( std::string family, std::string style
 	}
 }
 
+ci::fs::path SystemFonts::getFontPath( std::string family, std::string style, uint32_t* faceIndex )
+{
+	// GDI only hands out font data
+	return ci::fs::path();
+}
+
 #elif defined( CINDER_COCOA )
 
 SystemFonts::SystemFonts()
+	: mEnumerated( false )
 {
 	mDefaultFamily = "ArialMT";
 	mDefaultStyle = "Regular";
@@ -174,6 +214,8 @@ void SystemFonts::listFaces()
 
 ci::BufferRef SystemFonts::getFontBuffer( std::string family, std::string style )
 {
+	std::lock_guard<std::mutex> lock( mMutex );
+
 	return std::make_shared<ci::Buffer>( ci::loadFile( mSystemNameToPath["ArialMT"] ) );
 	
 	if( mSystemNameToPath.find( family ) != mSystemNameToPath.end() ) 
@@ -181,6 +223,389 @@ ci::BufferRef SystemFonts::getFontBuffer( std::string family, std::string style
 	else
 		return ci::BufferRef();
 }
-#endif // defined( CINDER_COCOA )
+
+static std::string getStringAttribute( CTFontDescriptorRef descriptor, CFStringRef attribute )
+{
+	CFStringRef value = (CFStringRef)::CTFontDescriptorCopyAttribute( descriptor, attribute );
+
+	if( ! value ) {
+		return std::string();
+	}
+
+	char buffer[1024];
+	bool copied = ::CFStringGetCString( value, buffer, sizeof( buffer ), kCFStringEncodingUTF8 );
+	::CFRelease( value );
+
+	return copied ? std::string( buffer ) : std::string();
+}
+
+// CoreText doesn't say which face of a collection (.ttc/.otc) a font is, match its faces by postscript name
+static std::unordered_map<std::string,uint32_t> getCollectionFaceIndices( FT_Library library, const ci::fs::path& path )
+{
+	std::unordered_map<std::string,uint32_t> faceIndices;
+	FT_Long numFaces = 1;
+
+	for( FT_Long faceIndex = 0; faceIndex < numFaces; faceIndex++ ) {
+		FT_Face face;
+
+		if( FT_New_Face( library, path.string().c_str(), faceIndex, &face ) != FT_Err_Ok ) {
+			break;
+		}
+
+		numFaces = face->num_faces;
+		const char* postscriptName = FT_Get_Postscript_Name( face );
+
+		if( postscriptName ) {
+			faceIndices[postscriptName] = static_cast<uint32_t>( faceIndex );
+		}
+
+		FT_Done_Face( face );
+	}
+
+	return faceIndices;
+}
+
+void SystemFonts::enumerateFaces()
+{
+	mEnumerated = true;
+
+	CTFontCollectionRef collection = ::CTFontCollectionCreateFromAvailableFonts( NULL );
+	CFArrayRef descriptors = ::CTFontCollectionCreateMatchingFontDescriptors( collection );
+	CFIndex count = descriptors ? ::CFArrayGetCount( descriptors ) : 0;
+
+	FT_Library library = NULL;
+	std::unordered_map<std::string,std::unordered_map<std::string,uint32_t>> collectionFaceIndices;
+	std::unordered_map<std::string,uint32_t> pathIndices;
+	size_t numFaces = 0;
+
+	for( CFIndex i = 0; i < count; i++ ) {
+		CTFontDescriptorRef descriptor = (CTFontDescriptorRef)::CFArrayGetValueAtIndex( descriptors, i );
+		CFURLRef url = (CFURLRef)::CTFontDescriptorCopyAttribute( descriptor, kCTFontURLAttribute );
+
+		if( ! url ) {
+			continue;
+		}
+
+		char path[4096];
+		bool hasPath = ::CFURLGetFileSystemRepresentation( url, true, (UInt8*)path, sizeof( path ) );
+		::CFRelease( url );
+
+		std::string family = getStringAttribute( descriptor, kCTFontFamilyNameAttribute );
+		std::string style = getStringAttribute( descriptor, kCTFontStyleNameAttribute );
+		std::string postscriptName = getStringAttribute( descriptor, kCTFontNameAttribute );
+
+		if( ! hasPath || family.empty() ) {
+			continue;
+		}
+
+		std::transform( family.begin(), family.end(), family.begin(), ::tolower );
+		std::transform( style.begin(), style.end(), style.begin(), ::tolower );
+
+		std::vector<SystemFace>& styles = mFamilies[family];
+
+		if( std::any_of( styles.begin(), styles.end(), [&style]( const SystemFace& face ) { return face.style == style; } ) ) {
+			continue;
+		}
+
+		SystemFace face;
+		face.style = style;
+		face.faceIndex = 0;
+
+		std::string extension = ci::fs::path( path ).extension().string();
+		std::transform( extension.begin(), extension.end(), extension.begin(), ::tolower );
+
+		if( extension == ".ttc" || extension == ".otc" ) {
+			auto collectionIt = collectionFaceIndices.find( path );
+
+			if( collectionIt == collectionFaceIndices.end() ) {
+				if( ! library && FT_Init_FreeType( &library ) != FT_Err_Ok ) {
+					library = NULL;
+					continue;
+				}
+
+				collectionIt = collectionFaceIndices.emplace( path, getCollectionFaceIndices( library, path ) ).first;
+			}
+
+			auto faceIndexIt = collectionIt->second.find( postscriptName );
+
+			// Without a match the style would open the wrong face
+			if( faceIndexIt == collectionIt->second.end() ) {
+				continue;
+			}
+
+			face.faceIndex = faceIndexIt->second;
+		}
+
+		auto pathIt = pathIndices.find( path );
+
+		if( pathIt == pathIndices.end() ) {
+			pathIt = pathIndices.emplace( path, static_cast<uint32_t>( mPaths.size() ) ).first;
+			mPaths.push_back( ci::fs::path( path ) );
+		}
+
+		face.pathIndex = pathIt->second;
+		styles.push_back( face );
+		numFaces++;
+	}
+
+	if( library ) {
+		FT_Done_FreeType( library );
+	}
+
+	if( descriptors ) {
+		::CFRelease( descriptors );
+	}
+
+	::CFRelease( collection );
+
+	CI_LOG_I( "Found " << numFaces << " system faces in " << mFamilies.size() << " families." );
+}
+
+ci::fs::path SystemFonts::getFontPath( std::string family, std::string style, uint32_t* faceIndex )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	const SystemFace* face = findFace( family, style );
+
+	if( face ) {
+		if( faceIndex ) {
+			*faceIndex = face->faceIndex;
+		}
+
+		return mPaths[face->pathIndex];
+	}
+
+	// A postscript name names a single face, its style is part of the name
+	auto it = mSystemNameToPath.find( family );
+
+	if( it == mSystemNameToPath.end() ) {
+		return ci::fs::path();
+	}
+
+	if( faceIndex ) {
+		*faceIndex = 0;
+	}
+
+	return it->second;
+}
+
+#elif defined( CINDER_LINUX )
+
+// Same directories fontconfig searches by default, system fonts first
+static std::vector<ci::fs::path> getFontDirectories()
+{
+	std::vector<ci::fs::path> directories = { "/usr/share/fonts", "/usr/local/share/fonts" };
+
+	const char* home = std::getenv( "HOME" );
+	const char* dataHome = std::getenv( "XDG_DATA_HOME" );
+
+	if( dataHome && *dataHome ) {
+		directories.push_back( ci::fs::path( dataHome ) / "fonts" );
+	}
+	else if( home && *home ) {
+		directories.push_back( ci::fs::path( home ) / ".local" / "share" / "fonts" );
+	}
+
+	if( home && *home ) {
+		directories.push_back( ci::fs::path( home ) / ".fonts" );
+	}
+
+	return directories;
+}
+
+SystemFonts::SystemFonts()
+	: mEnumerated( false )
+{
+	// Styles named Book or Roman match Regular, see findFace()
+	mDefaultFamily = "DejaVu Sans";
+	mDefaultStyle = "Regular";
+	mDefaultSize = 12;
+}
+
+void SystemFonts::enumerateFaces()
+{
+	mEnumerated = true;
+
+	auto startTime = std::chrono::steady_clock::now();
+	size_t numFaces = 0;
+
+	// Only write indices where we were asked to
+	bool useIndex = ! mIndexDirectory.empty();
+
+	try {
+		if( useIndex ) {
+			ci::fs::create_directories( mIndexDirectory );
+		}
+	}
+	catch( const std::exception& exc ) {
+		CI_LOG_W( "Could not create the font index directory " << mIndexDirectory << ", scanning without an index: " << exc.what() );
+		useIndex = false;
+	}
+
+	for( const auto& directory : getFontDirectories() ) {
+		// Missing or unreadable directories are skipped, is_directory() would throw for the latter
+		std::error_code error;
+
+		if( ! ci::fs::is_directory( directory, error ) ) {
+			continue;
+		}
+
+		std::vector<FontIndex::Entry> entries;
+
+		if( useIndex ) {
+			// Each directory keeps its own index, later lookups only reopen files that changed
+			std::stringstream indexName;
+			indexName << "system-fonts-" << std::hex << std::hash<std::string>()( directory.string() ) << ".idx";
+
+			FontIndexRef index = FontIndex::create( directory, mIndexDirectory / indexName.str() );
+
+			for( size_t i = 0; index && i < index->getNumEntries(); i++ ) {
+				entries.push_back( index->getEntry( i ) );
+			}
+		}
+		else {
+			FontIndex::scan( directory, entries );
+		}
+
+		for( const auto& entry : entries ) {
+			std::string family = entry.family;
+			std::string style = entry.style;
+			std::transform( family.begin(), family.end(), family.begin(), ::tolower );
+			std::transform( style.begin(), style.end(), style.begin(), ::tolower );
+
+			// The first directory with a family + style wins
+			std::vector<SystemFace>& styles = mFamilies[family];
+
+			if( std::any_of( styles.begin(), styles.end(), [&style]( const SystemFace& face ) { return face.style == style; } ) ) {
+				continue;
+			}
+
+			// Faces of a file are listed together, so each path is only stored once
+			if( mPaths.empty() || mPaths.back() != entry.path ) {
+				mPaths.push_back( entry.path );
+			}
+
+			SystemFace face;
+			face.style = style;
+			face.pathIndex = static_cast<uint32_t>( mPaths.size() - 1 );
+			face.faceIndex = entry.faceIndex;
+			styles.push_back( face );
+
+			numFaces++;
+		}
+	}
+
+	// Approximate size of the lookup table
+	size_t tableBytes = mPaths.capacity() * sizeof( ci::fs::path );
+
+	for( const auto& path : mPaths ) {
+		tableBytes += path.native().capacity();
+	}
+
+	for( const auto& family : mFamilies ) {
+		tableBytes += family.first.capacity() + family.second.capacity() * sizeof( SystemFace );
+
+		for( const auto& face : family.second ) {
+			tableBytes += face.style.capacity();
+		}
+	}
+
+	auto duration = std::chrono::duration_cast<std::chrono::milliseconds>( std::chrono::steady_clock::now() - startTime );
+	CI_LOG_I( "Found " << numFaces << " system faces in " << mFamilies.size() << " families in " << duration.count() << " ms, the font table uses " << tableBytes / 1024 << " KB." );
+}
+
+void SystemFonts::listFaces()
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	if( ! mEnumerated ) {
+		enumerateFaces();
+	}
+
+	for( auto& family : mFamilies ) {
+		ci::app::console() << family.first << std::endl;
+		ci::app::console() << "---------------------" << std::endl;
+
+		for( auto& face : family.second ) {
+			ci::app::console() << face.style << std::endl;
+		}
+
+		ci::app::console() << std::endl;
+	}
+}
+
+ci::BufferRef SystemFonts::getFontBuffer( std::string family, std::string style )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	const SystemFace* face = findFace( family, style );
+
+	if( ! face ) {
+		return ci::BufferRef();
+	}
+
+	return std::make_shared<ci::Buffer>( ci::loadFile( mPaths[face->pathIndex] ) );
+}
+
+ci::fs::path SystemFonts::getFontPath( std::string family, std::string style, uint32_t* faceIndex )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	const SystemFace* face = findFace( family, style );
+
+	if( ! face ) {
+		return ci::fs::path();
+	}
+
+	if( faceIndex ) {
+		*faceIndex = face->faceIndex;
+	}
+
+	return mPaths[face->pathIndex];
+}
+#endif // defined( CINDER_LINUX )
+
+#if defined( CINDER_LINUX ) || defined( CINDER_COCOA )
+
+const SystemFonts::SystemFace* SystemFonts::findFace( std::string family, std::string style )
+{
+	if( ! mEnumerated ) {
+		enumerateFaces();
+	}
+
+	std::transform( family.begin(), family.end(), family.begin(), ::tolower );
+	std::transform( style.begin(), style.end(), style.begin(), ::tolower );
+
+	auto familyIt = mFamilies.find( family );
+
+	if( familyIt == mFamilies.end() ) {
+		return nullptr;
+	}
+
+	auto findStyle = [&familyIt]( const std::string& style ) -> const SystemFace* {
+		for( const auto& face : familyIt->second ) {
+			if( face.style == style ) {
+				return &face;
+			}
+		}
+
+		return nullptr;
+	};
+
+	const SystemFace* face = findStyle( style );
+
+	// Fonts often name their regular style differently (Book, Roman)
+	if( ! face && style == "regular" ) {
+		for( auto regularStyle : { "book", "roman", "normal" } ) {
+			if( ( face = findStyle( regularStyle ) ) != nullptr ) {
+				break;
+			}
+		}
+	}
+
+	return face;
+}
+
+#endif
 
 } } // namespace cinder::text
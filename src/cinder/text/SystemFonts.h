@@ -5,6 +5,8 @@
 
 #include <memory>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 
 namespace cinder { namespace text {
 
@@ -19,6 +21,16 @@ class SystemFonts {
 	};
 
 	ci::BufferRef getFontBuffer( std::string family, std::string style );
+	//! Returns the file of a system font so it can be memory mapped, empty if the platform can't tell
+	//! faceIndex is set to the face's index in font collections
+	ci::fs::path getFontPath( std::string family, std::string style, uint32_t* faceIndex = nullptr );
+
+	//! Linux: keeps an index of each font directory in directory, so later runs only reopen font files that changed.
+	//! Off by default, the font directories are then scanned on the first lookup without writing anything to disk.
+	//! Call this before the first lookup, other platforms ignore it.
+	void setIndexDirectory( const ci::fs::path& directory );
+	//! The user's cache directory for font indices, $XDG_CACHE_HOME/cinder-text or ~/.cache/cinder-text
+	static ci::fs::path getDefaultIndexDirectory();
 
 	std::string getDefaultFamily() { return mDefaultFamily; };
 	std::string getDefaultStyle() { return mDefaultStyle; };
@@ -31,6 +43,28 @@ class SystemFonts {
 	std::map<std::string,std::vector<std::string>> 	mFaces;
 	std::map<std::string,ci::fs::path>				mSystemNameToPath;
 
+	// Fonts can be requested from any thread that loads faces
+	std::mutex										mMutex;
+
+	ci::fs::path									mIndexDirectory;
+
+#if defined( CINDER_LINUX ) || defined( CINDER_COCOA )
+	// Lowercase style of a family, refers to its file by index into mPaths
+	struct SystemFace {
+		std::string	style;
+		uint32_t	pathIndex;
+		uint32_t	faceIndex;
+	};
+
+	// Fonts are listed on the first lookup, not at startup
+	void enumerateFaces();
+	const SystemFace* findFace( std::string family, std::string style );
+
+	bool												mEnumerated;
+	std::unordered_map<std::string,std::vector<SystemFace>>	mFamilies;
+	std::vector<ci::fs::path>							mPaths;
+#endif
+
 	std::string	mDefaultFamily;
 	std::string	mDefaultStyle;
 	int			mDefaultSize;
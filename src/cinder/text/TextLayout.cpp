@@ -9,53 +9,12 @@
 
 namespace cinder { namespace text {
 
-bool isWhitespace( const Font& font, uint32_t codepoint )
-{
-	std::string separatorSpaces;
-	separatorSpaces += ' '; // SPACE
-	separatorSpaces += u'\u00A0'; // NO-BREAK SPACE
-	separatorSpaces += u'\u1680'; // OGHAM SPACE MARK
-	separatorSpaces += u'\u2000'; // EN QUAD
-	separatorSpaces += u'\u2001'; // EM QUAD
-	separatorSpaces += u'\u2002'; // EN SPACE
-	separatorSpaces += u'\u2003'; // EM SPACE
-	separatorSpaces += u'\u2004'; // THREE-PER-EM SPACE
-	separatorSpaces += u'\u2005'; // FOUR-PER-EM SPACE
-	separatorSpaces += u'\u2006'; // SIX-PER-EM SPACE
-	separatorSpaces += u'\u2007'; // FIGURE SPACE
-	separatorSpaces += u'\u2008'; // PUNCTUATION SPACE
-	separatorSpaces += u'\u2009'; // THIN SPACE
-	separatorSpaces += u'\u200A'; // HAIR SPACE
-	separatorSpaces += u'\u202F'; // NARROW NO-BREAK SPACE
-	separatorSpaces += u'\u205F'; // MEDIUM MATHEMATICAL SPACE
-	separatorSpaces += u'\u3000'; // IDEOGRAPHIC SPACE
-
-	std::vector<uint32_t> separatorSpaceIndices = FontManager::get()->getGlyphIndices( font, separatorSpaces );
-
-	std::vector<uint32_t>::iterator iter = std::find( separatorSpaceIndices.begin(), separatorSpaceIndices.end(), codepoint );
-
-	if( iter == separatorSpaceIndices.end() ) {
-		return false;
-	}
-
-	return true;
-
-	FT_UInt spaceIndex = FontManager::get()->getGlyphIndex( font, ' ' );
-	return codepoint == spaceIndex;
-}
-
-bool isNewline( Font& font, int codepoint )
-{
-	FT_UInt newLineIndex = FontManager::get()->getGlyphIndex( font, '\u000A' );
-	return newLineIndex == codepoint;
-}
-
 int calculateShapedGlyphsLength( const std::vector<Layout::Glyph>& glyphs )
 {
 	int length = 0;
 
 	for( const auto& glyph : glyphs ) {
-		length += glyph.value.length();
+		length += glyph.clusterLength;
 	}
 
 	return length;
@@ -64,17 +23,16 @@ int calculateShapedGlyphsLength( const std::vector<Layout::Glyph>& glyphs )
 Layout::Layout()
 	: mFont( DefaultFont() )
 	, mColor( ci::Color( 1.f, 1.f, 1.f ) )
-	, mTracking( 0 )
-	, mUseLigatures( true )
-	, mUseKerning( true )
-	, mUseClig( true )
-	, mUseCalt( true )
 	, mAlignment( Alignment::LEFT )
 	, mUseDefaultAlignment( true )
-	, mSize( GROW )
+	, mTracking( 0 )
+	, mUseWordShaping( true )
+	, mUseSimpleShaping( true )
+	, mSubpixelPhases( 1 )
 	, mLanguage( "en" )
 	, mScript( Script::LATIN )
 	, mDirection( Direction::LTR )
+	, mSize( GROW )
 	, mMaxLinesReached( false )
 {
 	//const std::string testString( "testing test opportunity" );
@@ -131,12 +89,18 @@ void Layout::calculateLayout( std::string text )
 
 void Layout::calculateLayout( const AttributedString& attrString )
 {
+	// The fonts held by the layout's runs are reported as the layout's in FontManager::getFontUsage()
+	FontManager::ScopedFontOwner fontOwner( "Layout" );
+
 	resetLayout();
 
 	std::vector<AttributedString::Substring> substrings = attrString.getSubstrings();
 
+	// Glyphs refer to their text by byte offset in the substrings joined
+	size_t substringStart = 0;
+
 	// Go through each substring
-	for( int i = 0; i < substrings.size(); i++ ) {
+	for( int i = 0; i < substrings.size(); substringStart += substrings[i].text.size(), i++ ) {
 		AttributedString::Substring remainingSubstring = substrings[i];
 
 		// Keep track of the previous pass's size
@@ -148,10 +112,12 @@ void Layout::calculateLayout( const AttributedString& attrString )
 			// Don't bother continuing if we aren't going to display any more lines
 			if( mMaxLinesReached ) {
 				applyAlignment();
+				applySubpixelPositions();
 				return;
 			}
 
 			// Process the remaining characters of the substring
+			mTextOffset = substringStart + substrings[i].text.size() - remainingSubstring.text.size();
 			addSubstringToCurLine( remainingSubstring );
 
 			// Make sure we actually processed something
@@ -159,6 +125,7 @@ void Layout::calculateLayout( const AttributedString& attrString )
 				// Return to avoid infinite loop when a string or character
 				// will not fit our layout (too big)
 				applyAlignment();
+				applySubpixelPositions();
 				return;
 			}
 			else {
@@ -170,6 +137,7 @@ void Layout::calculateLayout( const AttributedString& attrString )
 
 	addCurLine();
 	applyAlignment();
+	applySubpixelPositions();
 }
 
 float Layout::getLineHeightForSubstring( const AttributedString::Substring& substring, const Font& runFont )
@@ -208,7 +176,7 @@ void Layout::addSubstringToCurLine( AttributedString::Substring& substring )
 	mCurDirection.x = direction == Direction::LTR ? 1 : -1;
 
 	// Create a run for this substring
-	const Font runFont( substring.attributes.fontFamily, substring.attributes.fontStyle, substring.attributes.fontSize );
+	const Font runFont = substring.attributes.getFont();
 	Run run( runFont, substring.attributes.color, substring.attributes.opacity );
 
 	// Store the previous line height in case we need to abort and go to a new line
@@ -238,24 +206,9 @@ void Layout::addSubstringToCurLine( AttributedString::Substring& substring )
 	lineBreaks.pop_back();
 
 	// Shape the substring
-	Shaper shaper( runFont );
-
-	//	Remove features if necessary
-	if( ! mUseLigatures ) {
-		shaper.removeFeature( cinder::text::Shaper::Feature::LIGATURES );
-	}
-
-	if( ! mUseKerning ) {
-		shaper.removeFeature( cinder::text::Shaper::Feature::KERNING );
-	}
-
-	if( ! mUseClig ) {
-		shaper.removeFeature( cinder::text::Shaper::Feature::CLIG );
-	}
-
-	if( ! mUseCalt ) {
-		shaper.removeFeature( cinder::text::Shaper::Feature::CALT );
-	}
+	Shaper shaper( runFont, mFeatures );
+	shaper.setWordShaping( mUseWordShaping );
+	shaper.setSimpleShaping( mUseSimpleShaping );
 
 	Shaper::Text shaperText = {
 		substring.text,
@@ -264,46 +217,54 @@ void Layout::addSubstringToCurLine( AttributedString::Substring& substring )
 		direction
 	};
 
-	std::vector<Shaper::Glyph> shapedGlyphs = shaper.getShapedText( shaperText );
+	// Read straight from the shaping cache, nothing is copied per glyph
+	Shaper::GlyphsRef shapedRun = shaper.shape( shaperText );
+
+	if( ! shapedRun ) {
+		addRunToCurLine( run );
+		substring.text.clear();
+		return;
+	}
+
+	const Shaper::Glyphs& shapedGlyphs = *shapedRun;
+
+	// Size metrics are the same for every glyph in the run
+	const FontManager::FontMetrics& fontMetrics = FontManager::get()->getFontMetrics( runFont );
+	float baseline = fontMetrics.baseline;
 
 	for( int i = 0; i < shapedGlyphs.size(); i++ ) {
 		// Get directional offset + advance
-		ci::vec2 offset = shapedGlyphs[i].offset * mCurDirection;
-		ci::vec2 advance = shapedGlyphs[i].advance * mCurDirection;
+		ci::vec2 offset = shapedGlyphs.offsets[i] * mCurDirection;
+		ci::vec2 advance = shapedGlyphs.advances[i] * mCurDirection;
 
 		// Add the offset (generally 0 for latin) to the pen pos
 		ci::vec2 pos = ci::vec2( mCharPos, mLinePos ) + offset;
 
-		// Get the glyph metrics/position
-		FT_BitmapGlyph bitmapGlyph = FontManager::get()->getGlyphBitmap( runFont, shapedGlyphs[i].index );
-		FT_Glyph g = FontManager::get()->getGlyph( runFont, shapedGlyphs[i].index );
+		// Get the glyph metrics/position (from the outline, nothing is rasterized)
+		FontManager::GlyphMetrics metrics = FontManager::get()->getGlyphMetrics( runFont, shapedGlyphs.indices[i] );
 		ci::vec2 glyphPos;
 		ci::Rectf glyphBBox;
 		ci::Rectf glyphExtents;
 
-		FT_BBox bbox;
-		FT_Glyph_Get_CBox( g, FT_GLYPH_BBOX_SUBPIXELS, &bbox );
- 		auto face = FontManager::get()->getFace( runFont );
-		double baseline = abs(face->descender) * mFont.getSize() / face->units_per_EM;
-		float ascent =  bbox.yMax/64.0;
-		vec2 bitmapSize = ci::vec2( bitmapGlyph->bitmap.width, bitmapGlyph->bitmap.rows );
+		float ascent = metrics.cbox.y2;
+		vec2 bitmapSize = ci::vec2( metrics.bitmapSize );
 		vec2 bitmapOffset;
 
 		if( direction == Direction::LTR ) {
-			bitmapOffset = ci::vec2( bitmapGlyph->left, mCurLineHeight - baseline - ascent );
+			bitmapOffset = ci::vec2( metrics.bitmapOffset.x, mCurLineHeight - baseline - ascent );
 			glyphPos = pos + bitmapOffset;
 			glyphBBox = ci::Rectf( glyphPos, glyphPos + bitmapSize );
 			glyphExtents = ci::Rectf( pos, pos + ci::vec2( advance.x + kerning, mCurLineHeight ) );
 		}
 		else {
-			bitmapOffset = - ci::vec2( shapedGlyphs[i].advance.x - bitmapGlyph->left, mCurLineHeight - baseline - ascent );
+			bitmapOffset = - ci::vec2( shapedGlyphs.advances[i].x - metrics.bitmapOffset.x, mCurLineHeight - baseline - ascent );
 			glyphPos = pos + bitmapOffset;
 			glyphBBox = ci::Rectf( glyphPos, glyphPos + bitmapSize );
 			glyphExtents = ci::Rectf( pos, pos + ci::vec2( advance.x + kerning, mCurLineHeight ) );
 		}
 
 		// Move the pen forward, except with white space at the beginning of a line
-		if( mCharPos != 0 || !isWhitespace( runFont, shapedGlyphs[i].index ) ) {
+		if( mCharPos != 0 || !FontManager::get()->isWhitespaceGlyph( runFont, shapedGlyphs.indices[i] ) ) {
 			mCharPos += advance.x + kerning;
 		}
 
@@ -338,18 +299,21 @@ void Layout::addSubstringToCurLine( AttributedString::Substring& substring )
 		}
 
 		// Create a layout glyph and add to run
-		Layout::Glyph glyph = { shapedGlyphs[i].index, glyphBBox, pos, bitmapSize, bitmapOffset, shapedGlyphs[i].text };
+		uint32_t cluster = shapedGlyphs.clusters[i];
+		uint32_t clusterLength = shapedGlyphs.clusterLengths[i];
+
+		Layout::Glyph glyph = { shapedGlyphs.indices[i], glyphBBox, pos, bitmapSize, bitmapOffset, uint32_t( mTextOffset + cluster ), clusterLength };
 		run.glyphs.push_back( glyph );
 
 		// Check for forced line breaks
-		for( auto& index : shapedGlyphs[i].textIndices ) {
+		for( uint32_t index = cluster; index < cluster + clusterLength && index < lineBreaks.size(); index++ ) {
 			if( lineBreaks[index] == ci::UNICODE_MUST_BREAK ) {
 				// Add the current run then move to next line
 				addRunToCurLine( run );
 				addCurLine();
 
 				// Clip the substring after the break
-				int clipStart = shapedGlyphs[i].textIndices.back() + 1;
+				int clipStart = cluster + clusterLength;
 
 				if( clipStart < substring.text.size() ) {
 					substring.text = substring.text.substr( clipStart, std::string::npos );
@@ -450,14 +414,11 @@ void Layout::applyAlignment()
 				int totalWhitespaces = 0;
 
 				for( auto& run : mLines[i].runs ) {
-					// Get the char index for whitespace given this run's font
-					FT_UInt spaceIndex = FontManager::get()->getGlyphIndex( run.font, ' ' );
-
 					int index = 0;
 
 					for( auto& glyph : run.glyphs ) {
 						glyphRefs.push_back( &glyph );
-						bool isWhitespace = index != 0 && glyph.index == spaceIndex;
+						bool isWhitespace = index != 0 && FontManager::get()->isWhitespaceGlyph( run.font, glyph.index );
 
 						if( isWhitespace ) {
 							totalWhitespaces++;
@@ -484,18 +445,20 @@ void Layout::applyAlignment()
 	}
 }
 
-Layout::BreakIndices Layout::getClosestBreakForShapedText( int startIndex, const std::vector<Shaper::Glyph>& shapedGlyphs, const std::vector<uint8_t> lineBreaks, Direction direction )
+Layout::BreakIndices Layout::getClosestBreakForShapedText( int startIndex, const Shaper::Glyphs& shapedGlyphs, const std::vector<uint8_t>& lineBreaks, Direction direction )
 {
 	Layout::BreakIndices indices;
 
 	for( int i = startIndex; i >= 0; i-- ) {
 		if( indices.found ) { break; }
 
-		// Unpack the glyph's cluster
-		for( int j = shapedGlyphs[i].textIndices.size() - 1; j >= 0; j-- ) {
+		// Walk the glyph's text backwards
+		int cluster = shapedGlyphs.clusters[i];
+
+		for( int j = std::min<int>( cluster + shapedGlyphs.clusterLengths[i], lineBreaks.size() ) - 1; j >= cluster; j-- ) {
 			// Look for allowed breaks
-			if( lineBreaks[shapedGlyphs[i].textIndices[j]] == ci::UNICODE_ALLOW_BREAK ) {
-				indices.textBreakIndex = shapedGlyphs[i].textIndices[j];
+			if( lineBreaks[j] == ci::UNICODE_ALLOW_BREAK ) {
+				indices.textBreakIndex = j;
 				indices.glyphBreakIndex = i;
 				indices.found = true;
 				break;
@@ -506,4 +469,38 @@ Layout::BreakIndices Layout::getClosestBreakForShapedText( int startIndex, const
 	return indices;
 }
 
+void Layout::applySubpixelPositions()
+{
+	if( mSubpixelPhases <= 1 ) {
+		return;
+	}
+
+	// Snap each glyph origin to the nearest phase, and use the bitmap bounds of the glyph rasterized at that phase
+	for( auto& line : mLines ) {
+		for( auto& run : line.runs ) {
+			for( auto& glyph : run.glyphs ) {
+				FontManager::GlyphMetrics metrics = FontManager::get()->getGlyphMetrics( run.font, glyph.index );
+				float origin = glyph.bbox.x1 - metrics.bitmapOffset.x;
+				float pixel = floorf( origin );
+				int phase = int( roundf( ( origin - pixel ) * mSubpixelPhases ) );
+
+				if( phase == mSubpixelPhases ) {
+					phase = 0;
+					pixel += 1.f;
+				}
+
+				metrics = FontManager::get()->getSubpixelGlyphMetrics( run.font, glyph.index, phase, mSubpixelPhases );
+				float x1 = pixel + metrics.bitmapOffset.x;
+
+				// The offset moves with the box, so position + offset stays in step with it
+				glyph.offset.x += x1 - glyph.bbox.x1;
+				glyph.bbox = ci::Rectf( x1, glyph.bbox.y1, x1 + metrics.bitmapSize.x, glyph.bbox.y2 );
+				glyph.size.x = metrics.bitmapSize.x;
+				glyph.subpixelPhase = phase;
+				glyph.subpixelPhases = mSubpixelPhases;
+			}
+		}
+	}
+}
+
 } } // namespace cinder::text
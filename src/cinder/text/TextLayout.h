@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -26,7 +27,10 @@ class Layout {
 		ci::vec2 position;		// upper left position of glyph
 		ci::vec2 size;			// size of glyph
 		ci::vec2 offset;		// position offset of glyph
-		std::string value;
+		uint32_t cluster;		// byte offset of the glyph's text in the laid out string
+		uint32_t clusterLength;	// byte length of the glyph's text, 0 for glyphs sharing their text with the next one
+		int subpixelPhase = 0;	// horizontal subpixel phase the glyph was snapped to, 0 - subpixelPhases - 1
+		int subpixelPhases = 1;	// number of phases the layout was calculated with, 0 or 1 without subpixel positioning
 	} Glyph;
 
 	// A group of characters with the same attributes
@@ -93,10 +97,19 @@ class Layout {
 	Layout& setTracking( float tracking ) { mTracking = cinder::text::Unit( tracking ); return *this; };
 	Layout& setTracking( const Unit& tracking ) { mTracking = tracking; return *this; };
 
-	Layout& setUseLigatures( const bool useLigatures ) { mUseLigatures = useLigatures; return *this; };
-	Layout& setUseKerning( const bool useKerning ) { mUseKerning = useKerning; return *this; };
-	Layout& setUseClig( const bool useClig ) { mUseClig = useClig; return *this; };
-	Layout& setUseCalt( const bool useCalt ) { mUseCalt = useCalt; return *this; };
+	Layout& setUseLigatures( const bool useLigatures ) { return setUseFeature( Shaper::Feature::LIGATURES, useLigatures ); };
+	Layout& setUseKerning( const bool useKerning ) { return setUseFeature( Shaper::Feature::KERNING, useKerning ); };
+	Layout& setUseClig( const bool useClig ) { return setUseFeature( Shaper::Feature::CLIG, useClig ); };
+	Layout& setUseCalt( const bool useCalt ) { return setUseFeature( Shaper::Feature::CALT, useCalt ); };
+	//! Shapes text word by word through the shaping cache, see Shaper::setWordShaping()
+	Layout& setUseWordShaping( const bool useWordShaping ) { mUseWordShaping = useWordShaping; return *this; };
+	//! Shapes simple Latin-1 text without Harfbuzz, see Shaper::setSimpleShaping()
+	Layout& setUseSimpleShaping( const bool useSimpleShaping ) { mUseSimpleShaping = useSimpleShaping; return *this; };
+
+	//! Horizontal subpixel positions per pixel (1, 2 or 4), glyph origins are rounded to the nearest phase instead of the nearest pixel
+	//! Each phase a glyph is used at is rasterized + cached separately, 1 (the default) keeps glyphs on whole pixels
+	int getSubpixelPhases() const { return mSubpixelPhases; }
+	Layout& setSubpixelPhases( int phases ) { mSubpixelPhases = std::max( 1, std::min( phases, 4 ) ); return *this; };
 
 	std::string getLanguage() const { return mLanguage; }
 	Layout& setLanguage( std::string language ) { mLanguage = language; return *this; }
@@ -134,10 +147,12 @@ private:
 	cinder::text::Unit mLineHeight;
 	cinder::text::Unit mTracking;
 
-	bool mUseLigatures;
-	bool mUseKerning;
-	bool mUseClig;
-	bool mUseCalt;
+	// Features in use keep the font's default, every run is shaped with this one set
+	Layout& setUseFeature( Shaper::Feature feature, bool use ) { use ? mFeatures.reset( feature ) : mFeatures.remove( feature ); return *this; }
+	Shaper::FeatureSet mFeatures;
+	bool mUseWordShaping;
+	bool mUseSimpleShaping;
+	int mSubpixelPhases;
 
 	std::string mLanguage;
 	Script mScript;
@@ -155,13 +170,14 @@ private:
 		int glyphBreakIndex = -1;
 		bool found = false;
 	};
-	BreakIndices getClosestBreakForShapedText( int startIndex, const std::vector<Shaper::Glyph>& shapedGlyphs, const std::vector<uint8_t> lineBreaks, Direction direction );
+	BreakIndices getClosestBreakForShapedText( int startIndex, const Shaper::Glyphs& shapedGlyphs, const std::vector<uint8_t>& lineBreaks, Direction direction );
 
 	ci::vec2 mCurDirection;
 	float mCharPos, mLinePos;
 	Line mCurLine;
 	float mCurLineWidth = 0;
 	float mCurLineHeight = 0;
+	size_t mTextOffset = 0;	// byte offset of the substring being added in the laid out string
 	std::vector<ci::Rectf> mGlyphBoxes;
 
 	float getLineHeightForSubstring( const AttributedString::Substring& substring, const Font& runFont );
@@ -170,6 +186,7 @@ private:
 	void addRunToCurLine( Run& run );
 	void addCurLine();
 	void applyAlignment();
+	void applySubpixelPositions();
 	std::vector<Line> mLines;
 
 	bool mMaxLinesReached = false;
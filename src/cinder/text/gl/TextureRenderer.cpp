@@ -17,11 +17,14 @@ using namespace std;
 namespace cinder { namespace text { namespace gl {
 
 // Shared font cache
-std::unordered_map<Font, TextureRenderer::FontCache> TextureRenderer::fontCache;
+std::unordered_map<uint32_t, TextureRenderer::FontCache> TextureRenderer::fontCache;
 
 bool							TextureRenderer::mSharedCacheEnabled = false;
 TextureRenderer::TexArrayCache	TextureRenderer::mSharedTexArrayCache;
 TextureArray::Format			TextureRenderer::mTextureArrayFormat;
+
+std::mutex										TextureRenderer::mPendingFontsMutex;
+std::deque<std::shared_ptr<TextureRenderer::PendingFont>>	TextureRenderer::mPendingFonts;
 #ifdef CINDER_TEXTURE_RENDERER_USE_TEXTURE2D
 std::vector<ci::gl::Texture2dRef>	 TextureRenderer::mTextures;
 #else
@@ -212,17 +215,19 @@ void TextureRenderer::render( const std::vector<cinder::text::Layout::Line>& lin
 			ci::gl::ScopedGlslProg scopedShader( ci::gl::getStockShader( ci::gl::ShaderDef().color() ) );
 			ci::gl::ScopedColor( ci::ColorA( run.color, run.opacity ) );
 
+			cacheSubpixelGlyphs( run );
+
 			for( auto& glyph : run.glyphs ) 
 			{	
 				// Make sure we have the glyph
-				if( TextureRenderer::getCacheForFont( run.font ).glyphs.count( glyph.index ) != 0 ) 
+				if( TextureRenderer::getCacheForFont( run.font ).glyphs.count( getGlyphKey( glyph ) ) != 0 ) 
 				{
 					ci::gl::ScopedMatrices matrices;
 					ci::gl::translate( ci::vec2( glyph.bbox.getUpperLeft() ) );
 					ci::gl::scale( glyph.bbox.getSize().x, glyph.bbox.getSize().y );
 
 					auto fontCache = getCacheForFont( run.font );
-					auto glyphCache = fontCache.glyphs[glyph.index];
+					auto glyphCache = fontCache.glyphs[getGlyphKey( glyph )];
 
 					//auto texIndex = fontCache.texArrayCache.texArray->getTextureBlockIndex( glyphCache.block );
 					auto tex = mTextures[glyphCache.block];
@@ -269,16 +274,18 @@ void TextureRenderer::cacheRun( std::unordered_map<int, BatchCacheData> &batchDa
 	auto font = run.font;
 	auto color = ci::ColorA( run.color, run.opacity );
 
+	cacheSubpixelGlyphs( run );
+
 	for( auto& glyph : run.glyphs ) 
 	{	
 		// Make sure we have the glyph
 		auto fontCache = getCacheForFont( font );
-		if( fontCache.glyphs.count( glyph.index ) != 0 ) 
+		if( fontCache.glyphs.count( getGlyphKey( glyph ) ) != 0 ) 
 		{
 			vec2 pos =  ci::vec2( glyph.position + glyph.offset);
 			vec2 size =  glyph.size;
 	
-			auto glyphCache = fontCache.glyphs[glyph.index];
+			auto glyphCache = fontCache.glyphs[getGlyphKey( glyph )];
 			int texIndex = glyphCache.block;
 
 			//textureSet.insert( texIndex );
@@ -516,6 +523,9 @@ TextureRenderer::LayoutCache TextureRenderer::cacheLayout( const cinder::text::L
 	std::unordered_map<int, BatchCacheData > glyphData;
 	ci::Rectf bounds = Rectf( vec2(), vec2( FLT_MAX) );
 
+	FontManager::ScopedFontOwner fontOwner( "LayoutCache" );
+	std::vector<Font> fonts;
+
 	int glyphCount = 0;
 	for( auto& line : layout.getLines() )
 	{
@@ -525,6 +535,9 @@ TextureRenderer::LayoutCache TextureRenderer::cacheLayout( const cinder::text::L
 			cacheRun( glyphData, run, runBounds );
 			bounds.include( runBounds );
 			glyphCount += run.glyphs.size();
+
+			if( std::find( fonts.begin(), fonts.end(), run.font ) == fonts.end() )
+				fonts.push_back( run.font );
 		}
 	}
 
@@ -540,6 +553,7 @@ TextureRenderer::LayoutCache TextureRenderer::cacheLayout( const cinder::text::L
 	//lineCache.vbomesh = batch.vboMesh;
 	//lineCache.shader = glyphShader;
 	lineCache.positionOffsets.resize( glyphCount, vec3() );
+	lineCache.fonts = fonts;
 	return lineCache;
 }
 
@@ -566,18 +580,25 @@ TextureRenderer::LayoutCache TextureRenderer::cacheLine( const cinder::text::Lay
 {
 	std::unordered_map<int, BatchCacheData > glyphData;
 	ci::Rectf bounds = Rectf( vec2(), vec2( FLT_MAX) );
+
+	FontManager::ScopedFontOwner fontOwner( "LayoutCache" );
+	std::vector<Font> fonts;
 	
 	for( auto& run : line.runs ) 
 	{
 		Rectf runBounds = Rectf( vec2(), vec2( FLT_MAX) );
 		cacheRun( glyphData, run, runBounds );
 		bounds.include( runBounds );
+
+		if( std::find( fonts.begin(), fonts.end(), run.font ) == fonts.end() )
+			fonts.push_back( run.font );
 	}
 
 	auto batch = generateBatch( glyphData );
 	LayoutCache lineCache;
 	lineCache.bounds = bounds;
 	lineCache.batch = batch;
+	lineCache.fonts = fonts;
 	return lineCache;
 }
 
@@ -592,11 +613,7 @@ std::vector<std::pair<uint32_t, ci::ivec2>> TextureRenderer::getGlyphMapForLayou
 			for( auto& glyph : run.glyphs ) 
 			{	
 				// Make sure we have the glyph
-				if( TextureRenderer::getCacheForFont( run.font ).glyphs.count( glyph.index ) != 0 ) {
-					auto fontCache = getCacheForFont( run.font );
-					
-					int glyphIndex = cinder::text::FontManager::get()->getGlyphIndex( run.font, glyph.index, 0 );
-					auto glyphCache = fontCache.glyphs[glyph.index];
+				if( TextureRenderer::getCacheForFont( run.font ).glyphs.count( getGlyphKey( glyph ) ) != 0 ) {
 					map.push_back( {glyph.index, glyph.position } );
 				}
 			}
@@ -608,7 +625,7 @@ std::vector<std::pair<uint32_t, ci::ivec2>> TextureRenderer::getGlyphMapForLayou
 
 void TextureRenderer::loadFont( const Font& font, bool loadEntireFont )
 {
-	if( TextureRenderer::fontCache.count( font ) == 0 ) {
+	if( TextureRenderer::fontCache.count( font.getHandle() ) == 0 ) {
 		TextureRenderer::cacheFont( font, loadEntireFont );
 		CI_LOG_V( "Font loaded: \n" << font );
 	}
@@ -616,19 +633,34 @@ void TextureRenderer::loadFont( const Font& font, bool loadEntireFont )
 
 void TextureRenderer::unloadFont( const Font& font )
 {
-	TextureRenderer::uncacheFont( font );
+	TextureRenderer::uncacheFont( font.getHandle() );
+}
+
+size_t TextureRenderer::releaseUnusedFonts()
+{
+	std::vector<uint32_t> unused;
+	for( auto& font : fontCache ) {
+		if( cinder::text::FontManager::get()->getFontRefCount( font.first ) == 0 )
+			unused.push_back( font.first );
+	}
+
+	for( auto handle : unused ) {
+		uncacheFont( handle );
+	}
+
+	return unused.size();
 }
 
 TextureRenderer::FontCache& TextureRenderer::getCacheForFont( const Font& font )
 {
-	if( !TextureRenderer::fontCache.count( font ) ) {
+	if( !TextureRenderer::fontCache.count( font.getHandle() ) ) {
 		TextureRenderer::cacheFont( font );
 	}
 
-	return TextureRenderer::fontCache[font];
+	return TextureRenderer::fontCache[font.getHandle()];
 }
 
-std::map<uint16_t, TextureRenderer::GlyphCache> TextureRenderer::getGylphMapForFont( const Font& font )
+std::map<uint32_t, TextureRenderer::GlyphCache> TextureRenderer::getGylphMapForFont( const Font& font )
 {
 	return getCacheForFont( font ).glyphs;
 }
@@ -647,17 +679,34 @@ void TextureRenderer::cacheFont( const Font& font,  bool cacheEntireFont )
 	}
 }
 
-void TextureRenderer::uncacheFont( const Font& font )
+void TextureRenderer::uncacheFont( uint32_t fontHandle )
 {
-	if( mSharedCacheEnabled ) {
-		CI_LOG_W( "Cannot un-cache fonts loaded into shared caches" );
+	auto it = TextureRenderer::fontCache.find( fontHandle );
+	if( it == TextureRenderer::fontCache.end() ) {
 		return;
 	}
 
-	auto count = TextureRenderer::fontCache.count( font );
-	if( count ) {
-		std::unordered_map<Font, FontCache>::iterator it = TextureRenderer::fontCache.find( font );
+	if( mSharedCacheEnabled ) {
+		// free the font's glyphs in the shared texture array, other fonts' glyphs stay where they are
+		TexArrayCache& texArrayCache = mSharedTexArrayCache;
+		bool dirty = false;
+
+		for( auto& glyph : (*it).second.glyphs ) {
+			ci::Rectf rect = texArrayCache.texArray->release( glyph.second.region );
+
+			// only the layer being filled is packed again, clear the glyph out of it
+			if( glyph.second.region.layer == texArrayCache.currentLayerIdx && rect.getWidth() > 0 ) {
+				ci::ip::fill( texArrayCache.layerChannel.get(), ( uint8_t )0, Area( rect ) );
+				dirty = true;
+			}
+		}
+
+		if( dirty )
+			uploadChannelToTexture( texArrayCache );
 
+		TextureRenderer::fontCache.erase( it );
+	}
+	else {
 		// remove all references textures from main texture array
 		std::set<int> deadTextures;
 		for( auto texIndex : (*it).second.texArrayCache.texArray->getTextureBlockIndices() ) {
@@ -679,9 +728,9 @@ void TextureRenderer::cacheGlyphs( const Font& font, const std::string string, c
 	Shaper shaper( font );
 	
 	std::vector<uint32_t> glyphIndices;
-	std::vector<Shaper::Glyph> shapedGlyphs = shaper.getShapedText( Shaper::Text( { string, language, script, dir } ) );
-	for( auto glyph : shapedGlyphs ) {
-		glyphIndices.push_back( glyph.index );
+	Shaper::GlyphsRef shapedGlyphs = shaper.shape( Shaper::Text( { string, language, script, dir } ) );
+	if( shapedGlyphs ) {
+		glyphIndices = shapedGlyphs->indices;
 	}
 
 	//std::vector<uint32_t> glyphIndices = cinder::text::FontManager::get()->getGlyphIndices( font, string );
@@ -702,129 +751,260 @@ void TextureRenderer::cacheGlyphs( const Font& font, const std::vector<uint32_t>
 {
 	bool dirty = false;
 
+	TexArrayCache& texArrayCache = getTexArrayCache( font );
+
+	if( texArrayCache.filled ) {
+		CI_LOG_E( "Texture Array is filled. Cannot cache any more gyphs. Increase the size or depth or the Texture Array." );
+		return;
+	}
+
+	for( auto glyphIndex : glyphIndices ) 
+	{
+		auto glyphCache = TextureRenderer::fontCache[font.getHandle()].glyphs[glyphIndex];
+		if( glyphCache.layer > -1 || texArrayCache.filled ) {
+			continue;
+		}
+
+		GlyphBitmap glyph = rasterizeGlyph( font, glyphIndex );
+		packGlyph( font, texArrayCache, glyph, dirty );
+	}
+
+	// we need to reflect any characters we haven't uploaded
+	if( dirty )
+		uploadChannelToTexture( texArrayCache );
+}
+
+TextureRenderer::TexArrayCache& TextureRenderer::getTexArrayCache( const Font& font )
+{
 	// get Texture Array cache based on whether we are using shared cache or not
 	TexArrayCache *texArrayCache;
 	if( TextureRenderer::mSharedCacheEnabled ) {
 		texArrayCache = &TextureRenderer::mSharedTexArrayCache;
 	}
 	else {
-		texArrayCache = &TextureRenderer::fontCache[font].texArrayCache;
+		texArrayCache = &TextureRenderer::fontCache[font.getHandle()].texArrayCache;
 	}
 
 	// get or create the TextureArray
 	if( !texArrayCache->texArray ){
 		texArrayCache->texArray = makeTextureArray();
 	}
-	auto textureArray = texArrayCache->texArray;
 
 	// get or create the Glyph Channel
 	if( !texArrayCache->layerChannel ){
-		texArrayCache->layerChannel = ci::Channel::create( textureArray->getWidth(), textureArray->getHeight() );
+		texArrayCache->layerChannel = ci::Channel::create( texArrayCache->texArray->getWidth(), texArrayCache->texArray->getHeight() );
 		ci::ip::fill( texArrayCache->layerChannel.get(), ( uint8_t )0 );
 		texArrayCache->currentLayerIdx = 0;
 	}
 
-	auto layerChannel = texArrayCache->layerChannel;
-	int layerIndex = texArrayCache->currentLayerIdx;
-	
-	if( texArrayCache->filled ) {
-		CI_LOG_E( "Texture Array is filled. Cannot cache any more gyphs. Increase the size or depth or the Texture Array." );
-		return;
-	}
+	return *texArrayCache;
+}
 
-    for( auto glyphIndex : glyphIndices ) 
-	{
-		auto glyphCache = TextureRenderer::fontCache[font].glyphs[glyphIndex];
-		if( glyphCache.layer > -1 || texArrayCache->filled ) {
+TextureRenderer::GlyphBitmap TextureRenderer::rasterizeGlyph( const Font& font, uint32_t glyphIndex )
+{
+	return rasterizeSubpixelGlyph( font, glyphIndex, 0, 1 );
+}
+
+TextureRenderer::GlyphBitmap TextureRenderer::rasterizeSubpixelGlyph( const Font& font, uint32_t glyphIndex, int subpixelPhase, int subpixelPhases )
+{
+	GlyphBitmap glyph;
+	glyph.index = glyphIndex;
+	glyph.key = getGlyphKey( glyphIndex, subpixelPhase, subpixelPhases );
+	glyph.subpixelPhase = subpixelPhase;
+	glyph.subpixelPhases = subpixelPhases;
+
+	// the coverage stays encoded in the store until the glyph is packed, packing it again never rasterizes
+	auto stored = cinder::text::FontManager::get()->storeGlyphBitmap( font, glyphIndex, subpixelPhase, subpixelPhases );
+
+	glyph.size = stored.size;
+	glyph.offset = ci::vec2( stored.offset );
+	return glyph;
+}
+
+void TextureRenderer::cacheSubpixelGlyphs( const Layout::Run& run )
+{
+	bool dirty = false;
+	TexArrayCache* texArrayCache = nullptr;
+
+	// Phase 0 is the regular glyph, only the shifted variants are cached here, the first time they are used
+	for( auto& glyph : run.glyphs ) {
+		uint32_t key = getGlyphKey( glyph );
+		if( key == glyph.index ) {
 			continue;
 		}
 
-        dirty = true;
-
-		FT_BitmapGlyph bitmapGlyph = cinder::text::FontManager::get()->getGlyphBitmap( font, glyphIndex );
-		FT_Glyph glyph = cinder::text::FontManager::get()->getGlyph( font, glyphIndex );
-		FT_BBox bbox;
-		FT_Glyph_Get_CBox( glyph, FT_GLYPH_BBOX_PIXELS, &bbox );
+		if( ! TextureRenderer::fontCache.count( run.font.getHandle() ) ) {
+			TextureRenderer::cacheFont( run.font );
+		}
 
-		ci::ivec2 glyphSize( bitmapGlyph->bitmap.width, bitmapGlyph->bitmap.rows );
-		if( glyphSize.x < 0 || glyphSize.y < 0 )
-		{
-			CI_LOG_W( "Problem with size of retreived glyph bitmap for glyph " << glyphIndex );
+		auto& glyphs = TextureRenderer::fontCache[run.font.getHandle()].glyphs;
+		auto cached = glyphs.find( key );
+		if( cached != glyphs.end() && cached->second.layer > -1 ) {
 			continue;
 		}
-		ci::ivec2 padding = ci::ivec2( 4 ) - ( glyphSize % ci::ivec2( 4 ) );
-		auto region = textureArray->request( glyphSize, layerIndex, ivec2( 2.0f ) );
-	
-		// if current layer is full, upload channel to texture, increment layer id, reset channel
-		if( region.layer < 0 ) {
-			
-			uploadChannelToTexture( *texArrayCache );
 
-			// clear channel
-			ci::ip::fill( layerChannel.get(), ( uint8_t )0 );
-			dirty = false;
+		if( ! texArrayCache ) {
+			texArrayCache = &getTexArrayCache( run.font );
+		}
 
-			if( layerIndex + 1 >= textureArray->getDepth() * textureArray->getBlockCount() ) {
-				// Expand the texture array if we've run out of room
-				textureArray->expand();
-			}
+		if( texArrayCache->filled ) {
+			break;
+		}
+
+		GlyphBitmap bitmap = rasterizeSubpixelGlyph( run.font, glyph.index, glyph.subpixelPhase, glyph.subpixelPhases );
+		packGlyph( run.font, *texArrayCache, bitmap, dirty );
+	}
+
+	if( dirty )
+		uploadChannelToTexture( *texArrayCache );
+}
+
+void TextureRenderer::packGlyph( const Font& font, TexArrayCache& texArrayCache, const GlyphBitmap& glyph, bool& dirty )
+{
+	dirty = true;
+
+	auto textureArray = texArrayCache.texArray;
+	auto layerChannel = texArrayCache.layerChannel;
+	int layerIndex = texArrayCache.currentLayerIdx;
+
+	auto region = textureArray->request( glyph.size, layerIndex, ivec2( 2.0f ) );
+
+	// if current layer is full, upload channel to texture, increment layer id, reset channel
+	if( region.layer < 0 ) {
+		
+		uploadChannelToTexture( texArrayCache );
 
-			layerIndex++;
-			texArrayCache->currentLayerIdx = layerIndex;
+		// clear channel
+		ci::ip::fill( layerChannel.get(), ( uint8_t )0 );
+		dirty = false;
 
-			// request a new region
-			region = textureArray->request( glyphSize, layerIndex, ivec2( 2.0f ) );
+		if( layerIndex + 1 >= textureArray->getDepth() * textureArray->getBlockCount() ) {
+			// Expand the texture array if we've run out of room
+			textureArray->expand();
 		}
 
-		if( region.layer > -1 )
-		{ 
-			ivec2 offset = region.rect.getUpperLeft();
-	
-			// fill channel
-			ci::ChannelRef channel = ci::Channel::create( glyphSize.x, glyphSize.y, glyphSize.x * sizeof( unsigned char ), sizeof( unsigned char ), bitmapGlyph->bitmap.buffer );
-			if( channel->getData() )
-			{
-				ci::Channel8uRef expandedChannel = ci::Channel8u::create( glyphSize.x + padding.x, glyphSize.y + padding.y );
-				ci::ip::fill( expandedChannel.get(), ( uint8_t )0 );
-				expandedChannel->copyFrom( *channel, ci::Area( 0, 0, glyphSize.x, glyphSize.y ) );
+		layerIndex++;
+		texArrayCache.currentLayerIdx = layerIndex;
+
+		// request a new region
+		region = textureArray->request( glyph.size, layerIndex, ivec2( 2.0f ) );
+	}
+
+	if( region.layer > -1 )
+	{ 
+		ivec2 offset = region.rect.getUpperLeft();
+
+		// decode the stored coverage straight into the layer's upload channel
+		cinder::text::FontManager::get()->decodeGlyphBitmap( font, glyph.index, layerChannel->getData( offset ), layerChannel->getRowBytes(), glyph.subpixelPhase, glyph.subpixelPhases );
+
+		// determine block and layer within the texture array cache
+		int textureDepth = textureArray->getDepth();
+		int block = textureArray->getTextureBlockIndex(region.layer);
+		int layer = region.layer % textureDepth;
+
+		FontCache& cache = TextureRenderer::fontCache[font.getHandle()];
+		cache.texArrayCache = texArrayCache;
+		cache.glyphs[glyph.key].block = block;
+		cache.glyphs[glyph.key].layer = layer;
+		cache.glyphs[glyph.key].size = ci::vec2( glyph.size );
+		cache.glyphs[glyph.key].offset = glyph.offset;
+		cache.glyphs[glyph.key].subTexOffset = ci::vec2( offset ) / ci::vec2( textureArray->getSize() );
+		cache.glyphs[glyph.key].subTexSize = ci::vec2( glyph.size ) / ci::vec2( textureArray->getSize() );
+		cache.glyphs[glyph.key].region = region;
+	} 
+	else 
+	{
+		CI_LOG_W( "No valid region can be found in the atlas." );
+	}
+}
+
+std::shared_future<void> TextureRenderer::loadFontAsync( const Font& font, bool loadEntireFont, const std::function<void( const Font& font )>& callback )
+{
+	auto pending = std::make_shared<PendingFont>( font );
+	pending->callback = callback;
+	std::shared_future<void> future = pending->promise.get_future().share();
 
-				ci::Surface8u surface( *expandedChannel );
-				int mipLevel = 0;
-				GLint dataFormat;
-				GLenum dataType;
-				ci::gl::TextureBase::SurfaceChannelOrderToDataFormatAndType<uint8_t>( surface.getChannelOrder(), &dataFormat, &dataType );
+	// Rasterize on the loading thread, only the packing + upload is left for the GL thread
+	cinder::text::FontManager::get()->runOnLoadThread( [pending, loadEntireFont] {
+		try {
+			std::vector<uint32_t> glyphIndices;
+			if( loadEntireFont ) {
+				glyphIndices = cinder::text::FontManager::get()->getGlyphIndices( pending->font );
+			}
+			else {
+				for( auto range : defaultUnicodeRange() ) {
+					auto indices = cinder::text::FontManager::get()->getGlyphIndices( pending->font, range );
+					glyphIndices.insert( glyphIndices.end(), indices.begin(), indices.end() );
+				}
+			}
 
-				int w = surface.getWidth();
-				int h = surface.getHeight();
+			// unmapped characters all share a glyph, rasterize every glyph once
+			std::sort( glyphIndices.begin(), glyphIndices.end() );
+			glyphIndices.erase( std::unique( glyphIndices.begin(), glyphIndices.end() ), glyphIndices.end() );
 
-				// update channel
-				layerChannel->copyFrom( *expandedChannel, Area( 0, 0, w, h ), offset );
+			for( auto glyphIndex : glyphIndices ) {
+				pending->glyphs.push_back( rasterizeGlyph( pending->font, glyphIndex ) );
 			}
+		}
+		catch( ... ) {
+			pending->promise.set_exception( std::current_exception() );
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock( mPendingFontsMutex );
+		mPendingFonts.push_back( pending );
+	} );
+
+	return future;
+}
+
+size_t TextureRenderer::uploadPendingGlyphs( size_t maxGlyphs )
+{
+	size_t numUploaded = 0;
 
-			// determine block and layer within the texture array cache
-			int textureDepth = texArrayCache->texArray->getDepth();
-			int block = texArrayCache->texArray->getTextureBlockIndex(region.layer);
-			int layer = region.layer % textureDepth;
-
-			//TextureRenderer::fontCache[font].glyphs[glyphIndex].texArray = textureArray;
-			TextureRenderer::fontCache[font].texArrayCache = *texArrayCache;
-			TextureRenderer::fontCache[font].glyphs[glyphIndex].block = block;
-			TextureRenderer::fontCache[font].glyphs[glyphIndex].layer = layer;
-			TextureRenderer::fontCache[font].glyphs[glyphIndex].size = ci::vec2( glyphSize );
-			TextureRenderer::fontCache[font].glyphs[glyphIndex].offset = ci::vec2( bbox.xMin, bbox.yMax );
-			TextureRenderer::fontCache[font].glyphs[glyphIndex].subTexOffset = ci::vec2( offset ) / ci::vec2( textureArray->getSize() );
-			TextureRenderer::fontCache[font].glyphs[glyphIndex].subTexSize = ci::vec2( glyphSize ) / ci::vec2( textureArray->getSize() );
-			//TextureRenderer::fontCache[font].glyphs[glyphIndex].subTexSize = ci::vec2( 0.1 );
-		} 
-		else 
+	while( numUploaded < maxGlyphs ) {
+		std::shared_ptr<PendingFont> pending;
 		{
-			CI_LOG_W( "No valid region can be found in the atlas." );
+			std::lock_guard<std::mutex> lock( mPendingFontsMutex );
+			if( mPendingFonts.empty() ) {
+				break;
+			}
+			pending = mPendingFonts.front();
+		}
+
+		bool dirty = false;
+		TexArrayCache& texArrayCache = getTexArrayCache( pending->font );
+
+		while( pending->numUploaded < pending->glyphs.size() && numUploaded < maxGlyphs ) {
+			const GlyphBitmap& glyph = pending->glyphs[pending->numUploaded++];
+
+			if( TextureRenderer::fontCache[pending->font.getHandle()].glyphs[glyph.key].layer > -1 || texArrayCache.filled ) {
+				continue;
+			}
+
+			packGlyph( pending->font, texArrayCache, glyph, dirty );
+			numUploaded++;
 		}
-    }
 
-    // we need to reflect any characters we haven't uploaded
-    if( dirty )
-        uploadChannelToTexture( *texArrayCache );
+		if( dirty )
+			uploadChannelToTexture( texArrayCache );
+
+		if( pending->numUploaded == pending->glyphs.size() ) {
+			{
+				std::lock_guard<std::mutex> lock( mPendingFontsMutex );
+				mPendingFonts.pop_front();
+			}
+
+			pending->glyphs.clear();
+			pending->promise.set_value();
+
+			if( pending->callback ) {
+				pending->callback( pending->font );
+			}
+		}
+	}
+
+	return numUploaded;
 }
 
 
@@ -1036,7 +1216,7 @@ TextureArray::Region TextureArray::request( const ci::ivec2 &size, const ci::ive
 
 		try {
 			pair<uint32_t, Rectf> rect = mTexturePacks[i].insert( size + padding * 2, false );
-			return Region( rect.second, i );
+			return Region( rect.second, i, rect.first );
 		}
 		catch( const TexturePackOutOfBoundExc &exc ) {
 			i++;
@@ -1054,13 +1234,28 @@ TextureArray::Region TextureArray::request( const ci::ivec2 &size, int layerInde
 
 	try {
 		pair<uint32_t, Rectf> rect = mTexturePacks[layerIndex].insert( size + padding * 2, false );
-		return Region( rect.second, layerIndex );
+		return Region( rect.second, layerIndex, rect.first );
 	}
 	catch( const TexturePackOutOfBoundExc &exc ) {
 		return Region();
 	}
 }
 
+ci::Rectf TextureArray::release( const Region &region )
+{
+	if( region.id == 0 || region.layer < 0 || region.layer >= (int)mTexturePacks.size() )
+		return Rectf::zero();
+
+	auto& usedRectangles = mTexturePacks[region.layer].getUsedRectangles();
+	auto it = usedRectangles.find( region.id );
+	if( it == usedRectangles.end() )
+		return Rectf::zero();
+
+	Rectf rect = it->second;
+	mTexturePacks[region.layer].erase( region.id );
+	return rect;
+}
+
 void TextureArray::update( ci::ChannelRef channel, int layerIdx )
 {
 	int layer = layerIdx % getDepth();
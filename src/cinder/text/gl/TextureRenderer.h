@@ -1,5 +1,9 @@
 #pragma once
 
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
 #include <unordered_map>
 
 #include "cinder/gl/Texture.h"
@@ -72,12 +76,13 @@ class TextureArray {
 
 	//! Defines a rectangular area and layer index for a region of a texture where a glyph is located in a texture.
 	struct Region {
-		Region( const ci::Rectf &rect = Rectf::zero(), int layer = -1 ):
-			rect( rect ), layer( layer )
+		Region( const ci::Rectf &rect = Rectf::zero(), int layer = -1, uint32_t id = 0 ):
+			rect( rect ), layer( layer ), id( id )
 		{};
 
 		ci::Rectf rect;
 		int		  layer;
+		uint32_t  id;		// TexturePack rectangle id, 0 when nothing was packed (empty glyphs)
 	};
 
   public:
@@ -91,6 +96,8 @@ class TextureArray {
 	Region request( const ci::ivec2 &size, const ci::ivec2 &padding = ci::ivec2( 10 ) );
 	//! Request the a valid area of a texture on a specific layer
 	Region request( const ci::ivec2 &size, int layerIndex, const ci::ivec2 &padding = ci::ivec2( 10 ) );
+	//! Frees a region returned by request() so it can be packed again, returns the freed area
+	ci::Rectf release( const Region &region );
 
 	//! Returns the width of the texture in pixels, ignoring clean bounds.
 	GLint		getWidth() const { return mSize.x; };
@@ -134,6 +141,7 @@ class TextureRenderer {
 		ci::vec2 offset;
 		ci::vec2 subTexSize;
 		ci::vec2 subTexOffset;
+		TextureArray::Region region;	// where the glyph was packed, freed when the font is unloaded
 	} GlyphCache;
 
 	typedef struct {
@@ -143,8 +151,9 @@ class TextureRenderer {
 		bool			filled = false;
 	} TexArrayCache;
 
+	// Glyphs are keyed by getGlyphKey(), the glyph index plus the subpixel shift it was rasterized at
 	typedef struct {
-		std::map<uint16_t, GlyphCache > glyphs;
+		std::map<uint32_t, GlyphCache > glyphs;
 		TexArrayCache					texArrayCache;
 	} FontCache;
 
@@ -212,6 +221,8 @@ class TextureRenderer {
 		void unmapDynamicScale( ci::gl::VboMesh::MappedAttrib<vec2> &attrib ) { attrib.unmap(); }
 		void unmapDynamicColor( ci::gl::VboMesh::MappedAttrib<vec4> &attrib ) { attrib.unmap(); }
 
+		// Keeps the fonts (and their cached glyphs) from being unloaded while the cache exists
+		std::vector<Font> fonts;
 	} LayoutCache;
 
   public:
@@ -229,12 +240,22 @@ class TextureRenderer {
 
 	//! Staticly load/cache the specified font, optionally loading every glyph of the font
 	static void loadFont( const Font& font, bool loadEntireFont = false );
-	//! Renove the cached font from the cache
+	//! Load/cache a font without blocking, the glyphs are rasterized on the FontManager's loading thread
+	//! and packed + uploaded by uploadPendingGlyphs(). The future is ready (and the callback called, on the GL thread)
+	//! once every glyph has been uploaded.
+	static std::shared_future<void> loadFontAsync( const Font& font, bool loadEntireFont = false, const std::function<void( const Font& font )>& callback = nullptr );
+	//! Uploads up to maxGlyphs glyphs rasterized by loadFontAsync(), call this once per frame on the GL thread
+	//! Returns the number of glyphs uploaded
+	static size_t uploadPendingGlyphs( size_t maxGlyphs = 128 );
+	//! Renove the cached font from the cache, with shared caches its glyphs' space is freed for other fonts
 	static void unloadFont( const Font& font );
+	//! Removes every cached font that no Font object references anymore, see FontManager::getFontRefCount()
+	//! Returns the number of fonts removed
+	static size_t releaseUnusedFonts();
 	//! Print all cached fonts to the console
 	static void printCachedFonts() {
 		for( auto font : fontCache ) {
-			CI_LOG_V( font.first );
+			CI_LOG_V( "Font " << font.first << ": " << font.second.glyphs.size() << " glyphs, " << cinder::text::FontManager::get()->getFontRefCount( font.first ) << " references" );
 		}
 	}
 
@@ -255,7 +276,10 @@ class TextureRenderer {
 	//! Returns the FontCache object, which can be used to render outside of the TextureRenderer object.
 	FontCache& getCacheForFont( const Font& font );
 	//! Returns a map of Glyph information for the specified font
-	std::map<uint16_t, GlyphCache> getGylphMapForFont( const Font &font );
+	std::map<uint32_t, GlyphCache> getGylphMapForFont( const Font &font );
+	//! Returns the FontCache::glyphs key for a glyph at a subpixel phase, phase 0 is the glyph index itself
+	static uint32_t getGlyphKey( uint32_t glyphIndex, int subpixelPhase = 0, int subpixelPhases = 1 ) { return glyphIndex | ( uint32_t( FontManager::getSubpixelShift( subpixelPhase, subpixelPhases ) ) << 16 ); }
+	static uint32_t getGlyphKey( const Layout::Glyph& glyph ) { return getGlyphKey( glyph.index, glyph.subpixelPhase, glyph.subpixelPhases ); }
 	//! Returns the textures used for the specified font
 #ifdef CINDER_TEXTURE_RENDERER_USE_TEXTURE2D
 	std::vector<ci::gl::Texture2dRef> getTexturesForFont(const Font& font)
@@ -294,9 +318,44 @@ class TextureRenderer {
 	//std::vector< GlyphBatch > generateBatches(const std::unordered_map<int, BatchCacheData> &batchCaches );
 	GlyphBatch generateBatch(const std::unordered_map<int, BatchCacheData> &batchCaches, bool enableDynamicOffset = false, bool enableDynamicScale = false, bool enableDynamicColor = false );
 
+	// A glyph in the FontManager's glyph bitmap store, decoded straight into the layer when it's packed
+	typedef struct {
+		uint32_t			index;
+		uint32_t			key;
+		int					subpixelPhase;
+		int					subpixelPhases;
+		ci::ivec2			size;
+		ci::vec2			offset;
+	} GlyphBitmap;
+
+	// A font rasterized by loadFontAsync(), waiting for its glyphs to be uploaded
+	struct PendingFont {
+		PendingFont( const Font& font ) : font( font ), numUploaded( 0 ) {}
+
+		Font									font;
+		std::vector<GlyphBitmap>				glyphs;
+		size_t									numUploaded;
+		std::promise<void>						promise;
+		std::function<void( const Font& font )>	callback;
+	};
+
+	//! Rasterizes a glyph into the glyph bitmap store, safe to call from any thread. Glyphs that couldn't be loaded are empty.
+	static GlyphBitmap rasterizeGlyph( const Font& font, uint32_t glyphIndex );
+	//! Rasterizes a glyph moved right by a fraction of a pixel, for layouts with subpixel phases
+	static GlyphBitmap rasterizeSubpixelGlyph( const Font& font, uint32_t glyphIndex, int subpixelPhase, int subpixelPhases );
+	//! Caches the subpixel variants used by a run that aren't in the texture array yet
+	static void cacheSubpixelGlyphs( const Layout::Run& run );
+	//! Packs a glyph into the font's texture array, uploading the current layer when it fills up
+	static void packGlyph( const Font& font, TexArrayCache& texArrayCache, const GlyphBitmap& glyph, bool& dirty );
+	static TexArrayCache& getTexArrayCache( const Font& font );
+
+	static std::mutex							mPendingFontsMutex;
+	static std::deque<std::shared_ptr<PendingFont>>	mPendingFonts;
+
 	static void cacheFont( const Font& font, bool cacheEntireFont = false );
-	static void uncacheFont( const Font& font );
-	static std::unordered_map<Font, FontCache>	fontCache;
+	static void uncacheFont( uint32_t fontHandle );
+	//! Cached fonts by handle, the cache doesn't hold Font objects so it doesn't keep fonts loaded
+	static std::unordered_map<uint32_t, FontCache>	fontCache;
 	
 	//! The TextureArray cache, when mSharedCacheEnabled is set to true
 	static TexArrayCache						mSharedTexArrayCache;